@@ -12,6 +12,12 @@
 #include "src/nvs_component.h"
 #include "src/sd_component.h"
 #include "src/csi_component.h"
+#include "src/math_component.h"
+#include "src/aggregate_component.h"
+#include "src/waterfall_component.h"
+#include "src/dsp_component.h"
+#include "src/replay_component.h"
+#include "src/inject_component.h"
 #include "src/input_component.h"
 #include "src/sockets_component.h"
 
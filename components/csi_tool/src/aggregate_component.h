@@ -0,0 +1,135 @@
+#ifndef ESP32_CSI_AGGREGATE_COMPONENT_H
+#define ESP32_CSI_AGGREGATE_COMPONENT_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "ring_component.h"
+#include "math_component.h"
+#include "segment_component.h"
+
+/*
+ * Per-subcarrier statistics over one display window, so every received
+ * frame contributes to the plot instead of only the one that happens to be
+ * newest when the display refreshes.
+ *
+ * Amplitude mean and variance use Welford's update, min and max are tracked
+ * alongside. Phase is averaged circularly by summing the raw IQ vectors.
+ * Constant memory, O(subcarriers) work per frame.
+ *
+ * Works on one csi segment, so every frame in a window has the same subcarriers.
+ */
+
+#define AGGREGATE_MAX_SUBC (CSI_MAX_LEN / 2)
+
+typedef struct {
+    uint32_t count;             // frames in the current window
+    uint16_t subc;              // subcarriers per frame in the current window
+    csi_subc_map_t map;         // their subcarrier indices
+    int64_t first_rx_us;
+    int64_t last_rx_us;
+    float mean[AGGREGATE_MAX_SUBC];
+    float m2[AGGREGATE_MAX_SUBC];
+    uint16_t min[AGGREGATE_MAX_SUBC];
+    uint16_t max[AGGREGATE_MAX_SUBC];
+    int32_t sum_im[AGGREGATE_MAX_SUBC];    // each subcarrier is stored imaginary part first
+    int32_t sum_re[AGGREGATE_MAX_SUBC];
+} aggregate_t;
+
+void aggregate_reset(aggregate_t *agg) {
+    agg->count = 0;
+    agg->subc = 0;
+}
+
+void _aggregate_start(aggregate_t *agg, const csi_segment_t *seg) {
+    uint16_t subc = seg->subc;
+    agg->subc = subc;
+    agg->map = seg->map;
+    memset(agg->mean, 0, subc * sizeof(float));
+    memset(agg->m2, 0, subc * sizeof(float));
+    memset(agg->min, 0xFF, subc * sizeof(uint16_t));
+    memset(agg->max, 0, subc * sizeof(uint16_t));
+    memset(agg->sum_im, 0, subc * sizeof(int32_t));
+    memset(agg->sum_re, 0, subc * sizeof(int32_t));
+}
+
+/*
+ * Add the segment of one frame to the window. A segment covering other
+ * subcarriers (e.g. the LLTF of a packet with a different secondary channel)
+ * cannot be merged, it restarts the window. Returns false in that case.
+ */
+bool aggregate_add(aggregate_t *agg, const csi_segment_t *seg, int64_t rx_us) {
+    uint16_t subc = seg->subc;
+    bool merged = true;
+
+    if (agg->count == 0 || subc != agg->subc || memcmp(&seg->map, &agg->map, sizeof(csi_subc_map_t)) != 0) {
+        merged = agg->count == 0;
+        agg->count = 0;
+        agg->first_rx_us = rx_us;
+        _aggregate_start(agg, seg);
+    }
+
+    agg->count++;
+    agg->last_rx_us = rx_us;
+    float inv = 1.0f / agg->count;
+    const int8_t *iq = seg->data;
+
+    for (int k = 0; k < subc; k++) {
+        uint16_t amp = csi_amplitude(iq[k * 2], iq[k * 2 + 1]);
+        float delta = amp - agg->mean[k];
+        agg->mean[k] += delta * inv;
+        agg->m2[k] += delta * (amp - agg->mean[k]);
+        if (amp < agg->min[k]) {
+            agg->min[k] = amp;
+        }
+        if (amp > agg->max[k]) {
+            agg->max[k] = amp;
+        }
+        agg->sum_im[k] += iq[k * 2];
+        agg->sum_re[k] += iq[k * 2 + 1];
+    }
+    return merged;
+}
+
+float aggregate_mean(const aggregate_t *agg, int k) {
+    return agg->mean[k];
+}
+
+// population variance of the window
+float aggregate_variance(const aggregate_t *agg, int k) {
+    return agg->count > 0 ? agg->m2[k] / agg->count : 0.0f;
+}
+
+uint16_t aggregate_min(const aggregate_t *agg, int k) {
+    return agg->min[k];
+}
+
+uint16_t aggregate_max(const aggregate_t *agg, int k) {
+    return agg->max[k];
+}
+
+// false for null subcarriers, which report a zero vector
+bool aggregate_has_phase(const aggregate_t *agg, int k) {
+    return agg->sum_im[k] != 0 || agg->sum_re[k] != 0;
+}
+
+/*
+ * Circular mean phase as a binary angle. The summed IQ vector is
+ * shifted down until it fits the int8 kernel, which keeps at least 6 bits.
+ */
+int32_t aggregate_phase(const aggregate_t *agg, int k) {
+    int32_t y = agg->sum_im[k];
+    int32_t x = agg->sum_re[k];
+    while (y > 127 || y < -127 || x > 127 || x < -127) {
+        y >>= 1;
+        x >>= 1;
+    }
+    return csi_phase(y, x);
+}
+
+// circular mean phase on the csi_phase_coord scale
+int16_t aggregate_phase_coord(const aggregate_t *agg, int k) {
+    return csi_angle_coord(aggregate_phase(agg, k));
+}
+
+#endif //ESP32_CSI_AGGREGATE_COMPONENT_H
@@ -0,0 +1,426 @@
+#ifndef ESP32_CSI_BENCH_COMPONENT_H
+#define ESP32_CSI_BENCH_COMPONENT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "hal/cpu_hal.h"
+#include "csi_component.h"
+#include "ring_component.h"
+#include "segment_component.h"
+#include "math_component.h"
+#include "aggregate_component.h"
+#include "motion_component.h"
+#include "record_component.h"
+#include "codec_component.h"
+#include "csv_component.h"
+#include "clock_component.h"
+#include "pacer_component.h"
+#include "command_component.h"
+
+/*
+ * Benchmarks of the per-packet kernels over synthetic frames at the CSI
+ * lengths of the three LTF layouts of a 20 MHz channel: 128 bytes LLTF only
+ * (non HT), 256 bytes with the HT-LTF and 384 bytes with the STBC-HT-LTF.
+ * Kernels that do not depend on the frame length run once, with len 0.
+ *
+ * Every kernel is timed with the cpu cycle counter over runs of at least
+ * BENCH_RUN_US, the best of BENCH_REPEATS runs is reported. On the ESP32 the
+ * counter is CCOUNT, on the host the shim counts nanoseconds instead.
+ *
+ * The same suite runs on the host (host/csi_bench.cc, which also compares
+ * against a committed baseline) and at boot on the board with CONFIG_CSI_BENCH.
+ */
+
+#ifdef CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ
+#define BENCH_TICKS_PER_US CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ
+#define BENCH_BACKEND "ccount"
+#else
+#define BENCH_TICKS_PER_US 1000
+#define BENCH_BACKEND "host_ns"
+#endif
+
+#define BENCH_FRAMES 16             // distinct frames the kernels cycle through
+#define BENCH_RUN_US 10000          // well below the 32 bit wrap of the counter on either backend
+#define BENCH_REPEATS 9
+#define BENCH_MAX_RESULTS 48
+
+static const uint16_t BENCH_LENS[] = {128, 256, 384};
+#define BENCH_LEN_COUNT (sizeof(BENCH_LENS) / sizeof(BENCH_LENS[0]))
+
+typedef struct {
+    uint16_t len;
+    csi_frame_t frames[BENCH_FRAMES];
+    wifi_csi_info_t infos[BENCH_FRAMES];     // the same frames as the driver hands them to the callback
+} bench_set_t;
+
+// runs n operations, returns something depending on the results so nothing is optimized away
+typedef uint32_t (*bench_fn_t)(bench_set_t *set, uint32_t n);
+
+typedef struct {
+    const char *name;
+    bench_fn_t fn;
+    bool per_len;
+} bench_kernel_t;
+
+typedef struct {
+    const char *kernel;
+    uint16_t len;
+    const bench_kernel_t *fn;
+    bench_set_t *set;
+    uint32_t ops;               // per run
+    uint32_t best_ticks;
+    double ticks_per_op;
+    double ns_per_op;
+} bench_result_t;
+
+bench_set_t bench_sets[BENCH_LEN_COUNT];
+csi_ring_t bench_ring;
+csi_frame_t bench_frame;
+aggregate_t bench_window;
+motion_t bench_motion;
+csi_codec_t bench_codec;
+clock_map_t bench_clock;
+pacer_t bench_pacer;
+command_table_t bench_commands;
+uint8_t bench_record[CSI_RECORD_MAX_LEN];
+char bench_line[CSV_LINE_LEN(CSI_MAX_LEN)];
+volatile uint32_t bench_sink;
+
+/*
+ * Slowly rotating channel with a frequency selective dip and +-1 of noise,
+ * like the synthetic frames of csi_host, from a fixed seed.
+ */
+void bench_make_set(bench_set_t *set, uint16_t len) {
+    static const uint8_t mac[6] = {0x7C, 0x9E, 0xBD, 0x65, 0xB2, 0x3D};
+    uint32_t seed = 1;
+    set->len = len;
+    for (int n = 0; n < BENCH_FRAMES; n++) {
+        csi_frame_t *frame = &set->frames[n];
+        memset(frame, 0, sizeof(csi_frame_t));
+        frame->rx_ctrl.rssi = -45;
+        frame->rx_ctrl.sig_mode = len > 128;
+        frame->rx_ctrl.stbc = len > 256;
+        frame->rx_ctrl.channel = 6;
+        frame->rx_ctrl.noise_floor = -95;
+        frame->rx_ctrl.sig_len = 44;
+        frame->rx_ctrl.timestamp = n * 10000;
+        memcpy(frame->mac, mac, 6);
+        frame->len = len;
+        frame->rx_us = n * 10000;
+        for (int k = 0; k < len / 2; k++) {
+            seed = seed * 1103515245 + 12345;
+            int noise = (int) (seed >> 16) % 3 - 1;
+            float amplitude = 20 + 10 * sinf(k * 0.2f + n * 0.01f);
+            float phase = k * 0.3f + n * 0.05f;
+            frame->buf[2 * k] = (int8_t) (amplitude * sinf(phase)) + noise;
+            frame->buf[2 * k + 1] = (int8_t) (amplitude * cosf(phase)) - noise;
+        }
+
+        wifi_csi_info_t *info = &set->infos[n];
+        memset(info, 0, sizeof(wifi_csi_info_t));
+        info->rx_ctrl = frame->rx_ctrl;
+        memcpy(info->mac, mac, 6);
+        info->buf = frame->buf;
+        info->len = len;
+    }
+}
+
+uint32_t _bench_mac_filter(bench_set_t *set, uint32_t n) {
+    uint32_t accepted = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        accepted += mac_filter_accept(set->frames[i % BENCH_FRAMES].mac);
+    }
+    return accepted;
+}
+
+// the copy out of the driver's buffer in the callback and into the consumer
+uint32_t _bench_ring(bench_set_t *set, uint32_t n) {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        csi_ring_push(&bench_ring, &set->infos[i % BENCH_FRAMES], i);
+        csi_ring_pop(&bench_ring, &bench_frame);
+        sum += bench_frame.len;
+    }
+    return sum;
+}
+
+uint32_t _bench_segments(bench_set_t *set, uint32_t n) {
+    csi_segments_t segments;
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        const csi_frame_t *frame = &set->frames[i % BENCH_FRAMES];
+        sum += csi_parse_segments(&frame->rx_ctrl, frame->buf, frame->len, &segments) ? segments.count : 0;
+    }
+    return sum;
+}
+
+uint32_t _bench_amplitude(bench_set_t *set, uint32_t n) {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        const int8_t *iq = set->frames[i % BENCH_FRAMES].buf;
+        for (int k = 0; k < set->len / 2; k++) {
+            sum += csi_amplitude(iq[2 * k], iq[2 * k + 1]);
+        }
+    }
+    return sum;
+}
+
+uint32_t _bench_amplitude_fast(bench_set_t *set, uint32_t n) {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        const int8_t *iq = set->frames[i % BENCH_FRAMES].buf;
+        for (int k = 0; k < set->len / 2; k++) {
+            sum += csi_amplitude_fast(iq[2 * k], iq[2 * k + 1]);
+        }
+    }
+    return sum;
+}
+
+uint32_t _bench_phase(bench_set_t *set, uint32_t n) {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        const int8_t *iq = set->frames[i % BENCH_FRAMES].buf;
+        for (int k = 0; k < set->len / 2; k++) {
+            sum += csi_phase(iq[2 * k], iq[2 * k + 1]);
+        }
+    }
+    return sum;
+}
+
+// what the dsp task does per frame for the display, parse and fold the LLTF into the window
+uint32_t _bench_aggregate(bench_set_t *set, uint32_t n) {
+    csi_segments_t segments;
+    for (uint32_t i = 0; i < n; i++) {
+        const csi_frame_t *frame = &set->frames[i % BENCH_FRAMES];
+        if (csi_parse_segments(&frame->rx_ctrl, frame->buf, frame->len, &segments) &&
+            csi_has_segment(&segments, CSI_SEGMENT_LLTF)) {
+            aggregate_add(&bench_window, &segments.segment[CSI_SEGMENT_LLTF], frame->rx_us);
+        }
+    }
+    return bench_window.count;
+}
+
+uint32_t _bench_motion(bench_set_t *set, uint32_t n) {
+    csi_segments_t segments;
+    uint32_t changes = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        const csi_frame_t *frame = &set->frames[i % BENCH_FRAMES];
+        if (csi_parse_segments(&frame->rx_ctrl, frame->buf, frame->len, &segments) &&
+            csi_has_segment(&segments, CSI_SEGMENT_LLTF)) {
+            changes += motion_add(&bench_motion, &segments.segment[CSI_SEGMENT_LLTF]);
+        }
+    }
+    return changes + motion_score(&bench_motion);
+}
+
+uint32_t _bench_record(bench_set_t *set, uint32_t n) {
+    csi_record_t rec;
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        csi_frame_to_record(&set->frames[i % BENCH_FRAMES], &rec);
+        sum += csi_record_encode(&rec, bench_record, sizeof(bench_record));
+    }
+    return sum;
+}
+
+uint32_t _bench_codec(bench_set_t *set, uint32_t n) {
+    csi_record_t rec;
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        csi_frame_to_record(&set->frames[i % BENCH_FRAMES], &rec);
+        sum += csi_codec_encode_record(&bench_codec, &rec, bench_record, sizeof(bench_record));
+    }
+    return sum;
+}
+
+uint32_t _bench_csv(bench_set_t *set, uint32_t n) {
+    csi_record_t rec;
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        csi_frame_to_record(&set->frames[i % BENCH_FRAMES], &rec);
+        sum += csv_format_row(&rec, bench_line, sizeof(bench_line));
+    }
+    return sum;
+}
+
+// the same row with a printf per field, as the tools wrote it before csv_format_row
+uint32_t _bench_csv_printf(bench_set_t *set, uint32_t n) {
+    csi_record_t rec;
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        csi_frame_to_record(&set->frames[i % BENCH_FRAMES], &rec);
+        char role[5] = {0};
+        memcpy(role, rec.role, 4);
+        char *p = bench_line;
+        char *end = bench_line + sizeof(bench_line);
+        p += snprintf(p, end - p, "CSI_DATA,%s,%02X:%02X:%02X:%02X:%02X:%02X,", role, rec.mac[0], rec.mac[1],
+                      rec.mac[2], rec.mac[3], rec.mac[4], rec.mac[5]);
+        p += snprintf(p, end - p, "%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%u,%d,%d,%d,%d,", rec.rssi, rec.rate,
+                      rec.sig_mode, rec.mcs, rec.bandwidth, rec.smoothing, rec.not_sounding, rec.aggregation,
+                      rec.stbc, rec.fec_coding, rec.sgi, rec.noise_floor, rec.ampdu_cnt, rec.channel,
+                      rec.secondary_channel, rec.local_timestamp, rec.ant, rec.sig_len, rec.rx_state,
+                      rec.real_time_set);
+        p += snprintf(p, end - p, "%llu.%06llu,%d,[", (unsigned long long) (rec.real_timestamp / 1000000),
+                      (unsigned long long) (rec.real_timestamp % 1000000), rec.len);
+        for (int k = 0; k < rec.len; k++) {
+            p += snprintf(p, end - p, k == 0 ? "%d" : " %d", rec.data[k]);
+        }
+        p += snprintf(p, end - p, "]\n");
+        sum += p - bench_line;
+    }
+    return sum;
+}
+
+uint32_t _bench_clock(bench_set_t *set, uint32_t n) {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        sum += (uint32_t) clock_map_real_us(&bench_clock, (int64_t) i * 10000);
+    }
+    return sum;
+}
+
+// one packet sent exactly on its deadline per operation
+uint32_t _bench_pacer(bench_set_t *set, uint32_t n) {
+    uint32_t due = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        int64_t now_us = pacer_next_us(&bench_pacer);
+        due += pacer_due(&bench_pacer, now_us);
+        pacer_sent(&bench_pacer, now_us);
+    }
+    return due;
+}
+
+void _bench_command_handler(char *args) {
+    bench_sink = bench_sink + (uint8_t) args[0];
+}
+
+uint32_t _bench_command(bench_set_t *set, uint32_t n) {
+    char line[COMMAND_LINE_LEN];
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        strcpy(line, "MAC ADD 7C:9E:BD:65:B2:3D");
+        found += command_dispatch(&bench_commands, line);
+    }
+    return found;
+}
+
+static const bench_kernel_t BENCH_KERNELS[] = {
+    {"mac_filter", &_bench_mac_filter, false},
+    {"ring", &_bench_ring, true},
+    {"segments", &_bench_segments, true},
+    {"amplitude", &_bench_amplitude, true},
+    {"amplitude_fast", &_bench_amplitude_fast, true},
+    {"phase", &_bench_phase, true},
+    {"aggregate", &_bench_aggregate, true},
+    {"motion", &_bench_motion, true},
+    {"record", &_bench_record, true},
+    {"codec", &_bench_codec, true},
+    {"csv", &_bench_csv, true},
+    {"csv_printf", &_bench_csv_printf, true},
+    {"clock", &_bench_clock, false},
+    {"pacer", &_bench_pacer, false},
+    {"command", &_bench_command, false},
+};
+
+#define BENCH_KERNEL_COUNT (sizeof(BENCH_KERNELS) / sizeof(BENCH_KERNELS[0]))
+
+// state every kernel starts from, the same on every run
+void _bench_reset() {
+    csi_ring_init(&bench_ring, CSI_RING_DROP_OLDEST);
+    aggregate_reset(&bench_window);
+    motion_init(&bench_motion, MOTION_ENTER, MOTION_EXIT);
+    csi_codec_init(&bench_codec, CODEC_KEYFRAME_INTERVAL);
+    clock_map_init(&bench_clock);
+    clock_map_sync(&bench_clock, 0, 1700000000000000LL);
+    clock_map_sync(&bench_clock, CLOCK_MIN_DRIFT_SPAN_US, 1700000000000000LL + CLOCK_MIN_DRIFT_SPAN_US + 300);
+    pacer_init(&bench_pacer, 1000, PACER_MAX_BURST, 0);
+}
+
+uint32_t _bench_time(const bench_kernel_t *kernel, bench_set_t *set, uint32_t n) {
+    _bench_reset();
+    uint32_t start = cpu_hal_get_cycle_count();
+    bench_sink = bench_sink + kernel->fn(set, n);
+    return cpu_hal_get_cycle_count() - start;
+}
+
+// double the operations until a run is long enough to time
+uint32_t _bench_calibrate(const bench_kernel_t *kernel, bench_set_t *set) {
+    uint32_t n = 16;
+    while (_bench_time(kernel, set, n) < BENCH_RUN_US * BENCH_TICKS_PER_US && n < (1u << 24)) {
+        n *= 2;
+    }
+    return n;
+}
+
+/*
+ * Run every kernel whose name contains filter (all for NULL) and fill
+ * results, returns their number. Sets up the mac filter and the clock like
+ * csi_init and leaves the global statistics cleared, so call it before csi_init.
+ */
+int bench_run(const char *filter, bench_result_t *results, int cap) {
+    mac_filter_init(MAC_FILTER_ALLOW, MAC_AP);
+    clock_map_init(&csi_clock);
+    if (command_find(&bench_commands, "MAC") == NULL) {
+        command_register(&bench_commands, "MAC", "", &_bench_command_handler);
+    }
+
+    int count = 0;
+    for (size_t l = 0; l < BENCH_LEN_COUNT; l++) {
+        bench_make_set(&bench_sets[l], BENCH_LENS[l]);
+        for (size_t k = 0; k < BENCH_KERNEL_COUNT && count < cap; k++) {
+            const bench_kernel_t *kernel = &BENCH_KERNELS[k];
+            if ((kernel->per_len || l == 0) && (filter == NULL || strstr(kernel->name, filter) != NULL)) {
+                bench_result_t *r = &results[count++];
+                r->kernel = kernel->name;
+                r->len = kernel->per_len ? BENCH_LENS[l] : 0;
+                r->fn = kernel;
+                r->set = &bench_sets[l];
+                r->ops = _bench_calibrate(kernel, r->set);
+                r->best_ticks = UINT32_MAX;
+            }
+        }
+    }
+
+    // repeats go round all kernels, so a slow stretch of the machine costs every kernel one run at most
+    for (int rep = 0; rep < BENCH_REPEATS; rep++) {
+        for (int i = 0; i < count; i++) {
+            bench_result_t *r = &results[i];
+            uint32_t ticks = _bench_time(r->fn, r->set, r->ops);
+            r->best_ticks = ticks < r->best_ticks ? ticks : r->best_ticks;
+        }
+        // lets the idle task feed the watchdog on the board
+        vTaskDelay(1);
+    }
+    for (int i = 0; i < count; i++) {
+        bench_result_t *r = &results[i];
+        r->ticks_per_op = (double) r->best_ticks / r->ops;
+        r->ns_per_op = r->ticks_per_op * 1000 / BENCH_TICKS_PER_US;
+    }
+    stats_reset();
+    return count;
+}
+
+void bench_print(const bench_result_t *results, int count) {
+    printf("%-16s %5s %12s %12s %14s\n", "kernel", "len", "ticks/frame", "ns/frame", "frames/s");
+    for (int i = 0; i < count; i++) {
+        const bench_result_t *r = &results[i];
+        printf("%-16s %5u %12.1f %12.1f %14.0f\n", r->kernel, r->len, r->ticks_per_op, r->ns_per_op,
+               1e9 / r->ns_per_op);
+    }
+}
+
+// one result per line, so the baseline can be read back without a JSON library
+void bench_write_json(FILE *out, const bench_result_t *results, int count) {
+    fprintf(out, "{\"backend\": \"%s\", \"ticks_per_us\": %d, \"results\": [\n", BENCH_BACKEND, BENCH_TICKS_PER_US);
+    for (int i = 0; i < count; i++) {
+        const bench_result_t *r = &results[i];
+        fprintf(out, "  {\"kernel\": \"%s\", \"len\": %u, \"ns_per_frame\": %.2f, \"frames_per_s\": %.0f}%s\n",
+                r->kernel, r->len, r->ns_per_op, 1e9 / r->ns_per_op, i + 1 < count ? "," : "");
+    }
+    fprintf(out, "]}\n");
+}
+
+#endif //ESP32_CSI_BENCH_COMPONENT_H
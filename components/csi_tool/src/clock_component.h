@@ -0,0 +1,180 @@
+#ifndef ESP32_CSI_CLOCK_COMPONENT_H
+#define ESP32_CSI_CLOCK_COMPONENT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+
+/*
+ * Maps the local microsecond clock to wall time with a linear model,
+ *
+ *   real = anchor_real + d + d * drift,  d = local - anchor_local
+ *
+ * so stamping a frame is a subtraction, a multiply and a shift instead of a
+ * gettimeofday and a double conversion. Every sync moves the anchor towards
+ * the new reference point, or onto it for a large error. Sync points at least CLOCK_MIN_DRIFT_SPAN_US apart
+ * also measure how fast the local clock runs against the reference, and the
+ * drift follows those measurements with a low pass so jitter in the reference
+ * (e.g. a SETTIME line delayed on the serial port) does not swing it.
+ *
+ * Plain C++ without ESP-IDF dependencies, so it can be driven by synthetic
+ * clocks on the host. Readers never lock or wait for a sync. A sync writes
+ * the next of three model slots and publishes it by advancing a sequence
+ * counter, which is odd while a slot is being written. The slot a reader
+ * copies is only rewritten two syncs later, so a reader retries only if
+ * that happened while it was copying. Syncs from different tasks (SETTIME
+ * on the console, the time server) are serialized by a mutex.
+ */
+
+#define CLOCK_DRIFT_SHIFT 32
+// crystals are specified to tens of ppm, a larger apparent drift means the reference was stepped
+#define CLOCK_MAX_DRIFT_PPM 500
+#define CLOCK_MIN_DRIFT_SPAN_US 30000000LL
+// a new drift measurement moves the estimate by 1 / 2^CLOCK_DRIFT_SMOOTHING of the difference
+#define CLOCK_DRIFT_SMOOTHING 2
+// the anchor moves by 1 / 2^CLOCK_OFFSET_SMOOTHING of the error, errors above CLOCK_STEP_US are stepped at once
+#define CLOCK_OFFSET_SMOOTHING 1
+#define CLOCK_STEP_US 100000
+
+typedef struct {
+    int64_t local_us;
+    int64_t real_us;            // microseconds since the epoch at local_us
+    int64_t drift_q32;          // (real rate / local rate - 1) * 2^32
+} clock_model_t;
+
+#define CLOCK_SLOTS 3
+
+// a published model, read while it may be rewritten, so its fields are relaxed atomics
+typedef struct {
+    std::atomic<int64_t> local_us;
+    std::atomic<int64_t> real_us;
+    std::atomic<int64_t> drift_q32;
+} clock_slot_t;
+
+typedef struct {
+    clock_slot_t slots[CLOCK_SLOTS];
+    std::atomic<uint32_t> seq;  // 2n once model n % CLOCK_SLOTS is published, 2n + 1 while the next is written
+    std::mutex sync_lock;       // everything below belongs to the task holding it
+    bool synced;
+    bool drift_known;
+    int64_t ref_local_us;       // sync point the next drift measurement starts from
+    int64_t ref_real_us;
+    uint32_t syncs;
+    int64_t last_error_us;      // how far the model was off at the last sync
+} clock_map_t;
+
+void _clock_slot_store(clock_slot_t *slot, const clock_model_t *model) {
+    slot->local_us.store(model->local_us, std::memory_order_relaxed);
+    slot->real_us.store(model->real_us, std::memory_order_relaxed);
+    slot->drift_q32.store(model->drift_q32, std::memory_order_relaxed);
+}
+
+clock_model_t _clock_slot_load(const clock_slot_t *slot) {
+    clock_model_t model;
+    model.local_us = slot->local_us.load(std::memory_order_relaxed);
+    model.real_us = slot->real_us.load(std::memory_order_relaxed);
+    model.drift_q32 = slot->drift_q32.load(std::memory_order_relaxed);
+    return model;
+}
+
+// until the first sync wall time is the local clock, like an unset system clock counting from boot
+void clock_map_init(clock_map_t *map) {
+    clock_model_t boot = {0, 0, 0};
+    _clock_slot_store(&map->slots[0], &boot);
+    map->seq.store(0, std::memory_order_release);
+    map->synced = false;
+    map->drift_known = false;
+    map->ref_local_us = 0;
+    map->ref_real_us = 0;
+    map->syncs = 0;
+    map->last_error_us = 0;
+}
+
+int64_t clock_model_real_us(const clock_model_t *model, int64_t local_us) {
+    int64_t d = local_us - model->local_us;
+    return model->real_us + d + ((d * model->drift_q32) >> CLOCK_DRIFT_SHIFT);
+}
+
+// copy of the published model, safe from any task
+clock_model_t clock_map_model(const clock_map_t *map) {
+    while (true) {
+        uint32_t seq = map->seq.load(std::memory_order_acquire);
+        uint32_t published = seq >> 1;
+        clock_model_t model = _clock_slot_load(&map->slots[published % CLOCK_SLOTS]);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // the copied slot is written again for model published + CLOCK_SLOTS, starting at this count
+        if (map->seq.load(std::memory_order_relaxed) < 2 * (published + CLOCK_SLOTS - 1) + 1) {
+            return model;
+        }
+    }
+}
+
+// wall time in microseconds since the epoch at the given local time, safe from any task
+int64_t clock_map_real_us(const clock_map_t *map, int64_t local_us) {
+    clock_model_t model = clock_map_model(map);
+    return clock_model_real_us(&model, local_us);
+}
+
+int64_t _clock_clamp_drift(int64_t drift_q32) {
+    const int64_t limit = ((int64_t) CLOCK_MAX_DRIFT_PPM << CLOCK_DRIFT_SHIFT) / 1000000;
+    return drift_q32 > limit ? limit : (drift_q32 < -limit ? -limit : drift_q32);
+}
+
+// the reference clock read real_us at local time local_us, safe from any task
+void clock_map_sync(clock_map_t *map, int64_t local_us, int64_t real_us) {
+    std::lock_guard<std::mutex> guard(map->sync_lock);
+    uint32_t seq = map->seq.load(std::memory_order_relaxed);
+    clock_model_t current = _clock_slot_load(&map->slots[(seq >> 1) % CLOCK_SLOTS]);
+    int64_t drift_q32 = current.drift_q32;
+    int64_t anchor_real_us = real_us;
+
+    if (map->synced) {
+        int64_t predicted = clock_model_real_us(&current, local_us);
+        map->last_error_us = real_us - predicted;
+        if (map->last_error_us < CLOCK_STEP_US && map->last_error_us > -CLOCK_STEP_US) {
+            anchor_real_us = predicted + (map->last_error_us >> CLOCK_OFFSET_SMOOTHING);
+        }
+        int64_t span = local_us - map->ref_local_us;
+        if (span >= CLOCK_MIN_DRIFT_SPAN_US) {
+            // syncs are rare, the measurement can afford a double
+            int64_t gained = (real_us - map->ref_real_us) - span;
+            int64_t measured = (int64_t) ((double) gained / span * 4294967296.0);
+            if (measured != _clock_clamp_drift(measured)) {
+                // the reference was stepped (time set by hand), start measuring again from here
+            } else if (map->drift_known) {
+                drift_q32 += (measured - drift_q32) >> CLOCK_DRIFT_SMOOTHING;
+            } else {
+                drift_q32 = measured;
+                map->drift_known = true;
+            }
+            map->ref_local_us = local_us;
+            map->ref_real_us = real_us;
+        }
+    } else {
+        // the first sync says nothing about drift, the local clock was not related to wall time before
+        map->synced = true;
+        map->ref_local_us = local_us;
+        map->ref_real_us = real_us;
+    }
+
+    // a reader that sees any of the new slot's fields also sees the odd count before them
+    map->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    clock_model_t next = {local_us, anchor_real_us, drift_q32};
+    _clock_slot_store(&map->slots[((seq >> 1) + 1) % CLOCK_SLOTS], &next);
+    map->seq.store(seq + 2, std::memory_order_release);
+    map->syncs++;
+}
+
+float clock_map_drift_ppm(const clock_map_t *map) {
+    return clock_map_model(map).drift_q32 * 1000000.0f / 4294967296.0f;
+}
+
+void clock_map_print(clock_map_t *map) {
+    std::lock_guard<std::mutex> guard(map->sync_lock);
+    printf("CLOCK: syncs=%u last error=%lldus drift=%.2fppm%s\n", map->syncs, (long long) map->last_error_us,
+           clock_map_drift_ppm(map), map->drift_known ? "" : " (not measured yet)");
+}
+
+#endif //ESP32_CSI_CLOCK_COMPONENT_H
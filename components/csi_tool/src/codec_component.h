@@ -0,0 +1,288 @@
+#ifndef ESP32_CSI_CODEC_COMPONENT_H
+#define ESP32_CSI_CODEC_COMPONENT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include "record_component.h"
+
+/*
+ * Delta codec for the iq bytes of binary records. On a static link
+ * consecutive frames differ by a few steps per value, so every frame is
+ * stored as the difference to the previous frame of the same transmitter and
+ * LTF layout, which puts each byte against the same segment and subcarrier.
+ * Differences are zigzag mapped (0, -1, 1, -2, ... to 0, 1, 2, 3, ...) and
+ * packed in blocks of CODEC_BLOCK_LEN values, each block with the fewest bits
+ * that hold its largest value.
+ *
+ * A keyframe, packed against zero instead, starts every CODEC_KEYFRAME_INTERVAL
+ * frames of a link, so decoding a capture can begin anywhere and a corrupt
+ * record only loses frames up to the next keyframe.
+ *
+ * Packed payload:
+ *
+ *   offset  size  field
+ *   0       1     mode (bits 0-1) | context (bits 2-3)
+ *   1       1     frame number in the context, delta frames follow number - 1
+ *   2       ...   blocks of 1 byte bit width and ceil(n * width / 8) bytes of values,
+ *                 least significant bit first, or the raw iq bytes for CODEC_STORED
+ *
+ * Plain C++ without ESP-IDF dependencies, the host decoder in tools/ shares
+ * this file. Encoding and decoding each belong to one task.
+ */
+
+#ifdef CONFIG_CSI_COMPRESS_KEYFRAME_INTERVAL
+#define CODEC_KEYFRAME_INTERVAL CONFIG_CSI_COMPRESS_KEYFRAME_INTERVAL
+#else
+#define CODEC_KEYFRAME_INTERVAL 50
+#endif
+
+// links tracked at once, the least recently used one is replaced
+#define CODEC_CONTEXTS 4
+#define CODEC_BLOCK_LEN 16
+#define CODEC_HEADER_LEN 2
+// zigzag of a difference between two int8 values
+#define CODEC_MAX_WIDTH 9
+
+typedef enum {
+    CODEC_DELTA = 0,            // against the previous frame of the context
+    CODEC_KEY,                  // against zero
+    CODEC_STORED,               // raw, packing would have made it larger
+} codec_mode_t;
+
+typedef struct {
+    bool valid;
+    uint8_t mac[6];
+    uint8_t layout;
+    uint8_t seq;                // number of the last frame
+    uint16_t len;
+    uint32_t since_key;
+    uint32_t last_use;
+    int8_t prev[CSI_RECORD_MAX_DATA];
+} codec_context_t;
+
+typedef struct {
+    codec_context_t contexts[CODEC_CONTEXTS];
+    uint32_t keyframe_interval;
+    uint32_t uses;
+    std::atomic<uint32_t> frames;
+    std::atomic<uint32_t> keyframes;
+    std::atomic<uint32_t> lost;             // decoder only, delta frames without their reference
+    uint64_t raw_bytes;         // may tear when read from another task
+    uint64_t packed_bytes;
+    uint64_t cycles;            // spent encoding, added by the caller
+} csi_codec_t;
+
+void csi_codec_init(csi_codec_t *codec, uint32_t keyframe_interval) {
+    for (int i = 0; i < CODEC_CONTEXTS; i++) {
+        codec->contexts[i].valid = false;
+    }
+    codec->keyframe_interval = keyframe_interval > 0 ? keyframe_interval : 1;
+    codec->uses = 0;
+    codec->frames.store(0, std::memory_order_relaxed);
+    codec->keyframes.store(0, std::memory_order_relaxed);
+    codec->lost.store(0, std::memory_order_relaxed);
+    codec->raw_bytes = 0;
+    codec->packed_bytes = 0;
+    codec->cycles = 0;
+}
+
+// frames with the same key have the same segments at the same offsets
+uint8_t _codec_layout(const csi_record_t *rec) {
+    return (rec->secondary_channel & 3) | (rec->sig_mode & 3) << 2 | (rec->bandwidth & 1) << 4 | (rec->stbc & 3) << 5;
+}
+
+void _codec_inc(std::atomic<uint32_t> *counter) {
+    counter->store(counter->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+uint32_t _codec_zigzag(int32_t v) {
+    return ((uint32_t) v << 1) ^ (uint32_t) (v >> 31);
+}
+
+int32_t _codec_unzigzag(uint32_t z) {
+    return (int32_t) (z >> 1) ^ -(int32_t) (z & 1);
+}
+
+// reference value of byte i, bytes past the end of the previous frame are coded against zero
+int32_t _codec_ref(const codec_context_t *ctx, codec_mode_t mode, int i) {
+    return mode == CODEC_DELTA && i < ctx->len ? ctx->prev[i] : 0;
+}
+
+/*
+ * Pack the iq bytes of rec into out, which holds CSI_RECORD_MAX_PACKED bytes.
+ * Returns the packed length.
+ */
+size_t csi_codec_encode(csi_codec_t *codec, const csi_record_t *rec, uint8_t *out) {
+    uint8_t layout = _codec_layout(rec);
+    int slot = -1;
+    for (int i = 0; i < CODEC_CONTEXTS && slot < 0; i++) {
+        codec_context_t *c = &codec->contexts[i];
+        if (c->valid && c->layout == layout && memcmp(c->mac, rec->mac, 6) == 0) {
+            slot = i;
+        }
+    }
+    bool same_link = slot >= 0;
+    if (!same_link) {
+        slot = 0;
+        for (int i = 1; i < CODEC_CONTEXTS; i++) {
+            if (codec->contexts[slot].valid && (!codec->contexts[i].valid ||
+                                                codec->contexts[i].last_use < codec->contexts[slot].last_use)) {
+                slot = i;
+            }
+        }
+    }
+    codec_context_t *ctx = &codec->contexts[slot];
+    codec_mode_t mode = same_link && ctx->since_key < codec->keyframe_interval ? CODEC_DELTA : CODEC_KEY;
+
+    uint8_t seq = same_link ? ctx->seq + 1 : 0;
+    uint8_t *p = out + CODEC_HEADER_LEN;
+    uint8_t *stored_end = out + CODEC_HEADER_LEN + rec->len;
+    bool stored = false;
+    for (int start = 0; start < rec->len && !stored; start += CODEC_BLOCK_LEN) {
+        int n = rec->len - start < CODEC_BLOCK_LEN ? rec->len - start : CODEC_BLOCK_LEN;
+        uint32_t z[CODEC_BLOCK_LEN];
+        uint32_t any = 0;
+        for (int i = 0; i < n; i++) {
+            z[i] = _codec_zigzag(rec->data[start + i] - _codec_ref(ctx, mode, start + i));
+            any |= z[i];
+        }
+        int width = any == 0 ? 0 : 32 - __builtin_clz(any);
+        if (p + 1 + (n * width + 7) / 8 > stored_end) {
+            stored = true;
+            break;
+        }
+        *p++ = width;
+        uint32_t bits = 0;
+        int count = 0;
+        for (int i = 0; i < n; i++) {
+            bits |= z[i] << count;
+            count += width;
+            while (count >= 8) {
+                *p++ = bits;
+                bits >>= 8;
+                count -= 8;
+            }
+        }
+        if (count > 0) {
+            *p++ = bits;
+        }
+    }
+    if (stored) {
+        // noise does not pack, send it as it is
+        mode = CODEC_STORED;
+        memcpy(out + CODEC_HEADER_LEN, rec->data, rec->len);
+        p = stored_end;
+    }
+    out[0] = mode | slot << 2;
+    out[1] = seq;
+
+    ctx->valid = true;
+    memcpy(ctx->mac, rec->mac, 6);
+    ctx->layout = layout;
+    ctx->seq = seq;
+    ctx->len = rec->len;
+    ctx->since_key = mode == CODEC_DELTA ? ctx->since_key + 1 : 1;
+    ctx->last_use = ++codec->uses;
+    memcpy(ctx->prev, rec->data, rec->len);
+
+    _codec_inc(&codec->frames);
+    if (mode != CODEC_DELTA) {
+        _codec_inc(&codec->keyframes);
+    }
+    codec->raw_bytes += rec->len;
+    codec->packed_bytes += p - out;
+    return p - out;
+}
+
+/*
+ * Unpack a record decoded from a packed record into out (CSI_RECORD_MAX_DATA
+ * bytes) and point rec->data at it. Returns false for a delta frame whose
+ * reference was never seen, e.g. at the start of a capture, or a broken payload.
+ */
+bool csi_codec_decode(csi_codec_t *codec, csi_record_t *rec, int8_t *out) {
+    const uint8_t *p = (const uint8_t *) rec->data;
+    const uint8_t *end = p + rec->packed_len;
+    if (rec->packed_len < CODEC_HEADER_LEN || (p[0] & 3) > CODEC_STORED) {
+        return false;
+    }
+    codec_mode_t mode = (codec_mode_t) (p[0] & 3);
+    codec_context_t *ctx = &codec->contexts[(p[0] >> 2) & 3];
+    uint8_t seq = p[1];
+    uint8_t layout = _codec_layout(rec);
+    p += CODEC_HEADER_LEN;
+
+    if (mode == CODEC_DELTA && (!ctx->valid || ctx->layout != layout || memcmp(ctx->mac, rec->mac, 6) != 0 ||
+                                seq != (uint8_t) (ctx->seq + 1))) {
+        // the chain is broken, nothing decodes in this context until its next keyframe
+        ctx->valid = false;
+        _codec_inc(&codec->lost);
+        return false;
+    }
+
+    if (mode == CODEC_STORED) {
+        if (end - p != rec->len) {
+            return false;
+        }
+        memcpy(out, p, rec->len);
+    }
+    for (int start = 0; mode != CODEC_STORED && start < rec->len; start += CODEC_BLOCK_LEN) {
+        int n = rec->len - start < CODEC_BLOCK_LEN ? rec->len - start : CODEC_BLOCK_LEN;
+        if (p >= end || *p > CODEC_MAX_WIDTH || end - p - 1 < (n * *p + 7) / 8) {
+            ctx->valid = false;
+            return false;
+        }
+        int width = *p++;
+        uint32_t mask = (1u << width) - 1;
+        uint32_t bits = 0;
+        int count = 0;
+        for (int i = 0; i < n; i++) {
+            while (count < width) {
+                bits |= (uint32_t) *p++ << count;
+                count += 8;
+            }
+            out[start + i] = (int8_t) (_codec_unzigzag(bits & mask) + _codec_ref(ctx, mode, start + i));
+            bits >>= width;
+            count -= width;
+        }
+    }
+
+    ctx->valid = true;
+    memcpy(ctx->mac, rec->mac, 6);
+    ctx->layout = layout;
+    ctx->seq = seq;
+    ctx->len = rec->len;
+    memcpy(ctx->prev, out, rec->len);
+
+    _codec_inc(&codec->frames);
+    if (mode != CODEC_DELTA) {
+        _codec_inc(&codec->keyframes);
+    }
+    codec->raw_bytes += rec->len;
+    codec->packed_bytes += rec->packed_len;
+    rec->data = out;
+    rec->packed_len = 0;
+    return true;
+}
+
+// pack rec and serialize it as a version 2 record, returns 0 if it does not fit into cap bytes
+size_t csi_codec_encode_record(csi_codec_t *codec, const csi_record_t *rec, uint8_t *out, size_t cap) {
+    static uint8_t packed[CSI_RECORD_MAX_PACKED];
+    if (rec->len > CSI_RECORD_MAX_DATA) {
+        return 0;
+    }
+    size_t len = csi_codec_encode(codec, rec, packed);
+    return csi_record_encode_packed(rec, packed, len, out, cap);
+}
+
+void csi_codec_print_stats(const csi_codec_t *codec) {
+    uint32_t frames = codec->frames.load(std::memory_order_relaxed);
+    printf("CODEC: frames=%u keyframes=%u raw=%llu packed=%llu ratio=%.2f cycles/frame=%llu\n", frames,
+           codec->keyframes.load(std::memory_order_relaxed), (unsigned long long) codec->raw_bytes,
+           (unsigned long long) codec->packed_bytes,
+           codec->packed_bytes > 0 ? (double) codec->raw_bytes / codec->packed_bytes : 0.0,
+           (unsigned long long) (frames > 0 ? codec->cycles / frames : 0));
+}
+
+#endif //ESP32_CSI_CODEC_COMPONENT_H
@@ -0,0 +1,143 @@
+#ifndef ESP32_CSI_COMMAND_COMPONENT_H
+#define ESP32_CSI_COMMAND_COMPONENT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+
+/*
+ * Line assembler and command table for the serial console.
+ * Bytes arrive in arbitrary chunks, complete lines are looked up by their
+ * first word (case insensitive, a trailing ':' is allowed as in "SETTIME:")
+ * and the handler gets the rest of the line. Lines longer than the buffer
+ * or cut by lost bytes are dropped as a whole instead of being run in parts.
+ *
+ * Plain C++ without ESP-IDF dependencies, so the parser can be fed
+ * arbitrary bytes on the host.
+ */
+
+#define COMMAND_LINE_LEN 256
+#define COMMAND_MAX 16
+#define COMMAND_NAME_LEN 16
+
+typedef void (*command_handler_t)(char *args);
+
+typedef struct {
+    const char *name;
+    const char *usage;
+    command_handler_t handler;
+} command_t;
+
+typedef struct {
+    command_t commands[COMMAND_MAX];
+    uint8_t count;
+} command_table_t;
+
+typedef struct {
+    char buf[COMMAND_LINE_LEN];
+    uint16_t len;
+    bool discard;               // the current line is broken, drop everything up to its end
+} command_line_t;
+
+bool command_register(command_table_t *table, const char *name, const char *usage, command_handler_t handler) {
+    if (table->count >= COMMAND_MAX || strlen(name) >= COMMAND_NAME_LEN) {
+        return false;
+    }
+    command_t *c = &table->commands[table->count++];
+    c->name = name;
+    c->usage = usage;
+    c->handler = handler;
+    return true;
+}
+
+const command_t *command_find(const command_table_t *table, const char *name) {
+    for (int i = 0; i < table->count; i++) {
+        if (strcasecmp(table->commands[i].name, name) == 0) {
+            return &table->commands[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Run the command on one line, modifies line.
+ * Returns false for unknown commands, empty lines are ignored.
+ */
+bool command_dispatch(const command_table_t *table, char *line) {
+    while (*line == ' ' || *line == '\t') {
+        line++;
+    }
+    if (*line == '\0') {
+        return true;
+    }
+
+    char name[COMMAND_NAME_LEN];
+    size_t n = strcspn(line, " \t:");
+    if (n >= COMMAND_NAME_LEN) {
+        return false;
+    }
+    memcpy(name, line, n);
+    name[n] = '\0';
+
+    char *args = line + n;
+    if (*args == ':') {
+        args++;
+    }
+    while (*args == ' ' || *args == '\t') {
+        args++;
+    }
+    size_t end = strlen(args);
+    while (end > 0 && (args[end - 1] == ' ' || args[end - 1] == '\t')) {
+        args[--end] = '\0';
+    }
+
+    const command_t *c = command_find(table, name);
+    if (c == NULL) {
+        return false;
+    }
+    c->handler(args);
+    return true;
+}
+
+void command_print_help(const command_table_t *table) {
+    for (int i = 0; i < table->count; i++) {
+        const command_t *c = &table->commands[i];
+        printf("  %s%s%s\n", c->name, *c->usage != '\0' ? " " : "", c->usage);
+    }
+}
+
+// feed received bytes, dispatches every line completed by \n or \r
+void command_feed(command_line_t *line, const command_table_t *table, const char *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        char ch = data[i];
+        if (ch == '\n' || ch == '\r') {
+            if (line->discard) {
+                printf("Input line dropped, it was cut, longer than %d characters or not text\n", COMMAND_LINE_LEN - 1);
+            } else {
+                line->buf[line->len] = '\0';
+                if (!command_dispatch(table, line->buf)) {
+                    printf("Unable to handle input %s, HELP lists the commands\n", line->buf);
+                }
+            }
+            line->len = 0;
+            line->discard = false;
+        } else if (ch == '\0') {
+            // would end the line early for the string functions
+            line->discard = true;
+        } else if (line->len < COMMAND_LINE_LEN - 1) {
+            line->buf[line->len++] = ch;
+        } else {
+            line->discard = true;
+        }
+    }
+}
+
+// the uart lost bytes, drop the line they belonged to
+void command_line_discard(command_line_t *line) {
+    line->len = 0;
+    line->discard = true;
+}
+
+#endif //ESP32_CSI_COMMAND_COMPONENT_H
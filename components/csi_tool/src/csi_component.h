@@ -1,90 +1,211 @@
 #ifndef ESP32_CSI_CSI_COMPONENT_H
 #define ESP32_CSI_CSI_COMPONENT_H
 
+#include "esp_wifi.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "time_component.h"
+#include "ring_component.h"
+#include "record_component.h"
+#include "codec_component.h"
+#include "csv_component.h"
+#include "stats_component.h"
+#include "stream_component.h"
+#include "output_component.h"
+#include "mac_filter_component.h"
+#include "diag_component.h"
+#include "hal/cpu_hal.h"
 #include "math.h"
 #include <sstream>
 #include <iostream>
 
-#define QUEUE_LEN 1
+// filter used until one is configured over serial and persisted
 #define MAC_AP "7C:9E:BD:65:B2:3D"
 #define USE_MAC_FILTER true
 
+#if defined CONFIG_CSI_RING_DROP_NEWEST
+#define CSI_RING_POLICY CSI_RING_DROP_NEWEST
+#else
+#define CSI_RING_POLICY CSI_RING_DROP_OLDEST
+#endif
+
 char *project_type;
-SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
 
-// initialize and allocate memory for queue to place the csi data in
-const QueueHandle_t data_queue = xQueueCreate(QUEUE_LEN, sizeof(wifi_csi_info_t));  // Queue erstellen
+// preallocated frames handed from the csi callback to the consumer
+csi_ring_t csi_ring;
+// task draining the ring, woken by the callback for every queued frame
+std::atomic<TaskHandle_t> csi_consumer(NULL);
+
+#ifdef CONFIG_CSI_COMPRESS
+// delta state of the binary records written to serial and SD, only used by the ring consumer
+csi_codec_t csi_codec;
+#endif
 
 // csi cb function is called everytime a csi paket is received 
+// runs in the wifi task, so it must never block or allocate
 void _wifi_csi_cb(void *ctx, wifi_csi_info_t *data) 
 {  
-    // take sephamore to no be inerrupted
-    xSemaphoreTake(mutex, portMAX_DELAY);
+    int64_t rx_us = esp_timer_get_time();
 
-    // extract mac adress from csi packet
-    char mac_sta[20];
-    sprintf(mac_sta, "%02X:%02X:%02X:%02X:%02X:%02X", data[0].mac[0], data[0].mac[1], data[0].mac[2], data[0].mac[3], data[0].mac[4], data[0].mac[5]);
+    // if paket is from desired AP, copy it into the ring
+    if (mac_filter_accept(data->mac)) {
+        TaskHandle_t consumer = csi_consumer.load(std::memory_order_acquire);
+        if (csi_ring_push(&csi_ring, data, rx_us) && consumer != NULL) {
+            xTaskNotifyGive(consumer);
+        }
+    } else {
+        stats_drop(STATS_DROP_MAC_FILTER, 1);
+    }
+    stats_record(STATS_STAGE_CALLBACK, esp_timer_get_time() - rx_us);
+}
 
-    // bool for mac filter
-    int mac_filter = 0;
-    if (USE_MAC_FILTER) {
-        mac_filter = strcmp(mac_sta, MAC_AP);
+// take the oldest frame from the ring, returns false if there is none
+bool csi_receive(csi_frame_t *frame)
+{
+    if (!csi_ring_pop(&csi_ring, frame)) {
+        return false;
     }
 
-    // if space in queue and paket is from desired AP
-    if (uxQueueSpacesAvailable(data_queue) > 0 && mac_filter == 0) {  // wennn platz platz in Queue
-        // allocate persistent memory for data to be placed into
-        wifi_csi_info_t *csi = (wifi_csi_info_t *)malloc(sizeof(wifi_csi_info_t));
+    stats_record(STATS_STAGE_QUEUE, esp_timer_get_time() - frame->rx_us);
+    return true;
+}
 
-        if (csi != NULL || csi->buf != NULL) {   // memory allocation went through
+// dump latency histograms, drop counters and output statistics
+void csi_print_stats()
+{
+    stats_print();
+    printf("STATS ring: pushed=%u overflows=%u truncated=%u pending=%u\n", csi_ring.pushed.load(),
+           csi_ring.overflows.load(), csi_ring.truncated.load(), csi_ring_count(&csi_ring));
+    output_print_stats();
+    sd_print_stats();
+    stream_print_stats();
+#ifdef CONFIG_CSI_COMPRESS
+    csi_codec_print_stats(&csi_codec);
+#endif
+}
 
-            // deepcopy of the data into new memory
-            csi->buf = data->buf;
-            memcpy(csi, data, sizeof(wifi_csi_info_t));
+// fill a portable record from a ring frame, the payload is not copied
+void csi_frame_to_record(const csi_frame_t *frame, csi_record_t *rec)
+{
+    const wifi_pkt_rx_ctrl_t *rx = &frame->rx_ctrl;
 
-            // place pointer to the data into queue
-            if (xQueueSend(data_queue, &csi, portMAX_DELAY) == pdPASS) {
-                printf("CSI data was placed into queue.. \n");
-            }
-            else {
-                free(csi);
-            }
-        }
-        else {
-            free(csi);
-        }
+    memset(rec->role, 0, sizeof(rec->role));
+    if (project_type != NULL) {
+        memcpy(rec->role, project_type, strnlen(project_type, sizeof(rec->role)));
     }
-    xSemaphoreGive(mutex);      // give mutex back
+    memcpy(rec->mac, frame->mac, sizeof(rec->mac));
+    rec->rssi = rx->rssi;
+    rec->rate = rx->rate;
+    rec->sig_mode = rx->sig_mode;
+    rec->mcs = rx->mcs;
+    rec->bandwidth = rx->cwb;
+    rec->smoothing = rx->smoothing;
+    rec->not_sounding = rx->not_sounding;
+    rec->aggregation = rx->aggregation;
+    rec->stbc = rx->stbc;
+    rec->fec_coding = rx->fec_coding;
+    rec->sgi = rx->sgi;
+    rec->noise_floor = rx->noise_floor;
+    rec->ampdu_cnt = rx->ampdu_cnt;
+    rec->channel = rx->channel;
+    rec->secondary_channel = rx->secondary_channel;
+    rec->local_timestamp = rx->timestamp;
+    rec->ant = rx->ant;
+    rec->sig_len = rx->sig_len;
+    rec->rx_state = rx->rx_state;
+    rec->real_time_set = real_time_set;
+    rec->real_timestamp = clock_map_real_us(&csi_clock, frame->rx_us);
+    rec->len = frame->len;
+    rec->data = frame->buf;
+    rec->packed_len = 0;
+}
+
+// write one received frame to the configured outputs
+void csi_output_frame(const csi_frame_t *frame)
+{
+#ifndef CONFIG_SEND_CSI_BINARY
+    if (stream_sink() == NULL && !output_active()) {
+        return;
+    }
+#endif
+    csi_record_t rec;
+    csi_frame_to_record(frame, &rec);
+    stream_frame(&rec);
+
+#ifdef CONFIG_SEND_CSI_BINARY
+    static uint8_t record_buf[CSI_RECORD_HEADER_LEN + CSI_RECORD_FIXED_LEN + CODEC_HEADER_LEN + CSI_MAX_LEN + CSI_RECORD_CRC_LEN];
+#ifdef CONFIG_CSI_COMPRESS
+    uint32_t start = cpu_hal_get_cycle_count();
+    size_t len = csi_codec_encode_record(&csi_codec, &rec, record_buf, sizeof(record_buf));
+    csi_codec.cycles += cpu_hal_get_cycle_count() - start;
+#else
+    size_t len = csi_record_encode(&rec, record_buf, sizeof(record_buf));
+#endif
+    if (len > 0) {
+        outwrite_frame(record_buf, len);
+    }
+#else
+    static char csv_line[CSV_LINE_LEN(CSI_MAX_LEN)];
+    size_t len = csv_format_row(&rec, csv_line, sizeof(csv_line));
+    if (len > 0) {
+        outwrite_frame(csv_line, len);
+    }
+#endif
 }
 
 void _print_csi_csv_header()
 {
-    char *header_str = (char *)"type,role,mac,rssi,rate,sig_mode,mcs,bandwidth,smoothing,not_sounding,aggregation,stbc,fec_coding,sgi,noise_floor,ampdu_cnt,channel,secondary_channel,local_timestamp,ant,sig_len,rx_state,real_time_set,real_timestamp,len,CSI_DATA\n";
-    outprintf(header_str);
+    outwrite(CSV_HEADER, sizeof(CSV_HEADER) - 1);
 }
 
 void csi_init(char *type)
 {
     project_type = type;
+    clock_map_init(&csi_clock);
+#ifdef CONFIG_CSI_COMPRESS
+    csi_codec_init(&csi_codec, CODEC_KEYFRAME_INTERVAL);
+#endif
+    csi_ring_init(&csi_ring, CSI_RING_POLICY);
+    diag_register_ring(&csi_ring);
+#ifdef CONFIG_SEND_CSI_TO_SERIAL
+    output_add_sink("serial", OUTPUT_SERIAL, &output_file_write, stdout, OUTPUT_SERIAL_POLICY, OUTPUT_SERIAL_SAMPLE_N);
+#endif
+    mac_filter_init(USE_MAC_FILTER ? MAC_FILTER_ALLOW : MAC_FILTER_OFF, MAC_AP);
 
 #ifdef CONFIG_SHOULD_COLLECT_CSI
+#ifdef CONFIG_CSI_REPLAY
+    // frames come from replay_task instead, the ring only allows a single producer
+#else
     ESP_ERROR_CHECK(esp_wifi_set_csi(1));
 
     // @See: https://github.com/espressif/esp-idf/blob/master/components/esp_wifi/include/esp_wifi_types.h#L401
     wifi_csi_config_t configuration_csi;
     configuration_csi.lltf_en = 1;
+#ifdef CONFIG_SHOULD_COLLECT_ONLY_LLTF
+    configuration_csi.htltf_en = 0;
+    configuration_csi.stbc_htltf2_en = 0;
+#else
     configuration_csi.htltf_en = 1;
     configuration_csi.stbc_htltf2_en = 1;
+#endif
     configuration_csi.ltf_merge_en = 1;
     configuration_csi.channel_filter_en = 0;
     configuration_csi.manu_scale = 0;
 
     ESP_ERROR_CHECK(esp_wifi_set_csi_config(&configuration_csi));
     ESP_ERROR_CHECK(esp_wifi_set_csi_rx_cb(&_wifi_csi_cb, NULL));
+#endif
 
+#ifdef CONFIG_SEND_CSI_BINARY
+#ifdef CONFIG_SEND_CSI_TO_SERIAL
+    // binary records must not get \n expanded to \r\n on the console
+    esp_vfs_dev_uart_set_tx_line_endings(ESP_LINE_ENDINGS_LF);
+#endif
+#else
     _print_csi_csv_header();
 #endif
+#endif
 }
 
 #endif  // ESP32_CSI_CSI_COMPONENT_H
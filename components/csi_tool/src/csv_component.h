@@ -0,0 +1,145 @@
+#ifndef ESP32_CSI_CSV_COMPONENT_H
+#define ESP32_CSI_CSV_COMPONENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "record_component.h"
+
+/*
+ * CSV rows of the capture schema, one per frame, formatted into the
+ * caller's line buffer without printf or the heap, so a row costs a pass
+ * over the iq bytes and the outputs get the whole line in one write.
+ * Numbers are converted by hand with 32 bit arithmetic, the ESP32 has no
+ * 64 bit divide and the timestamp needs the only one per row.
+ *
+ * Plain C++ without ESP-IDF dependencies, the host decoder in tools/ shares
+ * this file, so device and decoder write the same rows byte for byte.
+ */
+
+static const char CSV_HEADER[] = "type,role,mac,rssi,rate,sig_mode,mcs,bandwidth,smoothing,not_sounding,aggregation,stbc,fec_coding,sgi,noise_floor,ampdu_cnt,channel,secondary_channel,local_timestamp,ant,sig_len,rx_state,real_time_set,real_timestamp,len,CSI_DATA\n";
+
+// everything up to the iq array, with room to spare, and the brackets, newline and terminator after it
+#define CSV_META_LEN 320
+// line buffer for a row of n iq bytes, each at most "-128 "
+#define CSV_LINE_LEN(n) (CSV_META_LEN + 5 * (n))
+
+char *_csv_uint(char *p, uint32_t v) {
+    char digits[10];
+    int n = 0;
+    do {
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v != 0);
+    while (n > 0) {
+        *p++ = digits[--n];
+    }
+    return p;
+}
+
+char *_csv_int(char *p, int32_t v) {
+    if (v < 0) {
+        *p++ = '-';
+        return _csv_uint(p, 0u - (uint32_t) v);
+    }
+    return _csv_uint(p, v);
+}
+
+// one iq value, at most 3 digits and never above 128
+char *_csv_iq(char *p, int8_t v) {
+    uint32_t u = v;
+    if (v < 0) {
+        *p++ = '-';
+        u = -(int32_t) v;
+    }
+    if (u >= 100) {
+        *p++ = '1';
+        u -= 100;
+        *p++ = '0' + u / 10;
+        *p++ = '0' + u % 10;
+    } else if (u >= 10) {
+        *p++ = '0' + u / 10;
+        *p++ = '0' + u % 10;
+    } else {
+        *p++ = '0' + u;
+    }
+    return p;
+}
+
+char *_csv_field(char *p, int32_t v) {
+    p = _csv_int(p, v);
+    *p++ = ',';
+    return p;
+}
+
+/*
+ * Format rec as one terminated CSV row ending in \n into out.
+ * Returns the length without the terminator, or 0 if cap is below
+ * CSV_LINE_LEN(rec->len) or the iq bytes are still packed.
+ */
+size_t csv_format_row(const csi_record_t *rec, char *out, size_t cap) {
+    static const char HEX[] = "0123456789ABCDEF";
+    if (cap < (size_t) CSV_LINE_LEN(rec->len) || rec->packed_len != 0) {
+        return 0;
+    }
+    char *p = out;
+    memcpy(p, "CSI_DATA,", 9);
+    p += 9;
+    for (int i = 0; i < 4 && rec->role[i] != '\0'; i++) {
+        *p++ = rec->role[i];
+    }
+    *p++ = ',';
+    for (int i = 0; i < 6; i++) {
+        *p++ = HEX[rec->mac[i] >> 4];
+        *p++ = HEX[rec->mac[i] & 0xF];
+        *p++ = i < 5 ? ':' : ',';
+    }
+
+    p = _csv_field(p, rec->rssi);
+    p = _csv_field(p, rec->rate);
+    p = _csv_field(p, rec->sig_mode);
+    p = _csv_field(p, rec->mcs);
+    p = _csv_field(p, rec->bandwidth);
+    p = _csv_field(p, rec->smoothing);
+    p = _csv_field(p, rec->not_sounding);
+    p = _csv_field(p, rec->aggregation);
+    p = _csv_field(p, rec->stbc);
+    p = _csv_field(p, rec->fec_coding);
+    p = _csv_field(p, rec->sgi);
+    p = _csv_field(p, rec->noise_floor);
+    p = _csv_field(p, rec->ampdu_cnt);
+    p = _csv_field(p, rec->channel);
+    p = _csv_field(p, rec->secondary_channel);
+    p = _csv_uint(p, rec->local_timestamp);
+    *p++ = ',';
+    p = _csv_field(p, rec->ant);
+    p = _csv_field(p, rec->sig_len);
+    p = _csv_field(p, rec->rx_state);
+    p = _csv_field(p, rec->real_time_set);
+
+    // seconds fit 32 bits until 2106, the one 64 bit division per row
+    uint32_t sec = rec->real_timestamp / 1000000;
+    uint32_t usec = rec->real_timestamp - (uint64_t) sec * 1000000;
+    p = _csv_uint(p, sec);
+    *p++ = '.';
+    for (uint32_t div = 100000; div > 0; div /= 10) {
+        *p++ = '0' + usec / div % 10;
+    }
+    *p++ = ',';
+    p = _csv_field(p, rec->len);
+
+    *p++ = '[';
+    for (int i = 0; i < rec->len; i++) {
+        p = _csv_iq(p, rec->data[i]);
+        *p++ = ' ';
+    }
+    if (rec->len > 0) {
+        p--;
+    }
+    *p++ = ']';
+    *p++ = '\n';
+    *p = '\0';
+    return p - out;
+}
+
+#endif //ESP32_CSI_CSV_COMPONENT_H
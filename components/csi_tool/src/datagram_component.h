@@ -0,0 +1,116 @@
+#ifndef ESP32_CSI_DATAGRAM_COMPONENT_H
+#define ESP32_CSI_DATAGRAM_COMPONENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * UDP datagram carrying a batch of binary CSI records (record_component.h).
+ * Plain C++ without ESP-IDF dependencies, shared with the receiver in tools/.
+ *
+ *   offset  size  field
+ *   0       2     magic 0xC5 0x5D
+ *   2       1     version
+ *   3       1     record count n
+ *   4       4     datagram sequence number (u32, little endian)
+ *   8       4     sequence number of the first frame (u32, little endian)
+ *   12      ...   n records, frame sequence numbers are consecutive
+ *
+ * A gap in the datagram sequence means datagrams lost on the way or dropped
+ * by a full stream queue on the sender. A gap in the frame sequence also
+ * counts frames the sender skipped before packing them.
+ *
+ * Motion events (motion_component.h) go to the same collector in datagrams
+ * of their own, outside the datagram sequence:
+ *
+ *   offset  size  field
+ *   0       2     magic 0xC5 0x4D
+ *   2       1     version
+ *   3       1     state, 1 motion, 0 still
+ *   4       4     event sequence number (u32, little endian)
+ *   8       8     real timestamp of the frame that changed the state (u64, us)
+ *   16      2     variance score (u16, permille)
+ *   18      2     change score (u16, permille)
+ */
+
+#define CSI_DATAGRAM_MAGIC0 0xC5
+#define CSI_DATAGRAM_MAGIC1 0x5D
+#define CSI_DATAGRAM_VERSION 1
+#define CSI_DATAGRAM_HEADER_LEN 12
+#define CSI_EVENT_MAGIC1 0x4D
+#define CSI_EVENT_LEN 20
+
+typedef struct {
+    uint8_t count;
+    uint32_t seq;
+    uint32_t first_frame;
+} csi_datagram_header_t;
+
+void _csi_datagram_put_u32(uint8_t *p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+uint32_t _csi_datagram_get_u32(const uint8_t *p) {
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+void csi_datagram_write_header(const csi_datagram_header_t *header, uint8_t *out) {
+    out[0] = CSI_DATAGRAM_MAGIC0;
+    out[1] = CSI_DATAGRAM_MAGIC1;
+    out[2] = CSI_DATAGRAM_VERSION;
+    out[3] = header->count;
+    _csi_datagram_put_u32(out + 4, header->seq);
+    _csi_datagram_put_u32(out + 8, header->first_frame);
+}
+
+// returns false for anything that is not a datagram of this version
+bool csi_datagram_read_header(const uint8_t *buf, size_t len, csi_datagram_header_t *header) {
+    if (len < CSI_DATAGRAM_HEADER_LEN || buf[0] != CSI_DATAGRAM_MAGIC0 || buf[1] != CSI_DATAGRAM_MAGIC1 ||
+        buf[2] != CSI_DATAGRAM_VERSION) {
+        return false;
+    }
+    header->count = buf[3];
+    header->seq = _csi_datagram_get_u32(buf + 4);
+    header->first_frame = _csi_datagram_get_u32(buf + 8);
+    return true;
+}
+
+typedef struct {
+    uint8_t motion;
+    uint32_t seq;
+    uint64_t real_timestamp;
+    uint16_t variance;
+    uint16_t change;
+} csi_event_t;
+
+void csi_event_write(const csi_event_t *event, uint8_t *out) {
+    out[0] = CSI_DATAGRAM_MAGIC0;
+    out[1] = CSI_EVENT_MAGIC1;
+    out[2] = CSI_DATAGRAM_VERSION;
+    out[3] = event->motion;
+    _csi_datagram_put_u32(out + 4, event->seq);
+    _csi_datagram_put_u32(out + 8, event->real_timestamp);
+    _csi_datagram_put_u32(out + 12, event->real_timestamp >> 32);
+    out[16] = event->variance;
+    out[17] = event->variance >> 8;
+    out[18] = event->change;
+    out[19] = event->change >> 8;
+}
+
+bool csi_event_read(const uint8_t *buf, size_t len, csi_event_t *event) {
+    if (len != CSI_EVENT_LEN || buf[0] != CSI_DATAGRAM_MAGIC0 || buf[1] != CSI_EVENT_MAGIC1 ||
+        buf[2] != CSI_DATAGRAM_VERSION) {
+        return false;
+    }
+    event->motion = buf[3];
+    event->seq = _csi_datagram_get_u32(buf + 4);
+    event->real_timestamp = _csi_datagram_get_u32(buf + 8) | (uint64_t) _csi_datagram_get_u32(buf + 12) << 32;
+    event->variance = buf[16] | buf[17] << 8;
+    event->change = buf[18] | buf[19] << 8;
+    return true;
+}
+
+#endif //ESP32_CSI_DATAGRAM_COMPONENT_H
@@ -0,0 +1,100 @@
+#ifndef ESP32_CSI_DIAG_COMPONENT_H
+#define ESP32_CSI_DIAG_COMPONENT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "ring_component.h"
+
+/*
+ * Memory diagnostics for long running deployments: free heap and its low
+ * water mark, the largest block malloc could still hand out (falls behind
+ * the free heap when it fragments), the stack every task never touched and
+ * the occupancy of the frame ring, whose preallocated slots are the pool
+ * every received frame is copied into. Printed every DIAG_INTERVAL_S
+ * seconds and by the DIAG console command.
+ *
+ * Tasks and the ring are registered when they are created at startup, all
+ * from one task.
+ */
+
+#ifdef CONFIG_CSI_DIAG_INTERVAL
+#define DIAG_INTERVAL_S CONFIG_CSI_DIAG_INTERVAL
+#else
+#define DIAG_INTERVAL_S 300
+#endif
+
+#define DIAG_MAX_TASKS 12
+#define DIAG_TASK_STACK 3072
+
+typedef struct {
+    TaskHandle_t handle;
+    const char *name;
+    uint32_t stack;             // bytes given to xTaskCreate
+} diag_task_t;
+
+diag_task_t diag_tasks[DIAG_MAX_TASKS];
+std::atomic<uint8_t> diag_task_count(0);
+std::atomic<const csi_ring_t *> diag_ring(NULL);
+
+// call right after creating a task, a NULL handle (creation failed) is ignored
+void diag_register_task(TaskHandle_t handle, const char *name, uint32_t stack) {
+    uint8_t n = diag_task_count.load(std::memory_order_relaxed);
+    if (handle == NULL || n >= DIAG_MAX_TASKS) {
+        return;
+    }
+    diag_tasks[n].handle = handle;
+    diag_tasks[n].name = name;
+    diag_tasks[n].stack = stack;
+    diag_task_count.store(n + 1, std::memory_order_release);
+}
+
+void diag_register_ring(const csi_ring_t *ring) {
+    diag_ring.store(ring, std::memory_order_release);
+}
+
+void diag_print() {
+    printf("DIAG heap: free=%u min free=%u largest block=%u dma free=%u\n",
+           (unsigned int) heap_caps_get_free_size(MALLOC_CAP_8BIT),
+           (unsigned int) heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+           (unsigned int) heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+           (unsigned int) heap_caps_get_free_size(MALLOC_CAP_DMA));
+
+    uint8_t tasks = diag_task_count.load(std::memory_order_acquire);
+    for (int i = 0; i < tasks; i++) {
+        const diag_task_t *t = &diag_tasks[i];
+        // bytes of stack that were never used since the task started
+        uint32_t unused = uxTaskGetStackHighWaterMark(t->handle);
+        printf("DIAG task %s: stack=%u used=%u free=%u\n", t->name, t->stack,
+               unused < t->stack ? t->stack - unused : 0, unused);
+    }
+
+    const csi_ring_t *ring = diag_ring.load(std::memory_order_acquire);
+    if (ring != NULL) {
+        printf("DIAG frame ring: slots=%u bytes=%u fill=%u high water=%u overflows=%u\n", CSI_RING_LEN,
+               (unsigned int) sizeof(ring->slots), csi_ring_count(ring), ring->high_water.load(std::memory_order_relaxed),
+               ring->overflows.load(std::memory_order_relaxed));
+    }
+}
+
+void diag_task(void *pvParameters) {
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(DIAG_INTERVAL_S * 1000));
+        diag_print();
+    }
+}
+
+// the periodic dump is off with DIAG_INTERVAL_S 0, DIAG still prints on request
+void diag_start() {
+    if (DIAG_INTERVAL_S == 0) {
+        return;
+    }
+    TaskHandle_t handle = NULL;
+    xTaskCreate(&diag_task, "diag", DIAG_TASK_STACK, NULL, 1, &handle);
+    diag_register_task(handle, "diag", DIAG_TASK_STACK);
+}
+
+#endif //ESP32_CSI_DIAG_COMPONENT_H
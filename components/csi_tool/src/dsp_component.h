@@ -0,0 +1,279 @@
+#ifndef ESP32_CSI_DSP_COMPONENT_H
+#define ESP32_CSI_DSP_COMPONENT_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "csi_component.h"
+#include "aggregate_component.h"
+#include "phase_component.h"
+#include "segment_component.h"
+#include "motion_component.h"
+
+/*
+ * Processing task between the csi ring and the display.
+ * It drains the ring, writes every frame to the outputs, aggregates the
+ * display window, runs the motion detector and publishes finished plot
+ * frames through a triple buffer.
+ * The gui task picks up the latest complete plot without ever blocking,
+ * and both tasks can run in parallel on different cores.
+ */
+
+#ifdef CONFIG_DSP_TASK_CORE
+#define DSP_TASK_CORE CONFIG_DSP_TASK_CORE
+#define DSP_TASK_PRIORITY CONFIG_DSP_TASK_PRIORITY
+#else
+#define DSP_TASK_CORE 0
+#define DSP_TASK_PRIORITY 5
+#endif
+
+#define DSP_TASK_STACK 4096
+#define DSP_DEFAULT_INTERVAL_MS 100
+#define DSP_MAX_INTERVAL_MS 3600000    // an hour, a window longer than that would never be drawn
+
+#ifdef CONFIG_CSI_PHASE_SMOOTHING
+#define DSP_PHASE_SMOOTHING CONFIG_CSI_PHASE_SMOOTHING
+#else
+#define DSP_PHASE_SMOOTHING 2
+#endif
+
+typedef enum {
+    DSP_PLOT_AMPLITUDE = 0,     // mean amplitude of the window
+    DSP_PLOT_PHASE,             // circular mean phase
+    DSP_PLOT_AMPLITUDE_STD,     // standard deviation of the amplitude
+    DSP_PLOT_WATERFALL,         // history of the mean amplitude, drawn by the gui
+    DSP_PLOT_COUNT,
+} dsp_plot_type_t;
+
+static const char *DSP_PLOT_NAMES[DSP_PLOT_COUNT] = {"amplitude", "phase", "amplitude_std", "waterfall"};
+
+// one finished display window
+typedef struct {
+    uint32_t seq;
+    dsp_plot_type_t type;
+    uint16_t subc;
+    csi_subc_map_t map;                     // subcarriers of the window, in buffer order
+    uint32_t frames;                        // frames aggregated into this window
+    int64_t rx_us;                          // reception of the newest frame
+    int16_t values[AGGREGATE_MAX_SUBC];     // line plot of type, 0 at the null subcarriers
+    float mean[AGGREGATE_MAX_SUBC];         // mean amplitude, always filled for the waterfall
+    int16_t low[AGGREGATE_MAX_SUBC];        // amplitude range of the window, filled for the amplitude plot
+    int16_t high[AGGREGATE_MAX_SUBC];
+} dsp_plot_t;
+
+// writer owns back, reader owns front, middle holds the last published slot
+#define DSP_TRIPLE_FRESH 0x4
+
+typedef struct {
+    dsp_plot_t slots[3];
+    std::atomic<uint8_t> middle;
+    uint8_t back;
+    uint8_t front;
+} dsp_triple_t;
+
+dsp_triple_t dsp_out;
+std::atomic<int> dsp_plot_type(DSP_PLOT_AMPLITUDE);
+std::atomic<uint32_t> dsp_interval_ms(DSP_DEFAULT_INTERVAL_MS);
+phase_sanitizer_t dsp_phase;
+#ifdef CONFIG_CSI_MOTION
+motion_t dsp_motion;
+#endif
+
+void dsp_triple_init(dsp_triple_t *tb) {
+    tb->front = 0;
+    tb->middle.store(1);
+    tb->back = 2;
+}
+
+dsp_plot_t *dsp_triple_back(dsp_triple_t *tb) {
+    return &tb->slots[tb->back];
+}
+
+// hand the back slot to the reader, take the previous middle slot as new back
+void dsp_triple_publish(dsp_triple_t *tb) {
+    tb->back = tb->middle.exchange(tb->back | DSP_TRIPLE_FRESH, std::memory_order_acq_rel) & 3;
+}
+
+// newest plot published since the last call, or NULL
+const dsp_plot_t *dsp_triple_latest(dsp_triple_t *tb) {
+    if (!(tb->middle.load(std::memory_order_relaxed) & DSP_TRIPLE_FRESH)) {
+        return NULL;
+    }
+    tb->front = tb->middle.exchange(tb->front, std::memory_order_acq_rel) & 3;
+    return &tb->slots[tb->front];
+}
+
+const dsp_plot_t *dsp_latest() {
+    return dsp_triple_latest(&dsp_out);
+}
+
+/*
+ * Sanitized mean phase of every subcarrier that carries data.
+ * Null subcarriers report a zero vector and are left out of the fit.
+ */
+void _dsp_compute_phase(const aggregate_t *agg, const csi_segment_t *layout, dsp_plot_t *plot) {
+    static int32_t phase[PHASE_MAX_SUBC];
+    static int16_t freq[PHASE_MAX_SUBC];
+    static int16_t slot[PHASE_MAX_SUBC];
+    int n = 0;
+
+    for (int j = 0; j < agg->subc; j++) {
+        int k = csi_segment_order(layout, j);
+        if (!aggregate_has_phase(agg, k)) {
+            continue;
+        }
+        phase[n] = aggregate_phase(agg, k);
+        freq[n] = csi_segment_index(layout, k);
+        slot[n] = j;
+        n++;
+    }
+    phase_sanitize(&dsp_phase, agg->subc, phase, freq, slot, n, phase);
+    for (int i = 0; i < n; i++) {
+        plot->values[slot[i]] = csi_angle_coord(phase[i]);
+    }
+}
+
+/*
+ * Plot values and mean amplitude in ascending subcarrier index order, so the
+ * spectrum is contiguous around DC. Null subcarriers come out as 0. The
+ * amplitude plot also carries the range of every subcarrier in the window.
+ */
+void dsp_compute(const aggregate_t *agg, dsp_plot_type_t type, dsp_plot_t *plot) {
+    uint16_t subc = agg->subc;
+    csi_segment_t layout;
+    layout.subc = subc;
+    layout.map = agg->map;
+
+    plot->type = type;
+    plot->subc = subc;
+    plot->map = agg->map;
+    plot->frames = agg->count;
+    plot->rx_us = agg->last_rx_us;
+    memset(plot->values, 0, subc * sizeof(int16_t));
+    for (int j = 0; j < subc; j++) {
+        plot->mean[j] = aggregate_mean(agg, csi_segment_order(&layout, j));
+    }
+
+    if (type == DSP_PLOT_PHASE) {
+#ifdef CONFIG_CSI_PHASE_RAW
+        for (int j = 0; j < subc; j++) {
+            plot->values[j] = aggregate_phase_coord(agg, csi_segment_order(&layout, j));
+        }
+#else
+        _dsp_compute_phase(agg, &layout, plot);
+#endif
+        return;
+    }
+    // the smoothed phase is stale once another plot was shown
+    phase_sanitizer_reset(&dsp_phase);
+
+    for (int j = 0; j < subc; j++) {
+        int k = csi_segment_order(&layout, j);
+        switch (type) {
+            case DSP_PLOT_AMPLITUDE:
+                plot->values[j] = aggregate_mean(agg, k) + 0.5f;
+                plot->low[j] = aggregate_min(agg, k);
+                plot->high[j] = aggregate_max(agg, k);
+                break;
+            case DSP_PLOT_AMPLITUDE_STD:
+                plot->values[j] = sqrtf(aggregate_variance(agg, k)) + 0.5f;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+/*
+ * Report a change of the motion state on serial as
+ *   MOTION,<1 motion | 0 still>,<event number>,<real timestamp>,<variance score>,<change score>
+ * and as an event datagram to the UDP collector, if streaming.
+ */
+void dsp_motion_event(const motion_t *m, int64_t rx_us) {
+    csi_event_t event;
+    event.motion = m->motion.load(std::memory_order_relaxed);
+    event.seq = m->events.load(std::memory_order_relaxed);
+    event.real_timestamp = clock_map_real_us(&csi_clock, rx_us);
+    event.variance = m->variance_score.load(std::memory_order_relaxed);
+    event.change = m->change_score.load(std::memory_order_relaxed);
+    printf("MOTION,%u,%u,%llu.%06llu,%u,%u\n", event.motion, event.seq,
+           (unsigned long long) (event.real_timestamp / 1000000), (unsigned long long) (event.real_timestamp % 1000000),
+           event.variance, event.change);
+
+    uint8_t buf[CSI_EVENT_LEN];
+    csi_event_write(&event, buf);
+    stream_send(buf, sizeof(buf));
+}
+
+void dsp_task(void *pvParameters) {
+    static csi_frame_t frame;
+    static aggregate_t window;
+    aggregate_reset(&window);
+    uint32_t seq = 0;
+    int64_t last_publish = esp_timer_get_time();
+
+    while (1) {
+        // sleep until a frame arrives or the window is due
+        int64_t interval_us = (int64_t) dsp_interval_ms.load(std::memory_order_relaxed) * 1000;
+        int64_t wait_us = last_publish + interval_us - esp_timer_get_time();
+        ulTaskNotifyTake(pdTRUE, wait_us > 0 ? pdMS_TO_TICKS(wait_us / 1000) + 1 : 0);
+
+        /* Log every frame and fold its LLTF, present in every layout, into the display window */
+        while (csi_receive(&frame)) {
+            csi_output_frame(&frame);
+            csi_segments_t segments;
+            if (!csi_parse_segments(&frame.rx_ctrl, frame.buf, frame.len, &segments) ||
+                !csi_has_segment(&segments, CSI_SEGMENT_LLTF)) {
+                stats_drop(STATS_DROP_LAYOUT, 1);
+                continue;
+            }
+            uint32_t pending = window.count;
+            int64_t fold_start = esp_timer_get_time();
+            if (!aggregate_add(&window, &segments.segment[CSI_SEGMENT_LLTF], frame.rx_us)) {
+                stats_drop(STATS_DROP_AGGREGATE_RESET, pending);
+            }
+#ifdef CONFIG_CSI_MOTION
+            if (motion_add(&dsp_motion, &segments.segment[CSI_SEGMENT_LLTF])) {
+                dsp_motion_event(&dsp_motion, frame.rx_us);
+            }
+#endif
+            stats_record(STATS_STAGE_FOLD, esp_timer_get_time() - fold_start);
+        }
+        stream_poll();
+
+        int64_t now = esp_timer_get_time();
+        if (now - last_publish < interval_us) {
+            continue;
+        }
+        last_publish = now;
+        if (window.count == 0) {
+            continue;
+        }
+
+        dsp_plot_t *plot = dsp_triple_back(&dsp_out);
+        dsp_compute(&window, (dsp_plot_type_t) dsp_plot_type.load(std::memory_order_relaxed), plot);
+        plot->seq = seq++;
+        dsp_triple_publish(&dsp_out);
+        aggregate_reset(&window);
+        stats_record(STATS_STAGE_WINDOW, esp_timer_get_time() - now);
+    }
+}
+
+// start the processing task and route the csi callback wake-ups to it
+void dsp_start() {
+    dsp_triple_init(&dsp_out);
+    phase_sanitizer_init(&dsp_phase, DSP_PHASE_SMOOTHING);
+#ifdef CONFIG_CSI_MOTION
+    motion_init(&dsp_motion, MOTION_ENTER, MOTION_EXIT);
+#endif
+    TaskHandle_t handle = NULL;
+    xTaskCreatePinnedToCore(&dsp_task, "dsp", DSP_TASK_STACK, NULL, DSP_TASK_PRIORITY, &handle, DSP_TASK_CORE);
+    csi_consumer.store(handle, std::memory_order_release);
+    diag_register_task(handle, "dsp", DSP_TASK_STACK);
+}
+
+#endif //ESP32_CSI_DSP_COMPONENT_H
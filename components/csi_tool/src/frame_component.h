@@ -0,0 +1,80 @@
+#ifndef ESP32_CSI_FRAME_COMPONENT_H
+#define ESP32_CSI_FRAME_COMPONENT_H
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Prebuilt 802.11 frames for raw injection with esp_wifi_80211_tx.
+ * Plain C++ without ESP-IDF dependencies, so frames can be checked on the host.
+ *
+ *   offset  size  field
+ *   0       2     frame control
+ *   2       2     duration, filled in by the hardware
+ *   4       6     address 1, receiver
+ *   10      6     address 2, transmitter
+ *   16      6     address 3, BSSID
+ *   22      2     sequence control, sequence number << 4 | fragment number
+ *   24      ...   body, empty for null data
+ *
+ * The template is built once, sending only rewrites the sequence control.
+ */
+
+#define FRAME_HEADER_LEN 24
+#define FRAME_MAX_LEN 32
+#define FRAME_SEQ_OFFSET 22
+#define FRAME_SEQ_MOD 4096
+
+// vendor specific action frame, category 127 with the Espressif OUI and a type not used by ESP-NOW
+#define FRAME_ACTION_CATEGORY 0x7F
+#define FRAME_ACTION_TYPE 0xC5
+
+typedef enum {
+    FRAME_NULL_DATA = 0,    // data frame without payload to the AP, ToDS set
+    FRAME_ACTION,           // vendor specific action frame, no association needed
+} frame_kind_t;
+
+typedef struct {
+    uint8_t buf[FRAME_MAX_LEN];
+    uint16_t len;
+    uint16_t seq;           // sequence number of the next frame, 12 bits
+} frame_template_t;
+
+// build a template addressed to the AP with the given BSSID, src is the MAC of the sending interface
+void frame_build(frame_template_t *t, frame_kind_t kind, const uint8_t *bssid, const uint8_t *src) {
+    memset(t, 0, sizeof(frame_template_t));
+    uint8_t *f = t->buf;
+    if (kind == FRAME_NULL_DATA) {
+        f[0] = 0x48;        // type data, subtype null
+        f[1] = 0x01;        // ToDS
+    } else {
+        f[0] = 0xD0;        // type management, subtype action
+        f[1] = 0x00;
+    }
+    memcpy(f + 4, bssid, 6);
+    memcpy(f + 10, src, 6);
+    memcpy(f + 16, bssid, 6);
+    t->len = FRAME_HEADER_LEN;
+
+    if (kind == FRAME_ACTION) {
+        static const uint8_t body[] = {FRAME_ACTION_CATEGORY, 0x18, 0xFE, 0x34, FRAME_ACTION_TYPE};
+        memcpy(f + FRAME_HEADER_LEN, body, sizeof(body));
+        t->len += sizeof(body);
+    }
+}
+
+uint16_t frame_seq(const uint8_t *frame) {
+    return (frame[FRAME_SEQ_OFFSET] | frame[FRAME_SEQ_OFFSET + 1] << 8) >> 4;
+}
+
+// stamp the next sequence number into the template and advance it, returns the stamped number
+uint16_t frame_next_seq(frame_template_t *t) {
+    uint16_t seq = t->seq;
+    uint16_t control = seq << 4;
+    t->buf[FRAME_SEQ_OFFSET] = control;
+    t->buf[FRAME_SEQ_OFFSET + 1] = control >> 8;
+    t->seq = (seq + 1) % FRAME_SEQ_MOD;
+    return seq;
+}
+
+#endif //ESP32_CSI_FRAME_COMPONENT_H
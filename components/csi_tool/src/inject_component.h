@@ -0,0 +1,83 @@
+#ifndef ESP32_CSI_INJECT_COMPONENT_H
+#define ESP32_CSI_INJECT_COMPONENT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "csi_component.h"
+#include "frame_component.h"
+#include "pacer_component.h"
+
+/*
+ * Triggers CSI on the AP with raw frames instead of UDP packets. Frames go
+ * straight to the driver with esp_wifi_80211_tx, skipping lwIP, sockets and
+ * the wait for an association and DHCP lease. Paced by packet_pacer, so
+ * RATE changes the injection rate the same way it does for UDP.
+ */
+
+#if defined CONFIG_CSI_INJECT_ACTION
+#define INJECT_FRAME FRAME_ACTION
+#else
+#define INJECT_FRAME FRAME_NULL_DATA
+#endif
+
+#ifdef CONFIG_CSI_INJECT_BSSID
+#define INJECT_BSSID CONFIG_CSI_INJECT_BSSID
+#else
+#define INJECT_BSSID MAC_AP
+#endif
+
+frame_template_t inject_frame;
+std::atomic<uint32_t> inject_tx_failed(0);
+
+// whether CONFIG_CSI_INJECT_BSSID is a MAC address, checked at startup before the task is created
+bool inject_bssid_valid() {
+    uint8_t bssid[6];
+    return mac_parse(INJECT_BSSID, bssid);
+}
+
+/*
+ * Build the frame template to the configured BSSID. Returns false, and
+ * injection must not start, if the BSSID does not parse.
+ */
+bool inject_init() {
+    uint8_t bssid[6];
+    uint8_t src[6];
+    if (!mac_parse(INJECT_BSSID, bssid)) {
+        return false;
+    }
+    esp_wifi_get_mac(WIFI_IF_STA, src);
+    frame_build(&inject_frame, INJECT_FRAME, bssid, src);
+    return true;
+}
+
+// runs after inject_init succeeded
+void inject_transmitter_loop() {
+    pacer_start(&packet_pacer, PACKET_RATE, PACER_MAX_BURST);
+    printf("injecting %s frames to %s.\n", INJECT_FRAME == FRAME_ACTION ? "action" : "null data", INJECT_BSSID);
+
+    while (1) {
+        uint32_t due = pacer_wait(&packet_pacer);
+        for (uint32_t i = 0; i < due; i++) {
+            frame_next_seq(&inject_frame);
+            // sequence numbers come from the template, not from the driver
+            if (esp_wifi_80211_tx(WIFI_IF_STA, inject_frame.buf, inject_frame.len, false) != ESP_OK) {
+                // out of tx buffers, the deadline stays due and is retried after a tick
+                inject_tx_failed.store(inject_tx_failed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                vTaskDelay(1);
+                break;
+            }
+            pacer_sent(&packet_pacer, esp_timer_get_time());
+        }
+    }
+}
+
+void inject_print_stats() {
+    printf("INJECT: next seq=%u tx failed=%u\n", inject_frame.seq, inject_tx_failed.load(std::memory_order_relaxed));
+}
+
+#endif //ESP32_CSI_INJECT_COMPONENT_H
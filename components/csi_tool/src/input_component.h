@@ -1,43 +1,281 @@
 #ifndef ESP32_CSI_INPUT_COMPONENT_H
 #define ESP32_CSI_INPUT_COMPONENT_H
 
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "driver/uart.h"
+#include "esp_vfs_dev.h"
 #include "csi_component.h"
+#include "dsp_component.h"
+#include "pacer_component.h"
+#include "inject_component.h"
+#include "command_component.h"
 
-char input_buffer[256];
-int input_buffer_pointer = 0;
+/*
+ * Serial console. The uart driver posts an event for received bytes and
+ * the input task, blocked on that queue otherwise, feeds them to the
+ * command table, so a running device can be retuned without reflashing.
+ */
 
-void _handle_input() {
-    if (match_set_timestamp_template(input_buffer)) {
-        printf("Setting local time to %s\n", input_buffer);
-        time_set(input_buffer);
+#ifdef CONFIG_ESP_CONSOLE_UART_NUM
+#define INPUT_UART_NUM CONFIG_ESP_CONSOLE_UART_NUM
+#else
+#define INPUT_UART_NUM 0
+#endif
+
+#define INPUT_RX_BUF_LEN 1024
+#define INPUT_EVENT_QUEUE_LEN 16
+#define INPUT_TASK_STACK 4096
+
+command_table_t input_commands;
+command_line_t input_line;
+QueueHandle_t input_uart_queue;
+
+// ON | OFF, anything else is -1
+int _input_on_off(const char *arg) {
+    if (strcasecmp(arg, "ON") == 0) {
+        return 1;
+    }
+    if (strcasecmp(arg, "OFF") == 0) {
+        return 0;
+    }
+    return -1;
+}
+
+void _handle_help_input(char *args) {
+    command_print_help(&input_commands);
+}
+
+void _handle_settime_input(char *args) {
+    printf("Setting local time to %s\n", args);
+    time_set(args);
+    clock_map_print(&csi_clock);
+}
+
+void _handle_stats_input(char *args) {
+    csi_print_stats();
+}
+
+void _handle_sdstats_input(char *args) {
+    sd_print_stats();
+}
+
+void _handle_diag_input(char *args) {
+    diag_print();
+}
+
+// MAC LIST | MAC ADD <mac> | MAC DEL <mac> | MAC CLEAR | MAC MODE ALLOW|DENY|OFF
+void _handle_mac_input(char *args) {
+    uint8_t mac[6];
+    if (strncasecmp(args, "LIST", 4) == 0) {
+        mac_filter_print();
+    } else if (strncasecmp(args, "ADD ", 4) == 0 && mac_parse(args + 4, mac)) {
+        if (!mac_filter_add(mac)) {
+            printf("MAC filter is full\n");
+        }
+        mac_filter_print();
+    } else if (strncasecmp(args, "DEL ", 4) == 0 && mac_parse(args + 4, mac)) {
+        mac_filter_remove(mac);
+        mac_filter_print();
+    } else if (strncasecmp(args, "CLEAR", 5) == 0) {
+        mac_filter_clear();
+        mac_filter_print();
+    } else if (strcasecmp(args, "MODE ALLOW") == 0) {
+        mac_filter_set_mode(MAC_FILTER_ALLOW);
+        mac_filter_print();
+    } else if (strcasecmp(args, "MODE DENY") == 0) {
+        mac_filter_set_mode(MAC_FILTER_DENY);
+        mac_filter_print();
+    } else if (strcasecmp(args, "MODE OFF") == 0) {
+        mac_filter_set_mode(MAC_FILTER_OFF);
+        mac_filter_print();
     } else {
-        printf("Unable to handle input %s\n", input_buffer);
+        printf("Unable to handle MAC command %s\n", args);
     }
 }
 
-void input_check() {
-    uint8_t ch = fgetc(stdin);
+// RATE prints the packet pacer, RATE <packets per second> changes its rate, 0 pauses
+void _handle_rate_input(char *args) {
+    char *end;
+    long rate = strtol(args, &end, 10);
+    if (end != args && *end == '\0' && rate >= 0 && rate <= PACER_MAX_RATE) {
+        pacer_set_rate(&packet_pacer, rate);
+    } else if (*args != '\0') {
+        printf("Unable to handle RATE command %s\n", args);
+        return;
+    }
+    pacer_print_stats(&packet_pacer);
+#ifdef CONFIG_CSI_INJECT
+    inject_print_stats();
+#endif
+}
 
-    while (ch != 0xFF) {
-        if (ch == '\n') {
-            _handle_input();
-            input_buffer[0] = '\0';
-            input_buffer_pointer = 0;
+// PLOT prints the plotted value, PLOT <name> changes it, the display follows
+void _handle_plot_input(char *args) {
+    if (*args != '\0') {
+        int type = -1;
+        for (int t = 0; t < DSP_PLOT_COUNT; t++) {
+            if (strcasecmp(args, DSP_PLOT_NAMES[t]) == 0) {
+                type = t;
+            }
+        }
+        if (type < 0) {
+            printf("Unable to handle PLOT command %s\n", args);
+            return;
+        }
+        dsp_plot_type = type;
+    }
+    printf("PLOT: %s\n", DSP_PLOT_NAMES[dsp_plot_type.load()]);
+}
+
+// INTERVAL prints the display window length, INTERVAL <ms> changes it
+void _handle_interval_input(char *args) {
+    char *end;
+    long ms = strtol(args, &end, 10);
+    if (end != args && *end == '\0' && ms > 0 && ms <= DSP_MAX_INTERVAL_MS) {
+        dsp_interval_ms = ms;
+    } else if (*args != '\0') {
+        printf("Unable to handle INTERVAL command %s\n", args);
+        return;
+    }
+    printf("INTERVAL: %u ms\n", dsp_interval_ms.load());
+}
+
+// BLOCK, DROP or SAMPLE <n> as the policy of a sink, false if the sink does not exist or the policy is unknown
+bool _input_output_policy(output_sink_t *sink, const char *value) {
+    if (sink == NULL) {
+        return false;
+    }
+    if (strcasecmp(value, "BLOCK") == 0) {
+        output_set_policy(sink, OUTPUT_POLICY_BLOCK, 1);
+    } else if (strcasecmp(value, "DROP") == 0) {
+        output_set_policy(sink, OUTPUT_POLICY_DROP, 1);
+    } else if (strncasecmp(value, "SAMPLE ", 7) == 0) {
+        char *end;
+        long n = strtol(value + 7, &end, 10);
+        if (end == value + 7 || *end != '\0' || n <= 0 || (unsigned long) n > UINT32_MAX) {
+            return false;
+        }
+        output_set_policy(sink, OUTPUT_POLICY_SAMPLE, n);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// OUTPUT prints the outputs, OUTPUT SERIAL|SD|FILE|STREAM ON|OFF switches one,
+// OUTPUT SERIAL|SD|FILE|STREAM BLOCK|DROP|SAMPLE <n> sets what a sink does with a full queue
+void _handle_output_input(char *args) {
+    char *value = strchr(args, ' ');
+    if (value != NULL) {
+        *value++ = '\0';
+        int on = _input_on_off(value);
+        uint32_t mask = 0;
+        if (strcasecmp(args, "SERIAL") == 0) {
+            mask = OUTPUT_SERIAL;
+        } else if (strcasecmp(args, "SD") == 0) {
+            mask = OUTPUT_SD;
+        } else if (strcasecmp(args, "FILE") == 0) {
+            mask = OUTPUT_FILE;
+        } else if (strcasecmp(args, "STREAM") == 0) {
+            mask = OUTPUT_STREAM;
+        }
+        bool ok;
+        if (mask == OUTPUT_STREAM && on >= 0) {
+            ok = stream_set_enabled(on);
+        } else if (mask != 0 && on >= 0) {
+            output_set_enabled(mask, on);
+            ok = true;
         } else {
-            input_buffer[input_buffer_pointer] = ch;
-            input_buffer[input_buffer_pointer + 1] = '\0';
-            input_buffer_pointer++;
+            ok = mask != 0 && _input_output_policy(output_find_sink(mask), value);
+        }
+        if (!ok) {
+            printf("Unable to handle OUTPUT command %s %s\n", args, value);
+            return;
         }
+    } else if (*args != '\0') {
+        printf("Unable to handle OUTPUT command %s\n", args);
+        return;
+    }
+    printf("OUTPUT: serial=%s sd=%s stream=%s\n", output_is_enabled(OUTPUT_SERIAL) ? "on" : "off",
+           output_is_enabled(OUTPUT_SD) ? "on" : "off", stream_sink() != NULL ? "on" : "off");
+    output_print_stats();
+}
 
-        ch = fgetc(stdin);
+#ifdef CONFIG_CSI_MOTION
+// MOTION prints the detector state, MOTION <enter> <exit> changes its thresholds
+void _handle_motion_input(char *args) {
+    unsigned int enter, exit;
+    char end;
+    if (sscanf(args, "%u %u %c", &enter, &exit, &end) == 2 && enter <= UINT16_MAX && exit <= enter) {
+        motion_set_thresholds(&dsp_motion, enter, exit);
+    } else if (*args != '\0') {
+        printf("Unable to handle MOTION command %s\n", args);
+        return;
     }
+    printf("MOTION: %s score=%u variance=%u change=%u enter=%u exit=%u events=%u\n",
+           dsp_motion.motion.load() ? "motion" : "still", motion_score(&dsp_motion),
+           dsp_motion.variance_score.load(), dsp_motion.change_score.load(), dsp_motion.enter.load(),
+           dsp_motion.exit.load(), dsp_motion.events.load());
+}
+#endif
+
+void input_register_commands(command_table_t *table) {
+    command_register(table, "HELP", "", &_handle_help_input);
+    command_register(table, "SETTIME", "<seconds>.<microseconds>", &_handle_settime_input);
+    command_register(table, "STATS", "", &_handle_stats_input);
+    command_register(table, "SDSTATS", "", &_handle_sdstats_input);
+    command_register(table, "DIAG", "", &_handle_diag_input);
+    command_register(table, "MAC", "LIST | ADD <mac> | DEL <mac> | CLEAR | MODE ALLOW|DENY|OFF", &_handle_mac_input);
+    command_register(table, "RATE", "[<packets per second>]", &_handle_rate_input);
+    command_register(table, "PLOT", "[amplitude | phase | amplitude_std | waterfall]", &_handle_plot_input);
+    command_register(table, "INTERVAL", "[<ms>]", &_handle_interval_input);
+    command_register(table, "OUTPUT", "[SERIAL | SD | FILE | STREAM ON|OFF] | [SERIAL | SD | FILE | STREAM BLOCK|DROP|SAMPLE <n>]", &_handle_output_input);
+#ifdef CONFIG_CSI_MOTION
+    command_register(table, "MOTION", "[<enter> <exit>]", &_handle_motion_input);
+#endif
 }
 
-void input_loop() {
-    while (true) {
-        input_check();
-        vTaskDelay(10 / portTICK_PERIOD_MS);
+void input_task(void *pvParameters) {
+    static char data[INPUT_RX_BUF_LEN];
+    uart_event_t event;
+
+    while (1) {
+        if (xQueueReceive(input_uart_queue, &event, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        switch (event.type) {
+            case UART_DATA: {
+                int len = uart_read_bytes(INPUT_UART_NUM, (uint8_t *) data, sizeof(data), 0);
+                if (len > 0) {
+                    command_feed(&input_line, &input_commands, data, len);
+                }
+                break;
+            }
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                // bytes were lost, nothing buffered can be trusted to continue a line
+                uart_flush_input(INPUT_UART_NUM);
+                xQueueReset(input_uart_queue);
+                command_line_discard(&input_line);
+                break;
+            default:
+                break;
+        }
     }
 }
 
+// install the uart driver on the console and start reading commands
+void input_start() {
+    input_register_commands(&input_commands);
+    ESP_ERROR_CHECK(uart_driver_install(INPUT_UART_NUM, INPUT_RX_BUF_LEN, 0, INPUT_EVENT_QUEUE_LEN, &input_uart_queue, 0));
+    // console output has to go through the driver once it owns the uart
+    esp_vfs_dev_uart_use_driver(INPUT_UART_NUM);
+    TaskHandle_t handle = NULL;
+    xTaskCreate(&input_task, "input", INPUT_TASK_STACK, NULL, 5, &handle);
+    diag_register_task(handle, "input", INPUT_TASK_STACK);
+}
+
 #endif //ESP32_CSI_INPUT_COMPONENT_H
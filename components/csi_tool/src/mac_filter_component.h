@@ -0,0 +1,256 @@
+#ifndef ESP32_CSI_MAC_FILTER_COMPONENT_H
+#define ESP32_CSI_MAC_FILTER_COMPONENT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs_component.h"
+
+/*
+ * Allow- or deny-list of transmitter MACs checked in the csi callback.
+ * MACs are packed into 48-bit integers and looked up in a small open
+ * addressing table, no string formatting or locking per packet.
+ *
+ * The callback only reads the published table. Edits rebuild the inactive
+ * copy from mac_filter_list and publish it with an atomic pointer swap.
+ * The callback announces the table it is probing, so the editor knows when
+ * the old copy is free to carry its hit counts over and to be rebuilt by
+ * the next edit. Edits and mac_filter_hits belong to one task, the console.
+ */
+
+#define MAC_FILTER_MAX 8
+#define MAC_FILTER_SLOTS 16     // power of two, keeps the load factor at or below 1/2
+#define MAC_FILTER_NVS_KEY "mac_filter"
+
+static_assert((MAC_FILTER_SLOTS & (MAC_FILTER_SLOTS - 1)) == 0, "MAC_FILTER_SLOTS must be a power of two");
+static_assert(MAC_FILTER_SLOTS >= 2 * MAC_FILTER_MAX, "MAC_FILTER_SLOTS must keep the table at most half full");
+
+typedef enum {
+    MAC_FILTER_OFF = 0,     // accept every transmitter
+    MAC_FILTER_ALLOW,       // accept only listed transmitters
+    MAC_FILTER_DENY,        // accept every transmitter except the listed ones
+} mac_filter_mode_t;
+
+typedef struct {
+    uint64_t keys[MAC_FILTER_SLOTS];    // 0 marks an empty slot
+    std::atomic<uint32_t> hits[MAC_FILTER_SLOTS];       // counted by the callback only
+    std::atomic<uint32_t> carried[MAC_FILTER_SLOTS];    // hits of the tables before, set by the editor only
+    mac_filter_mode_t mode;
+} mac_filter_table_t;
+
+// persisted form of the filter
+typedef struct {
+    uint8_t mode;
+    uint8_t count;
+    uint8_t macs[MAC_FILTER_MAX][6];
+} mac_filter_config_t;
+
+mac_filter_table_t mac_filter_tables[2];
+std::atomic<mac_filter_table_t *> mac_filter_active(&mac_filter_tables[0]);
+std::atomic<mac_filter_table_t *> mac_filter_probing(NULL);    // table the callback is using, if any
+mac_filter_config_t mac_filter_list;
+
+uint64_t mac_pack(const uint8_t *mac) {
+    return (uint64_t) mac[0] << 40 | (uint64_t) mac[1] << 32 | (uint64_t) mac[2] << 24 |
+           (uint64_t) mac[3] << 16 | (uint64_t) mac[4] << 8 | (uint64_t) mac[5];
+}
+
+void mac_unpack(uint64_t key, uint8_t *mac) {
+    for (int i = 0; i < 6; i++) {
+        mac[i] = key >> (40 - 8 * i);
+    }
+}
+
+bool mac_parse(const char *str, uint8_t *mac) {
+    unsigned int m[6];
+    if (sscanf(str, "%x:%x:%x:%x:%x:%x", &m[0], &m[1], &m[2], &m[3], &m[4], &m[5]) != 6) {
+        return false;
+    }
+    for (int i = 0; i < 6; i++) {
+        if (m[i] > 0xFF) {
+            return false;
+        }
+        mac[i] = m[i];
+    }
+    return true;
+}
+
+uint32_t _mac_filter_hash(uint64_t key) {
+    // fibonacci hashing, the top bits of the product are well mixed
+    return (uint32_t) ((key * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+int _mac_filter_find(const mac_filter_table_t *table, uint64_t key) {
+    uint32_t slot = _mac_filter_hash(key) & (MAC_FILTER_SLOTS - 1);
+    while (table->keys[slot] != 0) {
+        if (table->keys[slot] == key) {
+            return slot;
+        }
+        slot = (slot + 1) & (MAC_FILTER_SLOTS - 1);
+    }
+    return -1;
+}
+
+/*
+ * Announce the published table before probing it. The second load catches
+ * an edit that swapped the tables in between, the editor then either sees
+ * the announcement or the callback moves on to the new table. Both sides use
+ * sequentially consistent operations so this store-load handoff holds.
+ */
+mac_filter_table_t *_mac_filter_acquire() {
+    mac_filter_table_t *table = mac_filter_active.load();
+    while (true) {
+        mac_filter_probing.store(table);
+        mac_filter_table_t *published = mac_filter_active.load();
+        if (published == table) {
+            return table;
+        }
+        table = published;
+    }
+}
+
+/*
+ * Called from the csi callback for every packet, by one task at a time like
+ * the Wi-Fi driver does. Counts a hit for listed transmitters and returns
+ * whether to keep the packet.
+ */
+bool mac_filter_accept(const uint8_t *mac) {
+    mac_filter_table_t *table = _mac_filter_acquire();
+    bool accept = true;
+    if (table->mode != MAC_FILTER_OFF) {
+        int slot = _mac_filter_find(table, mac_pack(mac));
+        if (slot >= 0) {
+            table->hits[slot].store(table->hits[slot].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        accept = (slot >= 0) == (table->mode == MAC_FILTER_ALLOW);
+    }
+    mac_filter_probing.store(NULL, std::memory_order_release);
+    return accept;
+}
+
+// from the editing task, which is the only one that changes the published table
+uint32_t mac_filter_hits(const uint8_t *mac) {
+    mac_filter_table_t *table = mac_filter_active.load(std::memory_order_acquire);
+    int slot = _mac_filter_find(table, mac_pack(mac));
+    return slot >= 0 ? table->hits[slot].load(std::memory_order_relaxed) +
+                       table->carried[slot].load(std::memory_order_relaxed) : 0;
+}
+
+// rebuild the inactive table from mac_filter_list and publish it, hit counters carry over
+void _mac_filter_publish() {
+    mac_filter_table_t *current = mac_filter_active.load();
+    mac_filter_table_t *next = current == &mac_filter_tables[0] ? &mac_filter_tables[1] : &mac_filter_tables[0];
+
+    memset(next->keys, 0, sizeof(next->keys));
+    for (int i = 0; i < MAC_FILTER_SLOTS; i++) {
+        next->hits[i].store(0, std::memory_order_relaxed);
+        next->carried[i].store(0, std::memory_order_relaxed);
+    }
+    next->mode = (mac_filter_mode_t) mac_filter_list.mode;
+
+    for (int i = 0; i < mac_filter_list.count; i++) {
+        uint64_t key = mac_pack(mac_filter_list.macs[i]);
+        uint32_t slot = _mac_filter_hash(key) & (MAC_FILTER_SLOTS - 1);
+        while (next->keys[slot] != 0) {
+            slot = (slot + 1) & (MAC_FILTER_SLOTS - 1);
+        }
+        next->keys[slot] = key;
+    }
+
+    mac_filter_active.store(next);
+    // a callback that announced the old table before the swap finishes within a probe
+    while (mac_filter_probing.load() == current) {
+        vTaskDelay(1);
+    }
+
+    // the old table is quiet now, every hit it counted moves over
+    for (int slot = 0; slot < MAC_FILTER_SLOTS; slot++) {
+        if (next->keys[slot] == 0) {
+            continue;
+        }
+        int old = _mac_filter_find(current, next->keys[slot]);
+        if (old >= 0) {
+            next->carried[slot].store(current->hits[old].load(std::memory_order_relaxed) +
+                                      current->carried[old].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+    }
+}
+
+void _mac_filter_save() {
+    if (nvs_save_blob(MAC_FILTER_NVS_KEY, &mac_filter_list, sizeof(mac_filter_list)) != ESP_OK) {
+        printf("Unable to persist mac filter\n");
+    }
+}
+
+bool mac_filter_add(const uint8_t *mac) {
+    uint64_t key = mac_pack(mac);
+    if (key == 0 || mac_filter_list.count >= MAC_FILTER_MAX) {
+        return false;
+    }
+    for (int i = 0; i < mac_filter_list.count; i++) {
+        if (mac_pack(mac_filter_list.macs[i]) == key) {
+            return true;
+        }
+    }
+    memcpy(mac_filter_list.macs[mac_filter_list.count++], mac, 6);
+    _mac_filter_publish();
+    _mac_filter_save();
+    return true;
+}
+
+bool mac_filter_remove(const uint8_t *mac) {
+    uint64_t key = mac_pack(mac);
+    for (int i = 0; i < mac_filter_list.count; i++) {
+        if (mac_pack(mac_filter_list.macs[i]) == key) {
+            memmove(mac_filter_list.macs[i], mac_filter_list.macs[i + 1], (mac_filter_list.count - i - 1) * 6);
+            mac_filter_list.count--;
+            _mac_filter_publish();
+            _mac_filter_save();
+            return true;
+        }
+    }
+    return false;
+}
+
+void mac_filter_clear() {
+    mac_filter_list.count = 0;
+    _mac_filter_publish();
+    _mac_filter_save();
+}
+
+void mac_filter_set_mode(mac_filter_mode_t mode) {
+    mac_filter_list.mode = mode;
+    _mac_filter_publish();
+    _mac_filter_save();
+}
+
+void mac_filter_print() {
+    static const char *modes[] = {"OFF", "ALLOW", "DENY"};
+    printf("MAC filter: %s, %u entries\n", modes[mac_filter_list.mode], mac_filter_list.count);
+    for (int i = 0; i < mac_filter_list.count; i++) {
+        const uint8_t *m = mac_filter_list.macs[i];
+        printf("  %02X:%02X:%02X:%02X:%02X:%02X hits=%u\n", m[0], m[1], m[2], m[3], m[4], m[5], mac_filter_hits(m));
+    }
+}
+
+/*
+ * Load the persisted filter, or start from the given default
+ * transmitter if nothing was saved yet.
+ */
+void mac_filter_init(mac_filter_mode_t default_mode, const char *default_mac) {
+    size_t len = sizeof(mac_filter_list);
+    if (nvs_load_blob(MAC_FILTER_NVS_KEY, &mac_filter_list, &len) != ESP_OK || len != sizeof(mac_filter_list) ||
+        mac_filter_list.mode > MAC_FILTER_DENY || mac_filter_list.count > MAC_FILTER_MAX) {
+        memset(&mac_filter_list, 0, sizeof(mac_filter_list));
+        mac_filter_list.mode = default_mode;
+        if (default_mac != NULL && mac_parse(default_mac, mac_filter_list.macs[0])) {
+            mac_filter_list.count = 1;
+        }
+    }
+    _mac_filter_publish();
+}
+
+#endif //ESP32_CSI_MAC_FILTER_COMPONENT_H
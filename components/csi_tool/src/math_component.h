@@ -0,0 +1,105 @@
+#ifndef ESP32_CSI_MATH_COMPONENT_H
+#define ESP32_CSI_MATH_COMPONENT_H
+
+#include <stdint.h>
+
+/*
+ * Integer amplitude and phase kernels for int8 IQ samples.
+ * The ESP32 has no double precision FPU, so sqrt/pow/atan2 on doubles are
+ * emulated in software. These kernels only use integer ops.
+ */
+
+// binary angle: CSI_PHASE_PI equals pi radians
+#define CSI_PHASE_PI 32768
+
+// atan(k / 32) for k = 0..32 in binary angle units, last entry repeated for interpolation
+static const int16_t CSI_ATAN_LUT[34] = {
+    0, 326, 651, 975, 1297, 1617, 1933, 2246, 2555, 2860, 3159, 3453,
+    3742, 4025, 4302, 4572, 4836, 5094, 5344, 5589, 5826, 6058, 6282, 6500,
+    6712, 6917, 7117, 7310, 7498, 7679, 7856, 8026, 8192, 8192
+};
+
+/*
+ * Exact amplitude floor(sqrt(i^2 + q^2)), same as truncating the double formula.
+ * i^2 + q^2 <= 2 * 128^2 fits in 16 bits, so the bitwise root takes 8 rounds.
+ */
+uint16_t csi_amplitude(int8_t i, int8_t q) {
+    uint32_t op = (int32_t) i * i + (int32_t) q * q;
+    uint32_t res = 0;
+    uint32_t one = 1u << 14;
+
+    while (one > op) {
+        one >>= 2;
+    }
+    while (one != 0) {
+        if (op >= res + one) {
+            op -= res + one;
+            res = (res >> 1) + one;
+        } else {
+            res >>= 1;
+        }
+        one >>= 2;
+    }
+    return res;
+}
+
+/*
+ * Alpha-max-beta-min approximation with alpha = 123/128, beta = 51/128.
+ * Off by at most 4% of the exact amplitude plus one unit of rounding,
+ * for callers that only need a trend.
+ */
+uint16_t csi_amplitude_fast(int8_t i, int8_t q) {
+    uint16_t a = i < 0 ? -i : i;
+    uint16_t b = q < 0 ? -q : q;
+    uint16_t mx = a > b ? a : b;
+    uint16_t mn = a > b ? b : a;
+    return (mx * 123 + mn * 51 + 64) >> 7;
+}
+
+/*
+ * atan2(y, x) in binary angle units, range [-CSI_PHASE_PI, CSI_PHASE_PI].
+ * Reduces to the first octant and interpolates CSI_ATAN_LUT,
+ * error is below 0.001 rad.
+ */
+int32_t csi_phase(int8_t y, int8_t x) {
+    int32_t ax = x < 0 ? -x : x;
+    int32_t ay = y < 0 ? -y : y;
+    if (ax == 0 && ay == 0) {
+        return 0;
+    }
+
+    int32_t mx = ax > ay ? ax : ay;
+    int32_t mn = ax > ay ? ay : ax;
+    int32_t ratio = (mn << 12) / mx;    // tan of the octant angle in Q12
+    int32_t idx = ratio >> 7;
+    int32_t frac = ratio & 127;
+    int32_t angle = CSI_ATAN_LUT[idx] + (((CSI_ATAN_LUT[idx + 1] - CSI_ATAN_LUT[idx]) * frac) >> 7);
+
+    if (ay > ax) {
+        angle = CSI_PHASE_PI / 2 - angle;
+    }
+    if (x < 0) {
+        angle = CSI_PHASE_PI - angle;
+    }
+    return y < 0 ? -angle : angle;
+}
+
+/*
+ * Binary angle mapped onto the plot scale 200 * (phase + 3.2) / 6 (values 0..211),
+ * so it can be stored in an lv_coord_t directly. Q20 fixed point.
+ * Angles beyond +-pi are clamped.
+ */
+int16_t csi_angle_coord(int32_t angle) {
+    if (angle > CSI_PHASE_PI) {
+        angle = CSI_PHASE_PI;
+    } else if (angle < -CSI_PHASE_PI) {
+        angle = -CSI_PHASE_PI;
+    }
+    return (angle * 3351 + 111848107) >> 20;
+}
+
+int16_t csi_phase_coord(int8_t y, int8_t x) {
+    return csi_angle_coord(csi_phase(y, x));
+}
+
+#endif //ESP32_CSI_MATH_COMPONENT_H
@@ -0,0 +1,176 @@
+#ifndef ESP32_CSI_MOTION_COMPONENT_H
+#define ESP32_CSI_MOTION_COMPONENT_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <atomic>
+#include "math_component.h"
+#include "segment_component.h"
+
+/*
+ * Motion and presence detection on the LLTF of every frame, so a board can
+ * act as an occupancy sensor without logging raw CSI. Two scores in permille:
+ *
+ *   variance  sum over subcarriers of the amplitude variance over the last
+ *             MOTION_WINDOW frames, relative to the sum of their squared means.
+ *             Someone moving makes the amplitudes fluctuate.
+ *   change    1 - correlation of the amplitudes with a baseline that follows
+ *             them slowly, averaged over the same window. Someone entering
+ *             or standing still in the room reshapes the spectrum.
+ *
+ * Their sum enters the motion state at enter and leaves it at exit, below
+ * enter, so a score hovering around one threshold does not flap.
+ *
+ * The window keeps running sums of the amplitudes and their squares, the
+ * frame leaving the window is subtracted, so a frame costs O(subcarriers)
+ * whatever the window length. Integer sums are exact and never drift.
+ */
+
+#ifdef CONFIG_CSI_MOTION_ENTER
+#define MOTION_ENTER CONFIG_CSI_MOTION_ENTER
+#define MOTION_EXIT CONFIG_CSI_MOTION_EXIT
+#else
+#define MOTION_ENTER 45
+#define MOTION_EXIT 30
+#endif
+
+#define MOTION_WINDOW 32
+// the LLTF has 64 subcarriers in every layout
+#define MOTION_MAX_SUBC 64
+// the baseline moves by 1 / 2^MOTION_BASELINE_SHIFT of the difference every frame
+#define MOTION_BASELINE_SHIFT 8
+
+typedef struct {
+    uint16_t subc;
+    csi_subc_map_t map;
+    uint32_t count;                 // frames since the last restart, up to MOTION_WINDOW
+    uint8_t head;                   // slot of the oldest frame once the window is full
+
+    // amplitudes never exceed 181, a window of them fits 8 bit samples and 32 bit sums
+    uint8_t history[MOTION_WINDOW][MOTION_MAX_SUBC];
+    uint32_t sum[MOTION_MAX_SUBC];
+    uint32_t sum_sq[MOTION_MAX_SUBC];
+    float baseline[MOTION_MAX_SUBC];
+    uint16_t change[MOTION_WINDOW];
+    uint32_t change_sum;
+
+    // set by the console
+    std::atomic<uint16_t> enter;
+    std::atomic<uint16_t> exit;
+
+    // single writer, read by the display and the console
+    std::atomic<uint16_t> variance_score;
+    std::atomic<uint16_t> change_score;
+    std::atomic<bool> motion;
+    std::atomic<uint32_t> events;
+} motion_t;
+
+// thresholds can change while frames are added, they are only compared on the next frame
+void motion_set_thresholds(motion_t *m, uint16_t enter, uint16_t exit) {
+    m->enter.store(enter, std::memory_order_relaxed);
+    m->exit.store(exit < enter ? exit : enter, std::memory_order_relaxed);
+}
+
+void motion_init(motion_t *m, uint16_t enter, uint16_t exit) {
+    m->subc = 0;
+    m->count = 0;
+    m->head = 0;
+    motion_set_thresholds(m, enter, exit);
+    m->variance_score.store(0, std::memory_order_relaxed);
+    m->change_score.store(0, std::memory_order_relaxed);
+    m->motion.store(false, std::memory_order_relaxed);
+    m->events.store(0, std::memory_order_relaxed);
+}
+
+void _motion_restart(motion_t *m, const csi_segment_t *seg) {
+    m->subc = seg->subc < MOTION_MAX_SUBC ? seg->subc : MOTION_MAX_SUBC;
+    m->map = seg->map;
+    m->count = 0;
+    m->head = 0;
+    memset(m->sum, 0, sizeof(m->sum));
+    memset(m->sum_sq, 0, sizeof(m->sum_sq));
+    m->change_sum = 0;
+}
+
+uint32_t motion_score(const motion_t *m) {
+    return m->variance_score.load(std::memory_order_relaxed) + m->change_score.load(std::memory_order_relaxed);
+}
+
+/*
+ * Add the LLTF of one frame. Returns true if the motion state changed.
+ * Scores start once the window is full, a segment covering other subcarriers
+ * restarts the window and the baseline.
+ */
+bool motion_add(motion_t *m, const csi_segment_t *seg) {
+    if (m->count == 0 || seg->subc != m->subc || memcmp(&seg->map, &m->map, sizeof(csi_subc_map_t)) != 0) {
+        _motion_restart(m, seg);
+    }
+    bool full = m->count >= MOTION_WINDOW;
+    uint8_t *slot = m->history[m->head];
+    const int8_t *iq = seg->data;
+
+    uint64_t var_num = 0, mean_sq = 0;
+    float sa = 0, sb = 0, saa = 0, sbb = 0, sab = 0;
+    int n = 0;
+    for (int k = 0; k < m->subc; k++) {
+        uint8_t amp = csi_amplitude_fast(iq[k * 2], iq[k * 2 + 1]);
+        if (full) {
+            m->sum[k] -= slot[k];
+            m->sum_sq[k] -= slot[k] * slot[k];
+        }
+        slot[k] = amp;
+        m->sum[k] += amp;
+        m->sum_sq[k] += amp * amp;
+
+        // W^2 times variance and squared mean of the window
+        var_num += (uint64_t) MOTION_WINDOW * m->sum_sq[k] - (uint64_t) m->sum[k] * m->sum[k];
+        mean_sq += (uint64_t) m->sum[k] * m->sum[k];
+
+        float b = m->count == 0 ? amp : m->baseline[k];
+        if (amp != 0 || b >= 0.5f) {
+            // null subcarriers are zero in both, they would only inflate the correlation
+            sa += amp;
+            sb += b;
+            saa += (float) amp * amp;
+            sbb += b * b;
+            sab += amp * b;
+            n++;
+        }
+        m->baseline[k] = b + (amp - b) * (1.0f / (1 << MOTION_BASELINE_SHIFT));
+    }
+
+    float cov = sab - sa * sb / (n > 0 ? n : 1);
+    float va = saa - sa * sa / (n > 0 ? n : 1);
+    float vb = sbb - sb * sb / (n > 0 ? n : 1);
+    float corr = va > 0 && vb > 0 ? cov / sqrtf(va * vb) : 1.0f;
+    uint16_t change = corr < 1.0f ? (uint16_t) ((1.0f - corr) * 1000 + 0.5f) : 0;
+
+    if (full) {
+        m->change_sum -= m->change[m->head];
+    }
+    m->change[m->head] = change;
+    m->change_sum += change;
+    m->head = (m->head + 1) % MOTION_WINDOW;
+    if (!full) {
+        m->count++;
+        return false;
+    }
+
+    uint32_t variance = mean_sq > 0 ? var_num * 1000 / mean_sq : 0;
+    m->variance_score.store(variance < UINT16_MAX ? variance : UINT16_MAX, std::memory_order_relaxed);
+    m->change_score.store(m->change_sum / MOTION_WINDOW, std::memory_order_relaxed);
+
+    uint32_t score = motion_score(m);
+    bool motion = m->motion.load(std::memory_order_relaxed);
+    uint16_t threshold = motion ? m->exit.load(std::memory_order_relaxed) : m->enter.load(std::memory_order_relaxed);
+    bool next = score >= threshold;
+    if (next == motion) {
+        return false;
+    }
+    m->motion.store(next, std::memory_order_relaxed);
+    m->events.store(m->events.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return true;
+}
+
+#endif //ESP32_CSI_MOTION_COMPONENT_H
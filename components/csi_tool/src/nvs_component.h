@@ -2,6 +2,9 @@
 #define ESP32_CSI_NVS_COMPONENT_H
 
 #include "nvs_flash.h"
+#include "nvs.h"
+
+#define NVS_NAMESPACE "csi_tool"
 
 void nvs_init() {
     //Initialize NVS
@@ -13,4 +16,30 @@ void nvs_init() {
     ESP_ERROR_CHECK(ret);
 }
 
+esp_err_t nvs_save_blob(const char *key, const void *data, size_t len) {
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = nvs_set_blob(handle, key, data, len);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return ret;
+}
+
+// len is the size of data on input and the size of the stored blob on output
+esp_err_t nvs_load_blob(const char *key, void *data, size_t *len) {
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = nvs_get_blob(handle, key, data, len);
+    nvs_close(handle);
+    return ret;
+}
+
 #endif //ESP32_CSI_NVS_COMPONENT_H
@@ -0,0 +1,449 @@
+#ifndef ESP32_CSI_OUTPUT_COMPONENT_H
+#define ESP32_CSI_OUTPUT_COMPONENT_H
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "diag_component.h"
+
+/*
+ * Fan-out of the CSI output to its sinks: serial, the SD card, the UDP
+ * stream and on the host a file. Every sink has a bounded byte queue and a
+ * worker task that writes it out, so a slow sink falls behind on its own
+ * instead of setting the pace for the frame consumer and the other sinks.
+ *
+ * Each sink has its own policy for a full queue: block the producer until
+ * the worker made room (lossless), drop the message, or queue only every
+ * n-th frame and drop like the drop policy otherwise. Messages are queued
+ * whole and never wrap around the end of the queue, so the worker always
+ * writes complete rows or records.
+ *
+ * A message sink gets whole messages instead of a byte stream, each one
+ * passed to write on its own. The UDP stream (stream_component.h) is one,
+ * it packs records into datagrams itself and sends them with output_send,
+ * the fan-out of rows and records skips it.
+ */
+
+#ifdef CONFIG_CSI_OUTPUT_QUEUE_LEN
+#define OUTPUT_QUEUE_LEN CONFIG_CSI_OUTPUT_QUEUE_LEN
+#else
+#define OUTPUT_QUEUE_LEN 8192
+#endif
+
+#if defined CONFIG_CSI_SERIAL_DROP
+#define OUTPUT_SERIAL_POLICY OUTPUT_POLICY_DROP
+#elif defined CONFIG_CSI_SERIAL_SAMPLE
+#define OUTPUT_SERIAL_POLICY OUTPUT_POLICY_SAMPLE
+#else
+#define OUTPUT_SERIAL_POLICY OUTPUT_POLICY_BLOCK
+#endif
+
+#ifdef CONFIG_CSI_SERIAL_SAMPLE_N
+#define OUTPUT_SERIAL_SAMPLE_N CONFIG_CSI_SERIAL_SAMPLE_N
+#else
+#define OUTPUT_SERIAL_SAMPLE_N 10
+#endif
+
+#if defined CONFIG_CSI_SD_BLOCK
+#define OUTPUT_SD_POLICY OUTPUT_POLICY_BLOCK
+#elif defined CONFIG_CSI_SD_SAMPLE
+#define OUTPUT_SD_POLICY OUTPUT_POLICY_SAMPLE
+#else
+#define OUTPUT_SD_POLICY OUTPUT_POLICY_DROP
+#endif
+
+#ifdef CONFIG_CSI_SD_SAMPLE_N
+#define OUTPUT_SD_SAMPLE_N CONFIG_CSI_SD_SAMPLE_N
+#else
+#define OUTPUT_SD_SAMPLE_N 10
+#endif
+
+#if defined CONFIG_CSI_STREAM_BLOCK
+#define OUTPUT_STREAM_POLICY OUTPUT_POLICY_BLOCK
+#elif defined CONFIG_CSI_STREAM_SAMPLE
+#define OUTPUT_STREAM_POLICY OUTPUT_POLICY_SAMPLE
+#else
+#define OUTPUT_STREAM_POLICY OUTPUT_POLICY_DROP
+#endif
+
+#ifdef CONFIG_CSI_STREAM_SAMPLE_N
+#define OUTPUT_STREAM_SAMPLE_N CONFIG_CSI_STREAM_SAMPLE_N
+#else
+#define OUTPUT_STREAM_SAMPLE_N 10
+#endif
+
+#define OUTPUT_MAX_SINKS 4
+#define OUTPUT_TASK_STACK 3072
+#define OUTPUT_PRINTF_LEN 256
+#define OUTPUT_BLOCK_POLL_MS 10     // a blocked producer rechecks at least this often
+#define OUTPUT_MESSAGE_PREFIX 2     // length in front of every message of a message sink
+
+// outputs switched at runtime by the OUTPUT command, the Kconfig options decide which exist
+#define OUTPUT_SERIAL 0x1
+#define OUTPUT_SD 0x2
+#define OUTPUT_FILE 0x4             // host stand-in for the SD card, csi_host -o
+#define OUTPUT_STREAM 0x8           // UDP datagrams, on once stream_start succeeded
+
+typedef enum {
+    OUTPUT_POLICY_BLOCK,
+    OUTPUT_POLICY_DROP,
+    OUTPUT_POLICY_SAMPLE,
+    OUTPUT_POLICY_COUNT,
+} output_policy_t;
+
+static const char *OUTPUT_POLICY_NAMES[OUTPUT_POLICY_COUNT] = {"block", "drop", "sample"};
+
+typedef struct {
+    const char *name;
+    uint32_t mask;
+    void (*write)(void *ctx, const void *data, size_t len);
+    void *ctx;
+    bool messages;                  // written message by message, not part of the fan-out
+    std::atomic<uint8_t> policy;
+    std::atomic<uint32_t> sample_n;
+
+    // queued bytes are [head, tail), or [head, wrap) and [0, tail) once tail wrapped, all under lock
+    uint8_t *buf;
+    size_t head;
+    size_t tail;
+    size_t wrap;
+    SemaphoreHandle_t lock;
+    SemaphoreHandle_t space;        // given by the worker whenever it freed queue space
+    TaskHandle_t task;
+    int64_t started_us;
+
+    std::atomic<uint32_t> offered;  // frames seen by the sample policy
+    std::atomic<uint32_t> queued;
+    std::atomic<uint32_t> dropped;
+    std::atomic<uint32_t> sampled_out;
+    std::atomic<uint32_t> bytes_written;
+    std::atomic<uint32_t> blocked_ms;
+    std::atomic<uint32_t> high_water;
+} output_sink_t;
+
+output_sink_t output_sinks[OUTPUT_MAX_SINKS];
+std::atomic<uint8_t> output_sink_count(0);
+std::atomic<uint32_t> output_enabled(OUTPUT_SERIAL | OUTPUT_SD | OUTPUT_FILE);
+
+bool output_is_enabled(uint32_t output) {
+    return (output_enabled.load(std::memory_order_relaxed) & output) != 0;
+}
+
+void output_set_enabled(uint32_t output, bool enabled) {
+    if (enabled) {
+        output_enabled.fetch_or(output, std::memory_order_relaxed);
+    } else {
+        output_enabled.fetch_and(~output, std::memory_order_relaxed);
+    }
+}
+
+// the registered sink switched by mask, NULL if it does not exist
+output_sink_t *output_find_sink(uint32_t mask) {
+    uint8_t count = output_sink_count.load(std::memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        if (output_sinks[i].mask == mask) {
+            return &output_sinks[i];
+        }
+    }
+    return NULL;
+}
+
+// true if any registered sink of the fan-out is switched on
+bool output_active() {
+    uint8_t count = output_sink_count.load(std::memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        if (!output_sinks[i].messages && output_is_enabled(output_sinks[i].mask)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void output_set_policy(output_sink_t *sink, output_policy_t policy, uint32_t sample_n) {
+    sink->sample_n.store(sample_n > 0 ? sample_n : 1, std::memory_order_relaxed);
+    sink->policy.store(policy, std::memory_order_relaxed);
+}
+
+// bytes waiting in the queue or being written, with the lock held
+size_t _output_used(const output_sink_t *sink) {
+    return sink->tail >= sink->head ? sink->tail - sink->head : sink->wrap - sink->head + sink->tail;
+}
+
+void _output_inc(std::atomic<uint32_t> *counter, uint32_t n) {
+    counter->fetch_add(n, std::memory_order_relaxed);
+}
+
+void output_sink_task(void *pvParameters) {
+    output_sink_t *sink = (output_sink_t *) pvParameters;
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (true) {
+            xSemaphoreTake(sink->lock, portMAX_DELAY);
+            size_t head = sink->head;
+            size_t n = sink->tail >= head ? sink->tail - head : sink->wrap - head;
+            xSemaphoreGive(sink->lock);
+            if (n == 0) {
+                break;
+            }
+
+            // producers only append outside [head, head + n), so it is written without the lock
+            if (sink->messages) {
+                for (size_t at = head; at < head + n;) {
+                    uint16_t len;
+                    memcpy(&len, sink->buf + at, OUTPUT_MESSAGE_PREFIX);
+                    sink->write(sink->ctx, sink->buf + at + OUTPUT_MESSAGE_PREFIX, len);
+                    _output_inc(&sink->bytes_written, len);
+                    at += OUTPUT_MESSAGE_PREFIX + len;
+                }
+            } else {
+                sink->write(sink->ctx, sink->buf + head, n);
+                _output_inc(&sink->bytes_written, n);
+            }
+
+            xSemaphoreTake(sink->lock, portMAX_DELAY);
+            sink->head += n;
+            if (sink->tail < sink->head && sink->head == sink->wrap) {
+                sink->head = 0;
+                sink->wrap = OUTPUT_QUEUE_LEN;
+            }
+            if (sink->head == sink->tail) {
+                // empty, start over at the front so the next message has the whole queue
+                sink->head = sink->tail = 0;
+            }
+            xSemaphoreGive(sink->lock);
+            xSemaphoreGive(sink->space);
+        }
+    }
+}
+
+// copy data, after its length for a message sink, to the queue if it fits in one piece, with the lock held
+bool _output_enqueue(output_sink_t *sink, const void *data, size_t size) {
+    size_t prefix = sink->messages ? OUTPUT_MESSAGE_PREFIX : 0;
+    size_t len = prefix + size;
+    size_t at;
+    if (sink->tail >= sink->head) {
+        if (OUTPUT_QUEUE_LEN - sink->tail >= len) {
+            at = sink->tail;
+        } else if (sink->head > len) {
+            // the rest of the queue stays unused until the worker reaches it
+            sink->wrap = sink->tail;
+            at = 0;
+        } else {
+            return false;
+        }
+    } else if (sink->head - sink->tail > len) {
+        at = sink->tail;
+    } else {
+        return false;
+    }
+    if (prefix > 0) {
+        uint16_t message_len = size;
+        memcpy(sink->buf + at, &message_len, prefix);
+    }
+    memcpy(sink->buf + at + prefix, data, size);
+    sink->tail = at + len;
+
+    uint32_t used = _output_used(sink);
+    if (used > sink->high_water.load(std::memory_order_relaxed)) {
+        sink->high_water.store(used, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+// false if the sample policy of the sink skips this frame
+bool output_offer(output_sink_t *sink) {
+    if (sink->policy.load(std::memory_order_relaxed) == OUTPUT_POLICY_SAMPLE &&
+        sink->offered.fetch_add(1, std::memory_order_relaxed) % sink->sample_n.load(std::memory_order_relaxed) != 0) {
+        _output_inc(&sink->sampled_out, 1);
+        return false;
+    }
+    return true;
+}
+
+// queue one message for a sink according to its policy, returns false if it was dropped
+bool _output_push(output_sink_t *sink, const void *data, size_t len, bool frame) {
+    if (frame && !output_offer(sink)) {
+        return false;
+    }
+
+    uint8_t policy = sink->policy.load(std::memory_order_relaxed);
+    int64_t blocked_since = 0;
+    while (len + (sink->messages ? OUTPUT_MESSAGE_PREFIX : 0) <= OUTPUT_QUEUE_LEN) {
+        xSemaphoreTake(sink->lock, portMAX_DELAY);
+        bool queued = _output_enqueue(sink, data, len);
+        xSemaphoreGive(sink->lock);
+
+        if (queued) {
+            xTaskNotifyGive(sink->task);
+            _output_inc(&sink->queued, 1);
+            if (blocked_since != 0) {
+                _output_inc(&sink->blocked_ms, (esp_timer_get_time() - blocked_since) / 1000);
+            }
+            return true;
+        }
+        if (policy != OUTPUT_POLICY_BLOCK || !output_is_enabled(sink->mask)) {
+            break;
+        }
+        if (blocked_since == 0) {
+            blocked_since = esp_timer_get_time();
+        }
+        xSemaphoreTake(sink->space, pdMS_TO_TICKS(OUTPUT_BLOCK_POLL_MS));
+    }
+
+    if (blocked_since != 0) {
+        _output_inc(&sink->blocked_ms, (esp_timer_get_time() - blocked_since) / 1000);
+    }
+    _output_inc(&sink->dropped, 1);
+    return false;
+}
+
+void _output_fan_out(const void *data, size_t len, bool frame) {
+    uint8_t count = output_sink_count.load(std::memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        output_sink_t *sink = &output_sinks[i];
+        if (!sink->messages && output_is_enabled(sink->mask)) {
+            _output_push(sink, data, len, frame);
+        }
+    }
+}
+
+output_sink_t *_output_add(const char *name, uint32_t mask, void (*write)(void *ctx, const void *data, size_t len),
+                           void *ctx, bool messages, output_policy_t policy, uint32_t sample_n) {
+    uint8_t n = output_sink_count.load(std::memory_order_relaxed);
+    if (n >= OUTPUT_MAX_SINKS) {
+        return NULL;
+    }
+    output_sink_t *sink = &output_sinks[n];
+    sink->buf = (uint8_t *) malloc(OUTPUT_QUEUE_LEN);
+    if (sink->buf == NULL) {
+        printf("OUTPUT: failed to allocate the %s queue\n", name);
+        return NULL;
+    }
+    sink->name = name;
+    sink->mask = mask;
+    sink->write = write;
+    sink->ctx = ctx;
+    sink->messages = messages;
+    output_set_policy(sink, policy, sample_n);
+    sink->head = sink->tail = 0;
+    sink->wrap = OUTPUT_QUEUE_LEN;
+    sink->lock = xSemaphoreCreateMutex();
+    sink->space = xSemaphoreCreateBinary();
+    sink->started_us = esp_timer_get_time();
+
+    xTaskCreate(&output_sink_task, name, OUTPUT_TASK_STACK, sink, 5, &sink->task);
+    diag_register_task(sink->task, name, OUTPUT_TASK_STACK);
+    output_sink_count.store(n + 1, std::memory_order_release);
+    return sink;
+}
+
+/*
+ * Register a sink of the fan-out and start its worker, write is called from the
+ * worker only. Sinks are added at startup, all from one task. Returns NULL if
+ * there is no room or memory for another one.
+ */
+output_sink_t *output_add_sink(const char *name, uint32_t mask, void (*write)(void *ctx, const void *data, size_t len),
+                               void *ctx, output_policy_t policy, uint32_t sample_n) {
+    return _output_add(name, mask, write, ctx, false, policy, sample_n);
+}
+
+// the same for a message sink, write gets one message of output_send per call
+output_sink_t *output_add_message_sink(const char *name, uint32_t mask,
+                                       void (*write)(void *ctx, const void *data, size_t len), void *ctx,
+                                       output_policy_t policy, uint32_t sample_n) {
+    return _output_add(name, mask, write, ctx, true, policy, sample_n);
+}
+
+// write callback for a FILE *, stdout is the serial port on the device
+void output_file_write(void *ctx, const void *data, size_t len) {
+    fwrite(data, 1, len, (FILE *) ctx);
+}
+
+/*
+ * Wait until every sink wrote out what was queued, up to timeout_ms.
+ * Returns false if something is still queued.
+ */
+bool output_drain(uint32_t timeout_ms) {
+    int64_t deadline = esp_timer_get_time() + (int64_t) timeout_ms * 1000;
+    uint8_t count = output_sink_count.load(std::memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        output_sink_t *sink = &output_sinks[i];
+        while (true) {
+            xSemaphoreTake(sink->lock, portMAX_DELAY);
+            bool empty = sink->head == sink->tail;
+            xSemaphoreGive(sink->lock);
+            if (empty) {
+                break;
+            }
+            if (esp_timer_get_time() >= deadline) {
+                return false;
+            }
+            vTaskDelay(1);
+        }
+    }
+    return true;
+}
+
+/*
+ * One message to a message sink whether it is switched on or not, e.g. a
+ * datagram. Never sampled, the producer asks output_offer per frame instead.
+ * Returns false if it was dropped.
+ */
+bool output_send(output_sink_t *sink, const void *data, size_t len) {
+    return _output_push(sink, data, len, false);
+}
+
+/*
+ * Raw bytes, e.g. a header, to every enabled sink. Never sampled.
+ */
+void outwrite(const void *data, size_t len) {
+    _output_fan_out(data, len, false);
+}
+
+/*
+ * One frame, a CSV row or binary record, to every enabled sink
+ */
+void outwrite_frame(const void *data, size_t len) {
+    _output_fan_out(data, len, true);
+}
+
+/*
+ * Printf to every enabled sink, formatted once and cut at OUTPUT_PRINTF_LEN
+ */
+void outprintf(const char *format, ...) {
+    char line[OUTPUT_PRINTF_LEN];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    if (n > 0) {
+        outwrite(line, (size_t) n < sizeof(line) ? n : sizeof(line) - 1);
+    }
+}
+
+void output_print_stats() {
+    uint8_t count = output_sink_count.load(std::memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        output_sink_t *sink = &output_sinks[i];
+        int64_t elapsed_ms = (esp_timer_get_time() - sink->started_us) / 1000;
+        uint32_t bytes = sink->bytes_written.load();
+        printf("OUTPUT %s%s: policy=%s", sink->name, output_is_enabled(sink->mask) ? "" : " (off)",
+               OUTPUT_POLICY_NAMES[sink->policy.load()]);
+        if (sink->policy.load() == OUTPUT_POLICY_SAMPLE) {
+            printf(" 1/%u", sink->sample_n.load());
+        }
+        printf(" queued=%u dropped=%u sampled out=%u bytes=%u (%u KB/s) blocked=%u ms high water=%u/%u\n",
+               sink->queued.load(), sink->dropped.load(), sink->sampled_out.load(), bytes,
+               elapsed_ms > 0 ? (uint32_t) ((uint64_t) bytes * 1000 / 1024 / elapsed_ms) : 0,
+               sink->blocked_ms.load(), sink->high_water.load(), OUTPUT_QUEUE_LEN);
+    }
+}
+
+#endif //ESP32_CSI_OUTPUT_COMPONENT_H
@@ -0,0 +1,190 @@
+#ifndef ESP32_CSI_PACER_COMPONENT_H
+#define ESP32_CSI_PACER_COMPONENT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "stats_component.h"
+
+/*
+ * Paces the packets that make the access point answer with CSI.
+ * Packet k of a schedule is due at epoch + k / rate, computed from the
+ * epoch every time so rounding never accumulates into drift. Deadlines that
+ * passed form a token bucket: a sender that fell behind catches up with at
+ * most burst packets back to back, older deadlines are skipped and counted.
+ *
+ * pacer_due and pacer_sent take the time as an argument and touch no
+ * timers, so the schedule can be driven by a simulated clock on the host.
+ * pacer_wait sleeps on a one-shot esp_timer armed for the next deadline,
+ * which resolves microseconds instead of the 1 ms FreeRTOS tick.
+ *
+ * The schedule belongs to the sending task. pacer_set_rate may be called
+ * from any task, the sender switches to the new rate at its next wakeup.
+ */
+
+#if defined CONFIG_PACKET_RATE && (CONFIG_PACKET_RATE > 0)
+#define PACKET_RATE CONFIG_PACKET_RATE
+#else
+#define PACKET_RATE 100
+#endif
+
+#define PACER_MAX_BURST 4
+// keeps the deadline arithmetic far from overflowing, well above what the radio can send
+#define PACER_MAX_RATE 100000
+// achieved rate is measured over windows of this length
+#define PACER_RATE_WINDOW_US 1000000
+
+typedef struct {
+    std::atomic<uint32_t> requested_rate;
+    uint32_t rate;              // packets per second of the running schedule, 0 pauses
+    uint32_t burst;
+    int64_t epoch_us;           // deadline of packet 0
+    int64_t next;               // index of the next packet to send
+    int64_t window_start_us;
+    uint32_t window_sent;
+    std::atomic<uint32_t> sent;
+    std::atomic<uint32_t> skipped;          // deadlines dropped after falling more than burst behind
+    std::atomic<float> achieved_rate;       // packets per second over the last full window
+    esp_timer_handle_t timer;
+    std::atomic<TaskHandle_t> waiter;       // set once the sending task started, RATE may come earlier
+} pacer_t;
+
+pacer_t packet_pacer;
+
+void pacer_init(pacer_t *p, uint32_t rate, uint32_t burst, int64_t now_us) {
+    rate = rate < PACER_MAX_RATE ? rate : PACER_MAX_RATE;
+    p->requested_rate.store(rate, std::memory_order_relaxed);
+    p->rate = rate;
+    p->burst = burst > 0 ? burst : 1;
+    p->epoch_us = now_us;
+    p->next = 0;
+    p->window_start_us = now_us;
+    p->window_sent = 0;
+    p->sent.store(0, std::memory_order_relaxed);
+    p->skipped.store(0, std::memory_order_relaxed);
+    p->achieved_rate.store(0.0f, std::memory_order_relaxed);
+}
+
+// rounded up, so pacer_due counts packet k as due from its deadline on
+int64_t _pacer_deadline(const pacer_t *p, int64_t k) {
+    return p->epoch_us + (k * 1000000 + p->rate - 1) / p->rate;
+}
+
+// deadline of the next packet, only meaningful while the rate is not 0
+int64_t pacer_next_us(const pacer_t *p) {
+    return _pacer_deadline(p, p->next);
+}
+
+/*
+ * Number of packets to send at now_us, at most burst.
+ * Picks up a rate change by starting a new schedule at now_us.
+ */
+uint32_t pacer_due(pacer_t *p, int64_t now_us) {
+    uint32_t requested = p->requested_rate.load(std::memory_order_relaxed);
+    if (requested != p->rate) {
+        p->rate = requested;
+        p->epoch_us = now_us;
+        p->next = 0;
+        p->window_start_us = now_us;
+        p->window_sent = 0;
+    }
+    if (p->rate == 0 || now_us < p->epoch_us) {
+        return 0;
+    }
+
+    // deadlines from next up to the last one at or before now
+    int64_t available = (now_us - p->epoch_us) * p->rate / 1000000 + 1 - p->next;
+    if (available <= 0) {
+        return 0;
+    }
+    if (available > p->burst) {
+        int64_t skip = available - p->burst;
+        p->skipped.store(p->skipped.load(std::memory_order_relaxed) + (uint32_t) skip, std::memory_order_relaxed);
+        p->next += skip;
+        available = p->burst;
+    }
+    return (uint32_t) available;
+}
+
+// account one packet sent at now_us against its deadline
+void pacer_sent(pacer_t *p, int64_t now_us) {
+    stats_record(STATS_STAGE_PACER, now_us - pacer_next_us(p));
+    p->next++;
+    p->sent.store(p->sent.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    p->window_sent++;
+    int64_t elapsed = now_us - p->window_start_us;
+    if (elapsed >= PACER_RATE_WINDOW_US) {
+        p->achieved_rate.store(p->window_sent * 1000000.0f / elapsed, std::memory_order_relaxed);
+        p->window_start_us = now_us;
+        p->window_sent = 0;
+    }
+}
+
+void pacer_set_rate(pacer_t *p, uint32_t rate) {
+    p->requested_rate.store(rate < PACER_MAX_RATE ? rate : PACER_MAX_RATE, std::memory_order_relaxed);
+    TaskHandle_t waiter = p->waiter.load(std::memory_order_acquire);
+    if (waiter != NULL) {
+        xTaskNotifyGive(waiter);
+    }
+}
+
+void _pacer_timer_cb(void *arg) {
+    xTaskNotifyGive(((pacer_t *) arg)->waiter.load(std::memory_order_acquire));
+}
+
+// start a schedule paced by an esp_timer, the calling task is the one that waits on it
+bool pacer_start(pacer_t *p, uint32_t rate, uint32_t burst) {
+    pacer_init(p, rate, burst, esp_timer_get_time());
+    p->waiter.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+    if (p->timer != NULL) {
+        return true;
+    }
+
+    esp_timer_create_args_t args;
+    args.callback = &_pacer_timer_cb;
+    args.arg = p;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "pacer";
+    args.skip_unhandled_events = false;
+    esp_err_t err = esp_timer_create(&args, &p->timer);
+    if (err != ESP_OK) {
+        printf("PACER: unable to create timer [%s]\n", esp_err_to_name(err));
+        p->timer = NULL;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Block until packets are due and return how many to send now.
+ * Sleeps until pacer_set_rate while the rate is 0.
+ */
+uint32_t pacer_wait(pacer_t *p) {
+    while (true) {
+        int64_t now = esp_timer_get_time();
+        uint32_t due = pacer_due(p, now);
+        if (due > 0) {
+            return due;
+        }
+
+        // a rate change may have woken us up before the timer fired
+        esp_timer_stop(p->timer);
+        if (p->rate > 0) {
+            esp_timer_start_once(p->timer, pacer_next_us(p) - now);
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+void pacer_print_stats(const pacer_t *p) {
+    printf("PACER: rate=%u/s achieved=%.1f/s sent=%u skipped=%u late avg=%uus p99<=%uus max=%uus\n",
+           p->requested_rate.load(std::memory_order_relaxed), p->achieved_rate.load(std::memory_order_relaxed),
+           p->sent.load(std::memory_order_relaxed), p->skipped.load(std::memory_order_relaxed),
+           stats_mean_us(STATS_STAGE_PACER), stats_percentile_us(STATS_STAGE_PACER, 99), stats_max_us(STATS_STAGE_PACER));
+}
+
+#endif //ESP32_CSI_PACER_COMPONENT_H
@@ -0,0 +1,111 @@
+#ifndef ESP32_CSI_PHASE_COMPONENT_H
+#define ESP32_CSI_PHASE_COMPONENT_H
+
+#include <stdint.h>
+#include <string.h>
+#include "ring_component.h"
+#include "math_component.h"
+
+/*
+ * Phase sanitization across subcarriers: unwrap, remove the least squares
+ * line (the slope from sampling time offset, the offset from carrier phase)
+ * and optionally smooth the residual over time with an exponential average.
+ *
+ * Integer only, binary angle units (CSI_PHASE_PI = pi). Unwrapping and the
+ * regression sums share one pass over the subcarriers, the residual and the
+ * smoothing are applied in the pass that writes the output. No allocation,
+ * the state is a fixed array per subcarrier.
+ */
+
+#define PHASE_MAX_SUBC (CSI_MAX_LEN / 2)
+// residuals are clamped to +-4 pi before smoothing so the Q8 average fits 32 bits
+#define PHASE_RESIDUAL_MAX (4 * CSI_PHASE_PI)
+
+typedef struct {
+    uint8_t smoothing_shift;        // weight 2^-shift for the newest window, 0 disables smoothing
+    bool primed;
+    uint16_t subc;                  // layout the average belongs to
+    int32_t ema[PHASE_MAX_SUBC];    // Q8 average residual per slot
+    int64_t slope_q16;              // last fit, binary angle per subcarrier in Q16
+    int64_t offset_q16;
+} phase_sanitizer_t;
+
+void phase_sanitizer_reset(phase_sanitizer_t *p) {
+    p->primed = false;
+    p->subc = 0;
+}
+
+void phase_sanitizer_init(phase_sanitizer_t *p, uint8_t smoothing_shift) {
+    memset(p, 0, sizeof(phase_sanitizer_t));
+    p->smoothing_shift = smoothing_shift;
+}
+
+/*
+ * Sanitize n phases given in ascending frequency order.
+ * freq holds the subcarrier index and idx the smoothing slot of every entry,
+ * subc is the length of the frame layout. Writes the residual phase per entry to out.
+ */
+void phase_sanitize(phase_sanitizer_t *p, uint16_t subc, const int32_t *phase, const int16_t *freq,
+                    const int16_t *idx, int n, int32_t *out) {
+    if (p->subc != subc) {
+        p->primed = false;
+        p->subc = subc;
+    }
+    if (n < 2) {
+        for (int i = 0; i < n; i++) {
+            out[i] = 0;
+        }
+        return;
+    }
+
+    // unwrap and accumulate the regression sums
+    int32_t offset = 0;
+    int32_t prev = phase[0];
+    int64_t sk = 0, skk = 0, su = 0, sku = 0;
+    for (int i = 0; i < n; i++) {
+        int32_t d = phase[i] - prev;
+        if (d > CSI_PHASE_PI) {
+            offset -= 2 * CSI_PHASE_PI;
+        } else if (d < -CSI_PHASE_PI) {
+            offset += 2 * CSI_PHASE_PI;
+        }
+        prev = phase[i];
+        int32_t u = phase[i] + offset;
+        int32_t k = freq[i];
+        out[i] = u;
+        sk += k;
+        skk += k * k;
+        su += u;
+        sku += (int64_t) k * u;
+    }
+
+    // slope and offset in Q16, the slope is split so the shift cannot overflow
+    int64_t den = n * skk - sk * sk;
+    int64_t num = n * sku - sk * su;
+    int64_t slope = den != 0 ? (num / den) * 65536 + ((num % den) * 65536) / den : 0;
+    int64_t intercept = (su * 65536 - slope * sk) / n;
+    p->slope_q16 = slope;
+    p->offset_q16 = intercept;
+
+    for (int i = 0; i < n; i++) {
+        int32_t r = out[i] - (int32_t) ((intercept + slope * freq[i] + 32768) >> 16);
+        if (r > PHASE_RESIDUAL_MAX) {
+            r = PHASE_RESIDUAL_MAX;
+        } else if (r < -PHASE_RESIDUAL_MAX) {
+            r = -PHASE_RESIDUAL_MAX;
+        }
+        if (p->smoothing_shift > 0) {
+            int32_t *avg = &p->ema[idx[i]];
+            if (p->primed) {
+                *avg += (r * 256 - *avg) >> p->smoothing_shift;
+            } else {
+                *avg = r * 256;
+            }
+            r = (*avg + 128) >> 8;
+        }
+        out[i] = r;
+    }
+    p->primed = true;
+}
+
+#endif //ESP32_CSI_PHASE_COMPONENT_H
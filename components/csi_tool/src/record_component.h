@@ -0,0 +1,274 @@
+#ifndef ESP32_CSI_RECORD_COMPONENT_H
+#define ESP32_CSI_RECORD_COMPONENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * Compact binary CSI record, an alternative to the CSV rows for serial and SD.
+ * Carries every column of the CSV header. Plain C++ without ESP-IDF
+ * dependencies so the host decoder in tools/ shares this file.
+ *
+ * All multi-byte fields are little endian.
+ *
+ *   offset  size  field
+ *   0       2     sync word 0xC5 0x1A
+ *   2       1     version
+ *   3       2     body length n
+ *   5       n     body
+ *   5 + n   2     crc16-ccitt of version, length and body
+ *
+ * Body (version 1):
+ *   role[4], mac[6], rssi, rate, sig_mode, mcs, bandwidth, flags,
+ *   noise_floor, ampdu_cnt, channel, secondary_channel, local_timestamp (u32),
+ *   ant, sig_len (u16), rx_state, real_timestamp (u64, us), len (u16), data[len]
+ *
+ * flags: bit 0 smoothing, bit 1 not_sounding, bit 2 aggregation, bits 3-4 stbc,
+ *        bit 5 fec_coding, bit 6 sgi, bit 7 real_time_set
+ *
+ * Body (version 2): the same fields, len still counts the iq bytes, but
+ * data[] is replaced by the rest of the body in the packed format of
+ * codec_component.h. It takes the previous frames of the link to unpack.
+ */
+
+#define CSI_RECORD_SYNC0 0xC5
+#define CSI_RECORD_SYNC1 0x1A
+#define CSI_RECORD_VERSION 1
+#define CSI_RECORD_VERSION_PACKED 2
+#define CSI_RECORD_HEADER_LEN 5
+#define CSI_RECORD_CRC_LEN 2
+#define CSI_RECORD_FIXED_LEN 38
+#define CSI_RECORD_MAX_DATA 1024
+// a packed payload is never more than a few bytes longer than the raw one
+#define CSI_RECORD_MAX_PACKED (CSI_RECORD_MAX_DATA + 2)
+#define CSI_RECORD_MAX_LEN (CSI_RECORD_HEADER_LEN + CSI_RECORD_FIXED_LEN + CSI_RECORD_MAX_PACKED + CSI_RECORD_CRC_LEN)
+
+typedef struct {
+    char role[4];
+    uint8_t mac[6];
+    int8_t rssi;
+    uint8_t rate;
+    uint8_t sig_mode;
+    uint8_t mcs;
+    uint8_t bandwidth;
+    uint8_t smoothing;
+    uint8_t not_sounding;
+    uint8_t aggregation;
+    uint8_t stbc;
+    uint8_t fec_coding;
+    uint8_t sgi;
+    int8_t noise_floor;
+    uint8_t ampdu_cnt;
+    uint8_t channel;
+    uint8_t secondary_channel;
+    uint32_t local_timestamp;
+    uint8_t ant;
+    uint16_t sig_len;
+    uint8_t rx_state;
+    uint8_t real_time_set;
+    uint64_t real_timestamp;    // microseconds since epoch
+    uint16_t len;
+    const int8_t *data;         // points into the caller's buffer, not copied
+    uint16_t packed_len;        // 0 if data holds the len iq bytes, else the size of the packed payload at data
+} csi_record_t;
+
+typedef enum {
+    CSI_RECORD_OK = 0,
+    CSI_RECORD_INCOMPLETE,      // need more bytes, nothing consumed
+    CSI_RECORD_CORRUPT,         // skip the consumed bytes and try again
+} csi_record_status_t;
+
+static const uint16_t CSI_RECORD_CRC_TABLE[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0,
+};
+
+uint16_t csi_record_crc(const uint8_t *data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc = (crc << 8) ^ CSI_RECORD_CRC_TABLE[(crc >> 8) ^ data[i]];
+    }
+    return crc;
+}
+
+size_t _csi_record_frame(const csi_record_t *rec, uint8_t version, const void *payload, size_t payload_len,
+                         uint8_t *out, size_t cap) {
+    size_t body_len = CSI_RECORD_FIXED_LEN + payload_len;
+    size_t total = CSI_RECORD_HEADER_LEN + body_len + CSI_RECORD_CRC_LEN;
+    if (rec->len > CSI_RECORD_MAX_DATA || payload_len > CSI_RECORD_MAX_PACKED || total > cap) {
+        return 0;
+    }
+
+    uint8_t *p = out;
+    *p++ = CSI_RECORD_SYNC0;
+    *p++ = CSI_RECORD_SYNC1;
+    *p++ = version;
+    *p++ = body_len & 0xFF;
+    *p++ = body_len >> 8;
+
+    memcpy(p, rec->role, 4);
+    p += 4;
+    memcpy(p, rec->mac, 6);
+    p += 6;
+    *p++ = rec->rssi;
+    *p++ = rec->rate;
+    *p++ = rec->sig_mode;
+    *p++ = rec->mcs;
+    *p++ = rec->bandwidth;
+    *p++ = (rec->smoothing & 1) | (rec->not_sounding & 1) << 1 | (rec->aggregation & 1) << 2 |
+           (rec->stbc & 3) << 3 | (rec->fec_coding & 1) << 5 | (rec->sgi & 1) << 6 | (rec->real_time_set & 1) << 7;
+    *p++ = rec->noise_floor;
+    *p++ = rec->ampdu_cnt;
+    *p++ = rec->channel;
+    *p++ = rec->secondary_channel;
+    for (int i = 0; i < 4; i++) {
+        *p++ = rec->local_timestamp >> (8 * i);
+    }
+    *p++ = rec->ant;
+    *p++ = rec->sig_len & 0xFF;
+    *p++ = rec->sig_len >> 8;
+    *p++ = rec->rx_state;
+    for (int i = 0; i < 8; i++) {
+        *p++ = rec->real_timestamp >> (8 * i);
+    }
+    *p++ = rec->len & 0xFF;
+    *p++ = rec->len >> 8;
+    memcpy(p, payload, payload_len);
+    p += payload_len;
+
+    uint16_t crc = csi_record_crc(out + 2, p - out - 2);
+    *p++ = crc & 0xFF;
+    *p++ = crc >> 8;
+    return p - out;
+}
+
+/*
+ * Serialize a record into out. Returns the number of bytes written,
+ * or 0 if the record does not fit into cap bytes.
+ */
+size_t csi_record_encode(const csi_record_t *rec, uint8_t *out, size_t cap) {
+    return _csi_record_frame(rec, CSI_RECORD_VERSION, rec->data, rec->len, out, cap);
+}
+
+// same as csi_record_encode with a payload packed by the codec instead of the iq bytes
+size_t csi_record_encode_packed(const csi_record_t *rec, const uint8_t *packed, size_t packed_len,
+                                uint8_t *out, size_t cap) {
+    return _csi_record_frame(rec, CSI_RECORD_VERSION_PACKED, packed, packed_len, out, cap);
+}
+
+/*
+ * Parse one record from the start of buf. On CSI_RECORD_OK rec->data points into buf,
+ * for a packed record rec->packed_len is set and the codec has to unpack it.
+ * On CSI_RECORD_CORRUPT, consumed tells how many bytes to drop before the next attempt,
+ * which resynchronizes on the next sync word.
+ */
+csi_record_status_t csi_record_decode(const uint8_t *buf, size_t len, csi_record_t *rec, size_t *consumed) {
+    *consumed = 0;
+    if (len < 2) {
+        return CSI_RECORD_INCOMPLETE;
+    }
+    if (buf[0] != CSI_RECORD_SYNC0 || buf[1] != CSI_RECORD_SYNC1) {
+        const uint8_t *next = (const uint8_t *) memchr(buf + 1, CSI_RECORD_SYNC0, len - 1);
+        *consumed = next != NULL ? next - buf : len;
+        return CSI_RECORD_CORRUPT;
+    }
+    if (len < CSI_RECORD_HEADER_LEN) {
+        return CSI_RECORD_INCOMPLETE;
+    }
+
+    size_t body_len = buf[3] | buf[4] << 8;
+    bool packed = buf[2] == CSI_RECORD_VERSION_PACKED;
+    if ((buf[2] != CSI_RECORD_VERSION && !packed) || body_len < CSI_RECORD_FIXED_LEN ||
+        body_len > CSI_RECORD_FIXED_LEN + (packed ? CSI_RECORD_MAX_PACKED : CSI_RECORD_MAX_DATA)) {
+        *consumed = 1;
+        return CSI_RECORD_CORRUPT;
+    }
+    size_t total = CSI_RECORD_HEADER_LEN + body_len + CSI_RECORD_CRC_LEN;
+    if (len < total) {
+        return CSI_RECORD_INCOMPLETE;
+    }
+
+    const uint8_t *p = buf + CSI_RECORD_HEADER_LEN;
+    uint16_t crc = p[body_len] | p[body_len + 1] << 8;
+    uint16_t data_len = p[CSI_RECORD_FIXED_LEN - 2] | p[CSI_RECORD_FIXED_LEN - 1] << 8;
+    size_t payload_len = body_len - CSI_RECORD_FIXED_LEN;
+    if (crc != csi_record_crc(buf + 2, total - 4) || data_len > CSI_RECORD_MAX_DATA ||
+        (!packed && data_len != payload_len)) {
+        *consumed = 1;
+        return CSI_RECORD_CORRUPT;
+    }
+
+    memcpy(rec->role, p, 4);
+    p += 4;
+    memcpy(rec->mac, p, 6);
+    p += 6;
+    rec->rssi = *p++;
+    rec->rate = *p++;
+    rec->sig_mode = *p++;
+    rec->mcs = *p++;
+    rec->bandwidth = *p++;
+    uint8_t flags = *p++;
+    rec->smoothing = flags & 1;
+    rec->not_sounding = (flags >> 1) & 1;
+    rec->aggregation = (flags >> 2) & 1;
+    rec->stbc = (flags >> 3) & 3;
+    rec->fec_coding = (flags >> 5) & 1;
+    rec->sgi = (flags >> 6) & 1;
+    rec->real_time_set = (flags >> 7) & 1;
+    rec->noise_floor = *p++;
+    rec->ampdu_cnt = *p++;
+    rec->channel = *p++;
+    rec->secondary_channel = *p++;
+    rec->local_timestamp = 0;
+    for (int i = 0; i < 4; i++) {
+        rec->local_timestamp |= (uint32_t) *p++ << (8 * i);
+    }
+    rec->ant = *p++;
+    rec->sig_len = p[0] | p[1] << 8;
+    p += 2;
+    rec->rx_state = *p++;
+    rec->real_timestamp = 0;
+    for (int i = 0; i < 8; i++) {
+        rec->real_timestamp |= (uint64_t) *p++ << (8 * i);
+    }
+    rec->len = data_len;
+    p += 2;
+    rec->data = (const int8_t *) p;
+    rec->packed_len = packed ? payload_len : 0;
+
+    *consumed = total;
+    return CSI_RECORD_OK;
+}
+
+#endif //ESP32_CSI_RECORD_COMPONENT_H
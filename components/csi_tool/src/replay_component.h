@@ -0,0 +1,228 @@
+#ifndef ESP32_CSI_REPLAY_COMPONENT_H
+#define ESP32_CSI_REPLAY_COMPONENT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "csi_component.h"
+
+/*
+ * Replays recorded captures (the CSV schema of _print_csi_csv_header) into the
+ * csi callback, so the pipeline can be load tested and field problems reproduced
+ * without an access point.
+ */
+
+#define REPLAY_LINE_LEN 8192
+
+typedef enum {
+    REPLAY_TIMED = 0,   // original timing from local_timestamp, divided by speed
+    REPLAY_FAST,        // as fast as the callback accepts frames
+} replay_mode_t;
+
+typedef struct {
+    replay_mode_t mode;
+    float speed;        // 1.0 replays at the original rate, 2.0 twice as fast
+} replay_config_t;
+
+typedef struct {
+    uint32_t rows;
+    uint32_t frames;
+    uint32_t parse_errors;
+    uint32_t pushed_before;
+    uint32_t overflows_before;
+    uint32_t filtered_before;
+    int64_t start_us;
+    int64_t end_us;
+} replay_stats_t;
+
+char *_replay_next_field(char **cursor) {
+    char *field = *cursor;
+    char *comma = strchr(field, ',');
+    if (comma == NULL) {
+        *cursor = field + strlen(field);
+    } else {
+        *comma = '\0';
+        *cursor = comma + 1;
+    }
+    return field;
+}
+
+/*
+ * Parse one CSV row into info, the iq values go into buf (CSI_MAX_LEN bytes).
+ * Modifies line. Returns false for the header, other log lines and malformed rows,
+ * including rows with len 0 or an array that does not hold len values.
+ */
+bool replay_parse_row(char *line, wifi_csi_info_t *info, int8_t *buf) {
+    if (strncmp(line, "CSI_DATA,", 9) != 0) {
+        return false;
+    }
+
+    char *cursor = line + 9;
+    long long v[22];
+    _replay_next_field(&cursor);   // role
+
+    unsigned int mac[6];
+    if (sscanf(_replay_next_field(&cursor), "%x:%x:%x:%x:%x:%x", &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5]) != 6) {
+        return false;
+    }
+    // rssi up to len, real_timestamp is parsed as an integer part and skipped
+    for (int i = 0; i < 22; i++) {
+        char *field = _replay_next_field(&cursor);
+        if (*field == '\0') {
+            return false;
+        }
+        v[i] = strtoll(field, NULL, 10);
+    }
+
+    memset(info, 0, sizeof(wifi_csi_info_t));
+    for (int i = 0; i < 6; i++) {
+        info->mac[i] = mac[i];
+    }
+    wifi_pkt_rx_ctrl_t *rx = &info->rx_ctrl;
+    rx->rssi = v[0];
+    rx->rate = v[1];
+    rx->sig_mode = v[2];
+    rx->mcs = v[3];
+    rx->cwb = v[4];
+    rx->smoothing = v[5];
+    rx->not_sounding = v[6];
+    rx->aggregation = v[7];
+    rx->stbc = v[8];
+    rx->fec_coding = v[9];
+    rx->sgi = v[10];
+    rx->noise_floor = v[11];
+    rx->ampdu_cnt = v[12];
+    rx->channel = v[13];
+    rx->secondary_channel = v[14];
+    rx->timestamp = v[15];
+    rx->ant = v[16];
+    rx->sig_len = v[17];
+    rx->rx_state = v[18];
+
+    // an empty buffer has no LLTF to plot, the array must hold exactly len int8 values
+    long long len = v[21];
+    char *p = strchr(cursor, '[');
+    if (p == NULL || len <= 0 || len > CSI_MAX_LEN) {
+        return false;
+    }
+    p++;
+    for (int i = 0; i < len; i++) {
+        char *end;
+        long value = strtol(p, &end, 10);
+        if (end == p || value < INT8_MIN || value > INT8_MAX) {
+            return false;
+        }
+        buf[i] = value;
+        p = end;
+    }
+    while (*p == ' ') {
+        p++;
+    }
+    if (*p != ']') {
+        return false;
+    }
+
+    info->buf = buf;
+    info->len = len;
+    return true;
+}
+
+void _replay_wait_until(int64_t deadline_us) {
+    int64_t wait = deadline_us - esp_timer_get_time();
+    if (wait >= 1000) {
+        vTaskDelay(pdMS_TO_TICKS(wait / 1000));
+    }
+}
+
+/*
+ * Feed every row of the capture into the csi callback from the calling task.
+ * The csi callback must not be registered with the driver at the same time,
+ * the ring only allows a single producer.
+ */
+void replay_run(FILE *capture, const replay_config_t *config, replay_stats_t *stats) {
+    static char line[REPLAY_LINE_LEN];
+    static int8_t buf[CSI_MAX_LEN];
+    wifi_csi_info_t info;
+
+    memset(stats, 0, sizeof(replay_stats_t));
+    stats->pushed_before = csi_ring.pushed.load();
+    stats->overflows_before = csi_ring.overflows.load();
+    stats->filtered_before = stats_drops(STATS_DROP_MAC_FILTER);
+    stats->start_us = esp_timer_get_time();
+
+    bool first = true;
+    uint32_t last_timestamp = 0;
+    int64_t capture_us = 0;    // capture time elapsed since the first frame, wraps of the u32 are unrolled
+
+    while (fgets(line, sizeof(line), capture) != NULL) {
+        stats->rows++;
+        if (!replay_parse_row(line, &info, buf)) {
+            if (strncmp(line, "CSI_DATA,", 9) == 0) {
+                stats->parse_errors++;
+            }
+            continue;
+        }
+
+        if (config->mode == REPLAY_TIMED) {
+            if (!first) {
+                capture_us += (uint32_t) (info.rx_ctrl.timestamp - last_timestamp);
+            }
+            _replay_wait_until(stats->start_us + (int64_t) (capture_us / config->speed));
+        }
+        first = false;
+        last_timestamp = info.rx_ctrl.timestamp;
+
+        _wifi_csi_cb(NULL, &info);
+        stats->frames++;
+    }
+    stats->end_us = esp_timer_get_time();
+}
+
+void replay_print_report(const replay_stats_t *stats) {
+    double seconds = (stats->end_us - stats->start_us) / 1000000.0;
+    uint32_t pushed = csi_ring.pushed.load() - stats->pushed_before;
+    uint32_t overflows = csi_ring.overflows.load() - stats->overflows_before;
+    uint32_t filtered = stats_drops(STATS_DROP_MAC_FILTER) - stats->filtered_before;
+
+    printf("REPLAY: %u rows, %u frames injected, %u parse errors in %.3f s (%.0f frames/s)\n",
+           stats->rows, stats->frames, stats->parse_errors, seconds, seconds > 0 ? stats->frames / seconds : 0.0);
+    printf("REPLAY: %u pushed, %u filtered by mac, %u ring overflows\n", pushed, filtered, overflows);
+    // the latency histograms cover everything received since boot
+    printf("REPLAY: %u received, queue latency avg %u us, p99 <= %u us, max %u us\n", stats_count(STATS_STAGE_QUEUE),
+           stats_mean_us(STATS_STAGE_QUEUE), stats_percentile_us(STATS_STAGE_QUEUE, 99), stats_max_us(STATS_STAGE_QUEUE));
+    if (stats_count(STATS_STAGE_END_TO_END) > 0) {
+        printf("REPLAY: %u plotted, end to end latency avg %u us, max %u us\n", stats_count(STATS_STAGE_END_TO_END),
+               stats_mean_us(STATS_STAGE_END_TO_END), stats_max_us(STATS_STAGE_END_TO_END));
+    }
+}
+
+#ifdef CONFIG_CSI_REPLAY
+void replay_task(void *pvParameters) {
+    FILE *capture = fopen(CONFIG_CSI_REPLAY_FILE, "r");
+    if (capture == NULL) {
+        printf("REPLAY: unable to open %s\n", CONFIG_CSI_REPLAY_FILE);
+        vTaskDelete(NULL);
+        return;
+    }
+
+    replay_config_t config;
+    config.mode = CONFIG_CSI_REPLAY_SPEED > 0 ? REPLAY_TIMED : REPLAY_FAST;
+    config.speed = CONFIG_CSI_REPLAY_SPEED / 100.0f;
+
+    replay_stats_t stats;
+    replay_run(capture, &config, &stats);
+    fclose(capture);
+
+    // give the consumer a moment to drain the ring before reporting
+    vTaskDelay(pdMS_TO_TICKS(100));
+    replay_print_report(&stats);
+    vTaskDelete(NULL);
+}
+#endif
+
+#endif //ESP32_CSI_REPLAY_COMPONENT_H
@@ -0,0 +1,132 @@
+#ifndef ESP32_CSI_RING_COMPONENT_H
+#define ESP32_CSI_RING_COMPONENT_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include "esp_wifi_types.h"
+
+#ifdef CONFIG_CSI_RING_LEN
+#define CSI_RING_LEN CONFIG_CSI_RING_LEN
+#else
+#define CSI_RING_LEN 16
+#endif
+
+// largest csi buffer the driver hands out (HT40 with STBC, 128 + 242 + 242 bytes)
+#define CSI_MAX_LEN 612
+
+static_assert((CSI_RING_LEN & (CSI_RING_LEN - 1)) == 0, "CSI_RING_LEN must be a power of two");
+
+// a received csi packet including a private copy of the iq payload
+typedef struct {
+    wifi_pkt_rx_ctrl_t rx_ctrl;
+    uint8_t mac[6];
+    uint16_t len;
+    int64_t rx_us;      // esp_timer time when the csi callback was entered
+    int8_t buf[CSI_MAX_LEN];
+} csi_frame_t;
+
+typedef enum {
+    CSI_RING_DROP_OLDEST = 0,   // overwrite the oldest unread frame
+    CSI_RING_DROP_NEWEST,       // discard the incoming frame
+} csi_ring_policy_t;
+
+/*
+ * Single-producer/single-consumer ring of preallocated frame slots.
+ * head is only written by the producer. tail is advanced by the consumer after
+ * a pop, and by the producer when it drops the oldest frame, so both sides
+ * advance it with compare-and-swap.
+ */
+typedef struct {
+    csi_frame_t slots[CSI_RING_LEN];
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+    std::atomic<uint32_t> pushed;
+    std::atomic<uint32_t> overflows;
+    std::atomic<uint32_t> truncated;
+    std::atomic<uint32_t> high_water;   // most slots ever filled at once, written by the producer
+    csi_ring_policy_t policy;
+} csi_ring_t;
+
+void csi_ring_init(csi_ring_t *ring, csi_ring_policy_t policy) {
+    ring->head.store(0);
+    ring->tail.store(0);
+    ring->pushed.store(0);
+    ring->overflows.store(0);
+    ring->truncated.store(0);
+    ring->high_water.store(0);
+    ring->policy = policy;
+}
+
+uint32_t csi_ring_count(const csi_ring_t *ring) {
+    return ring->head.load(std::memory_order_acquire) - ring->tail.load(std::memory_order_acquire);
+}
+
+/*
+ * Copy a packet into the next free slot. Never blocks or allocates.
+ * Returns false if the frame was dropped because the ring is full.
+ */
+bool csi_ring_push(csi_ring_t *ring, const wifi_csi_info_t *info, int64_t rx_us) {
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    uint32_t tail = ring->tail.load(std::memory_order_acquire);
+
+    if (head - tail >= CSI_RING_LEN) {
+        if (ring->policy == CSI_RING_DROP_NEWEST) {
+            ring->overflows.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        // a failed exchange means the consumer just freed a slot
+        if (ring->tail.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel)) {
+            ring->overflows.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    csi_frame_t *slot = &ring->slots[head & (CSI_RING_LEN - 1)];
+    uint16_t len = info->len;
+    if (len > CSI_MAX_LEN) {
+        len = CSI_MAX_LEN;
+        ring->truncated.fetch_add(1, std::memory_order_relaxed);
+    }
+    slot->rx_ctrl = info->rx_ctrl;
+    memcpy(slot->mac, info->mac, sizeof(slot->mac));
+    slot->len = len;
+    slot->rx_us = rx_us;
+    memcpy(slot->buf, info->buf, len);
+
+    ring->head.store(head + 1, std::memory_order_release);
+    ring->pushed.fetch_add(1, std::memory_order_relaxed);
+    uint32_t fill = head + 1 - ring->tail.load(std::memory_order_relaxed);
+    if (fill > ring->high_water.load(std::memory_order_relaxed)) {
+        ring->high_water.store(fill, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+/*
+ * Copy the oldest frame out of the ring. Returns false if the ring is empty.
+ * The slot is only released after the copy; if the producer dropped it in the
+ * meantime the copy may be torn, so it is discarded and the next frame is read.
+ */
+bool csi_ring_pop(csi_ring_t *ring, csi_frame_t *out) {
+    while (true) {
+        uint32_t tail = ring->tail.load(std::memory_order_acquire);
+        uint32_t head = ring->head.load(std::memory_order_acquire);
+        if (tail == head) {
+            return false;
+        }
+
+        const csi_frame_t *slot = &ring->slots[tail & (CSI_RING_LEN - 1)];
+        out->rx_ctrl = slot->rx_ctrl;
+        memcpy(out->mac, slot->mac, sizeof(out->mac));
+        uint16_t len = slot->len;
+        out->len = len;
+        out->rx_us = slot->rx_us;
+        memcpy(out->buf, slot->buf, len);
+
+        if (ring->tail.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel)) {
+            return true;
+        }
+    }
+}
+
+#endif //ESP32_CSI_RING_COMPONENT_H
@@ -8,25 +8,124 @@
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_vfs_fat.h"
+#include "esp_vfs_dev.h"
 #include "driver/sdmmc_host.h"
 #include "driver/sdspi_host.h"
 #include "sdmmc_cmd.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "sd_writer_component.h"
+#include "diag_component.h"
+#include "output_component.h"
+#include <atomic>
 
 #define PIN_NUM_MISO 2
 #define PIN_NUM_MOSI 15
 #define PIN_NUM_CLK  14
 #define PIN_NUM_CS   13
 
+#ifdef CONFIG_SEND_CSI_BINARY
+#define SD_FILE_EXT "bin"
+#else
+#define SD_FILE_EXT "csv"
+#endif
+
+#ifdef CONFIG_SD_SYNC_BYTES
+#define SD_SYNC_BYTES CONFIG_SD_SYNC_BYTES
+#else
+#define SD_SYNC_BYTES (64 * 1024)
+#endif
+
+#ifdef CONFIG_SD_SYNC_INTERVAL_MS
+#define SD_SYNC_INTERVAL_MS CONFIG_SD_SYNC_INTERVAL_MS
+#else
+#define SD_SYNC_INTERVAL_MS 1000
+#endif
+
+#define SD_WRITER_TASK_STACK 4096
+
 FILE *f;
 char filename[24] = {0};
 
+// output is buffered here and written by sd_writer_task, never on the caller's thread
+sd_writer_t sd_writer;
+SemaphoreHandle_t sd_writer_mutex = NULL;
+TaskHandle_t sd_writer_task_handle = NULL;
+SemaphoreHandle_t sd_writer_released = NULL;   // given whenever the writer finished a buffer
+std::atomic<bool> sd_sync_requested(false);
+
+int64_t _sd_clock_us() {
+    return esp_timer_get_time();
+}
+
+void sd_writer_task(void *pvParameters) {
+    while (true) {
+        // woken by full buffers, otherwise check for stale data once per sync interval
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SD_SYNC_INTERVAL_MS));
+        // taken once, a request arriving after this is served on the next round
+        bool sync = sd_sync_requested.exchange(false);
+
+        xSemaphoreTake(sd_writer_mutex, portMAX_DELAY);
+        if (sync || sd_writer_active_age_us(&sd_writer) >= (int64_t) SD_SYNC_INTERVAL_MS * 1000) {
+            sd_writer_rotate(&sd_writer);
+        }
+        int idx = sd_writer_ready(&sd_writer);
+        xSemaphoreGive(sd_writer_mutex);
+
+        while (idx >= 0) {
+            sd_writer_write_buffer(&sd_writer, idx);
+
+            xSemaphoreTake(sd_writer_mutex, portMAX_DELAY);
+            sd_writer_release(&sd_writer, idx);
+            idx = sd_writer_ready(&sd_writer);
+            xSemaphoreGive(sd_writer_mutex);
+            xSemaphoreGive(sd_writer_released);
+        }
+
+        if (sync) {
+            sd_writer_sync(&sd_writer);
+        }
+    }
+}
+
+/*
+ * Append to the write buffers, waits while both are taken instead of dropping one,
+ * so a card that cannot keep up fills the queue of the SD output sink and its policy applies
+ */
+void _sd_write(const void *data, size_t len) {
+    const uint8_t *src = (const uint8_t *) data;
+    while (len > 0) {
+        xSemaphoreTake(sd_writer_mutex, portMAX_DELAY);
+        size_t n = sd_writer_room(&sd_writer);
+        n = n < len ? n : len;
+        bool wake = n > 0 && sd_writer_append(&sd_writer, src, n);
+        xSemaphoreGive(sd_writer_mutex);
+
+        if (wake) {
+            xTaskNotifyGive(sd_writer_task_handle);
+        }
+        if (n == 0) {
+            xSemaphoreTake(sd_writer_released, pdMS_TO_TICKS(SD_SYNC_INTERVAL_MS));
+        }
+        src += n;
+        len -= n;
+    }
+}
+
+// write callback of the SD output sink, runs in the sink's worker task
+void _sd_sink_write(void *ctx, const void *data, size_t len) {
+    _sd_write(data, len);
+}
+
 void _sd_pick_next_file() {
     int i = -1;
     struct stat st;
     while (true) {
         i++;
-        printf("Checking %i.csv\n", i);
-        sprintf(filename, "/sdcard/%i.csv", i);
+        printf("Checking %i." SD_FILE_EXT "\n", i);
+        sprintf(filename, "/sdcard/%i." SD_FILE_EXT, i);
 
         if (stat(filename, &st) != 0) {
             break;
@@ -37,7 +136,7 @@ void _sd_pick_next_file() {
 }
 
 void sd_init() {
-#ifdef CONFIG_SEND_CSI_TO_SD
+#if defined CONFIG_SEND_CSI_TO_SD || defined CONFIG_CSI_REPLAY
     sdmmc_host_t host = SDSPI_HOST_DEFAULT();
     sdspi_slot_config_t slot_config = SDSPI_SLOT_CONFIG_DEFAULT();
     slot_config.gpio_miso = (gpio_num_t) PIN_NUM_MISO;
@@ -47,8 +146,8 @@ void sd_init() {
 
     esp_vfs_fat_sdmmc_mount_config_t mount_config = {
             .format_if_mount_failed = false,
-            .max_files = 1,
-            .allocation_unit_size = 16 * 1024
+            .max_files = 2,
+            .allocation_unit_size = SD_WRITER_BUF_LEN
     };
 
     sdmmc_card_t *card;
@@ -70,37 +169,47 @@ void sd_init() {
     } else {
         sdmmc_card_print_info(stdout, card);
 
+#ifdef CONFIG_SEND_CSI_TO_SD
         _sd_pick_next_file();
         f = fopen(filename, "a");
+        if (f == NULL) {
+            ESP_LOGE("sd.h", "Failed to open %s", filename);
+            return;
+        }
+
+        sd_writer_mutex = xSemaphoreCreateMutex();
+        sd_writer_released = xSemaphoreCreateBinary();
+        if (!sd_writer_init(&sd_writer, f, SD_SYNC_BYTES, SD_SYNC_INTERVAL_MS, &_sd_clock_us)) {
+            ESP_LOGE("sd.h", "Failed to allocate SD write buffers");
+            fclose(f);
+            f = NULL;
+            return;
+        }
+        xTaskCreate(&sd_writer_task, "sd_writer", SD_WRITER_TASK_STACK, NULL, 5, &sd_writer_task_handle);
+        diag_register_task(sd_writer_task_handle, "sd_writer", SD_WRITER_TASK_STACK);
+        output_add_sink("sd", OUTPUT_SD, &_sd_sink_write, NULL, OUTPUT_SD_POLICY, OUTPUT_SD_SAMPLE_N);
+#endif
     }
 #endif
 }
 
 /*
- * Printf for both serial AND sd card (if available and configured)
+ * Ask the writer task to write out buffered data and fsync, without blocking the caller
  */
-void outprintf(const char *format, ...) {
-    va_list args;
-    va_start(args, format);
-
-#ifdef CONFIG_SEND_CSI_TO_SERIAL
-    vprintf(format, args);
-#endif
-
+void sd_flush() {
 #ifdef CONFIG_SEND_CSI_TO_SD
     if (f != NULL) {
-        vfprintf(f, format, args);
+        sd_sync_requested.store(true);
+        xTaskNotifyGive(sd_writer_task_handle);
     }
 #endif
-
-    va_end(args);
 }
 
-void sd_flush() {
+void sd_print_stats() {
 #ifdef CONFIG_SEND_CSI_TO_SD
-    fflush(f);
-    fclose(f);
-    f = fopen(filename, "a");
+    if (f != NULL) {
+        sd_writer_print_stats(&sd_writer);
+    }
 #endif
 }
 
@@ -0,0 +1,193 @@
+#ifndef ESP32_CSI_SD_WRITER_COMPONENT_H
+#define ESP32_CSI_SD_WRITER_COMPONENT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+// one FAT cluster, matches allocation_unit_size of the sd mount
+#define SD_WRITER_BUF_LEN (16 * 1024)
+
+/*
+ * Ping-pong buffers between the tasks producing output and the sd writer task.
+ * Producers append into the active buffer, at most sd_writer_room bytes at a
+ * time, and wait for the writer otherwise. A full buffer is handed to the
+ * writer, which writes it in one cluster-sized fwrite and fsyncs on a
+ * size-or-time policy instead of reopening the file.
+ *
+ * Plain C/POSIX on purpose so the logic also runs against a regular file on Linux.
+ * None of the functions lock: append, rotate, ready and release must be
+ * serialized by the caller, write_buffer only touches a buffer already handed off.
+ */
+typedef struct {
+    FILE *file;
+    uint8_t *bufs[2];
+    size_t lens[2];
+    bool pending[2];            // handed to the writer, not yet written
+    int active;                 // buffer being filled by producers
+    int64_t (*clock_us)();
+
+    size_t sync_bytes;          // fsync once this many bytes are unsynced
+    int64_t sync_interval_us;   // or once the last fsync is this old
+    size_t unsynced;
+    int64_t last_sync_us;
+    int64_t active_since_us;    // when the active buffer got its first byte
+
+    // counters, only updated with the caller's lock held or by the writer task
+    uint64_t bytes_written;
+    uint32_t buffers_written;
+    uint32_t write_errors;
+    uint32_t syncs;
+    int64_t stall_us_total;
+    int64_t stall_us_max;
+} sd_writer_t;
+
+bool sd_writer_init(sd_writer_t *w, FILE *file, size_t sync_bytes, uint32_t sync_interval_ms, int64_t (*clock_us)()) {
+    memset(w, 0, sizeof(sd_writer_t));
+    w->bufs[0] = (uint8_t *) malloc(SD_WRITER_BUF_LEN);
+    w->bufs[1] = (uint8_t *) malloc(SD_WRITER_BUF_LEN);
+    if (w->bufs[0] == NULL || w->bufs[1] == NULL) {
+        free(w->bufs[0]);
+        free(w->bufs[1]);
+        w->bufs[0] = w->bufs[1] = NULL;
+        return false;
+    }
+
+    // whole clusters go straight to the filesystem, no stdio copy in between
+    setvbuf(file, NULL, _IONBF, 0);
+    w->file = file;
+    w->clock_us = clock_us;
+    w->sync_bytes = sync_bytes;
+    w->sync_interval_us = (int64_t) sync_interval_ms * 1000;
+    w->last_sync_us = clock_us();
+    return true;
+}
+
+/*
+ * Hand the active buffer to the writer if it holds data.
+ * Returns false if the other buffer is still being written; the active
+ * buffer then keeps its data.
+ */
+bool sd_writer_rotate(sd_writer_t *w) {
+    int next = 1 - w->active;
+    if (w->lens[w->active] == 0 || w->pending[next]) {
+        return false;
+    }
+    w->pending[w->active] = true;
+    w->active = next;
+    w->lens[next] = 0;
+    return true;
+}
+
+void _sd_writer_mark(sd_writer_t *w) {
+    if (w->lens[w->active] == 0) {
+        w->active_since_us = w->clock_us();
+    }
+}
+
+/*
+ * Copy data into the active buffer, a full one is handed off and the rest goes
+ * into the other, which must be free by then. A producer racing the writer
+ * keeps to sd_writer_room. Returns true if a full buffer was handed off, so
+ * the caller should wake the writer.
+ */
+bool sd_writer_append(sd_writer_t *w, const void *data, size_t len) {
+    const uint8_t *src = (const uint8_t *) data;
+    bool handed_off = false;
+
+    while (len > 0) {
+        _sd_writer_mark(w);
+        size_t space = SD_WRITER_BUF_LEN - w->lens[w->active];
+        size_t n = len < space ? len : space;
+        memcpy(w->bufs[w->active] + w->lens[w->active], src, n);
+        w->lens[w->active] += n;
+        src += n;
+        len -= n;
+
+        if (w->lens[w->active] == SD_WRITER_BUF_LEN) {
+            if (!sd_writer_rotate(w)) {
+                // more than sd_writer_room, the rest is not copied
+                break;
+            }
+            handed_off = true;
+        }
+    }
+    return handed_off;
+}
+
+// bytes append takes while the other buffer may still be written, the active one must not fill up meanwhile
+size_t sd_writer_room(const sd_writer_t *w) {
+    size_t space = SD_WRITER_BUF_LEN - w->lens[w->active];
+    return w->pending[1 - w->active] ? space - 1 : space;
+}
+
+// index of a buffer waiting to be written, or -1
+int sd_writer_ready(sd_writer_t *w) {
+    int older = 1 - w->active;
+    if (w->pending[older]) {
+        return older;
+    }
+    return w->pending[w->active] ? w->active : -1;
+}
+
+// age of the data in the active buffer, 0 if it is empty
+int64_t sd_writer_active_age_us(sd_writer_t *w) {
+    return w->lens[w->active] == 0 ? 0 : w->clock_us() - w->active_since_us;
+}
+
+void sd_writer_sync(sd_writer_t *w) {
+    int64_t start = w->clock_us();
+    fflush(w->file);
+    fsync(fileno(w->file));
+    int64_t end = w->clock_us();
+
+    int64_t stall = end - start;
+    w->stall_us_total += stall;
+    if (stall > w->stall_us_max) {
+        w->stall_us_max = stall;
+    }
+    w->syncs++;
+    w->unsynced = 0;
+    w->last_sync_us = end;
+}
+
+/*
+ * Write a handed off buffer to the file and fsync if the policy says so.
+ * Runs in the writer task without the caller's lock, release the buffer afterwards.
+ */
+void sd_writer_write_buffer(sd_writer_t *w, int idx) {
+    size_t len = w->lens[idx];
+    int64_t start = w->clock_us();
+    size_t written = fwrite(w->bufs[idx], 1, len, w->file);
+    int64_t stall = w->clock_us() - start;
+
+    w->stall_us_total += stall;
+    if (stall > w->stall_us_max) {
+        w->stall_us_max = stall;
+    }
+    if (written != len) {
+        w->write_errors++;
+    }
+    w->bytes_written += written;
+    w->buffers_written++;
+    w->unsynced += written;
+
+    if (w->unsynced >= w->sync_bytes || w->clock_us() - w->last_sync_us >= w->sync_interval_us) {
+        sd_writer_sync(w);
+    }
+}
+
+void sd_writer_release(sd_writer_t *w, int idx) {
+    w->lens[idx] = 0;
+    w->pending[idx] = false;
+}
+
+void sd_writer_print_stats(sd_writer_t *w) {
+    printf("SD: %llu bytes written, %u buffers, %u syncs, %u write errors, stall %lld us total / %lld us max\n",
+           (unsigned long long) w->bytes_written, w->buffers_written, w->syncs, w->write_errors,
+           (long long) w->stall_us_total, (long long) w->stall_us_max);
+}
+
+#endif //ESP32_CSI_SD_WRITER_COMPONENT_H
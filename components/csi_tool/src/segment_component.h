@@ -0,0 +1,195 @@
+#ifndef ESP32_CSI_SEGMENT_COMPONENT_H
+#define ESP32_CSI_SEGMENT_COMPONENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_wifi_types.h"
+
+/*
+ * Splits the csi buffer of a frame into its LTF segments without copying.
+ * Which segments are present and which subcarriers each one covers depends
+ * on the secondary channel, signal mode, bandwidth and STBC of the packet,
+ * see the CSI section of the ESP-IDF Wi-Fi guide:
+ *
+ *   secondary  mode    bw  stbc   LLTF            HT-LTF            STBC-HT-LTF      bytes
+ *   none       non HT  20  -      0~31, -32~-1                                        128
+ *   none       HT      20  no     0~31, -32~-1    0~31, -32~-1                        256
+ *   none       HT      20  yes    0~31, -32~-1    0~31, -32~-1      0~31, -32~-1      384
+ *   below      non HT  20  -      0~63                                                128
+ *   below      HT      20  no     0~63            0~63                                256
+ *   below      HT      20  yes    0~63            0~62              0~62              380
+ *   below      HT      40  no     0~63            0~63, -64~-1                        384
+ *   below      HT      40  yes    0~63            0~60, -60~-1      0~60, -60~-1      612
+ *   above      non HT  20  -      -64~-1                                              128
+ *   above      HT      20  no     -64~-1          -64~-1                              256
+ *   above      HT      20  yes    -64~-1          -62~-1            -62~-1            376
+ *   above      HT      40  no     -64~-1          0~63, -64~-1                        384
+ *   above      HT      40  yes    -64~-1          0~60, -60~-1      0~60, -60~-1      612
+ *
+ * Segments the driver was configured not to report (e.g. LLTF only) are
+ * missing from the end of the buffer, so any prefix of a layout is accepted,
+ * as long as it holds at least the LLTF.
+ */
+
+typedef enum {
+    CSI_SEGMENT_LLTF = 0,
+    CSI_SEGMENT_HT_LTF,
+    CSI_SEGMENT_STBC_HT_LTF,
+    CSI_SEGMENT_COUNT,
+} csi_segment_type_t;
+
+// consecutive subcarrier indices first..last
+typedef struct {
+    int8_t first;
+    int8_t last;
+} csi_subc_range_t;
+
+// one or two ranges of subcarriers in buffer order
+typedef struct {
+    uint8_t ranges;
+    csi_subc_range_t range[2];
+} csi_subc_map_t;
+
+typedef struct {
+    csi_segment_type_t type;
+    const int8_t *data;         // iq pairs into the frame buffer, imaginary part first
+    uint16_t subc;
+    csi_subc_map_t map;
+} csi_segment_t;
+
+typedef struct {
+    uint8_t count;
+    csi_segment_t segment[CSI_SEGMENT_COUNT];   // in buffer order, LLTF first
+} csi_segments_t;
+
+typedef struct {
+    uint8_t secondary_channel;  // 0 none, 1 above, 2 below
+    bool ht;
+    bool bw40;
+    bool stbc;
+    uint8_t count;
+    csi_subc_map_t map[CSI_SEGMENT_COUNT];
+} csi_layout_t;
+
+#define CSI_MAP_NONE {0, {{0, 0}, {0, 0}}}
+#define CSI_MAP_1(a, b) {1, {{a, b}, {0, 0}}}
+#define CSI_MAP_2(a, b, c, d) {2, {{a, b}, {c, d}}}
+
+static const csi_layout_t CSI_LAYOUTS[] = {
+    {0, false, false, false, 1, {CSI_MAP_2(0, 31, -32, -1), CSI_MAP_NONE, CSI_MAP_NONE}},
+    {0, true, false, false, 2, {CSI_MAP_2(0, 31, -32, -1), CSI_MAP_2(0, 31, -32, -1), CSI_MAP_NONE}},
+    {0, true, false, true, 3, {CSI_MAP_2(0, 31, -32, -1), CSI_MAP_2(0, 31, -32, -1), CSI_MAP_2(0, 31, -32, -1)}},
+    {2, false, false, false, 1, {CSI_MAP_1(0, 63), CSI_MAP_NONE, CSI_MAP_NONE}},
+    {2, true, false, false, 2, {CSI_MAP_1(0, 63), CSI_MAP_1(0, 63), CSI_MAP_NONE}},
+    {2, true, false, true, 3, {CSI_MAP_1(0, 63), CSI_MAP_1(0, 62), CSI_MAP_1(0, 62)}},
+    {2, true, true, false, 2, {CSI_MAP_1(0, 63), CSI_MAP_2(0, 63, -64, -1), CSI_MAP_NONE}},
+    {2, true, true, true, 3, {CSI_MAP_1(0, 63), CSI_MAP_2(0, 60, -60, -1), CSI_MAP_2(0, 60, -60, -1)}},
+    {1, false, false, false, 1, {CSI_MAP_1(-64, -1), CSI_MAP_NONE, CSI_MAP_NONE}},
+    {1, true, false, false, 2, {CSI_MAP_1(-64, -1), CSI_MAP_1(-64, -1), CSI_MAP_NONE}},
+    {1, true, false, true, 3, {CSI_MAP_1(-64, -1), CSI_MAP_1(-62, -1), CSI_MAP_1(-62, -1)}},
+    {1, true, true, false, 2, {CSI_MAP_1(-64, -1), CSI_MAP_2(0, 63, -64, -1), CSI_MAP_NONE}},
+    {1, true, true, true, 3, {CSI_MAP_1(-64, -1), CSI_MAP_2(0, 60, -60, -1), CSI_MAP_2(0, 60, -60, -1)}},
+};
+
+#define CSI_LAYOUT_COUNT (sizeof(CSI_LAYOUTS) / sizeof(CSI_LAYOUTS[0]))
+
+uint16_t csi_subc_map_len(const csi_subc_map_t *map) {
+    uint16_t n = 0;
+    for (int r = 0; r < map->ranges; r++) {
+        n += map->range[r].last - map->range[r].first + 1;
+    }
+    return n;
+}
+
+// subcarrier index of the i-th entry of a segment
+int8_t csi_segment_index(const csi_segment_t *seg, int i) {
+    int n0 = seg->map.range[0].last - seg->map.range[0].first + 1;
+    return i < n0 ? seg->map.range[0].first + i : seg->map.range[1].first + (i - n0);
+}
+
+/*
+ * Entry of the j-th subcarrier in ascending index order. Two ranges are
+ * always stored positive half first, so the second range comes first.
+ */
+int csi_segment_order(const csi_segment_t *seg, int j) {
+    if (seg->map.ranges < 2) {
+        return j;
+    }
+    int n0 = seg->map.range[0].last - seg->map.range[0].first + 1;
+    int n1 = seg->subc - n0;
+    return j < n1 ? n0 + j : j - n1;
+}
+
+/*
+ * Whether an LLTF subcarrier carries the training symbol. The LLTF is a
+ * 20 MHz symbol on -26..26 around the centre of its channel: the middle of
+ * the 64 indices of the map, 0 without a secondary channel and +-32 with
+ * one. DC and the guards at both edges are reported as zero vectors.
+ */
+bool csi_lltf_has_data(const csi_subc_map_t *map, int8_t index) {
+    if (map->ranges == 0) {
+        return false;
+    }
+    int low = map->range[0].first, high = map->range[0].last;
+    for (int r = 1; r < map->ranges; r++) {
+        low = map->range[r].first < low ? map->range[r].first : low;
+        high = map->range[r].last > high ? map->range[r].last : high;
+    }
+    int offset = index - (low + high + 1) / 2;
+    return offset != 0 && offset >= -26 && offset <= 26;
+}
+
+const csi_layout_t *csi_find_layout(uint8_t secondary_channel, bool ht, bool bw40, bool stbc) {
+    if (!ht) {
+        // bandwidth and stbc are only defined for HT packets
+        bw40 = false;
+        stbc = false;
+    }
+    for (size_t i = 0; i < CSI_LAYOUT_COUNT; i++) {
+        const csi_layout_t *l = &CSI_LAYOUTS[i];
+        if (l->secondary_channel == secondary_channel && l->ht == ht && l->bw40 == bw40 && l->stbc == stbc) {
+            return l;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Fill out with views into buf for every segment of the layout, len in bytes.
+ * Returns false if the layout is unknown, the buffer is empty or len is not
+ * a prefix of the layout.
+ */
+bool csi_parse_layout(const csi_layout_t *layout, const int8_t *buf, uint16_t len, csi_segments_t *out) {
+    out->count = 0;
+    if (layout == NULL) {
+        return false;
+    }
+    uint16_t offset = 0;
+    for (int s = 0; s < layout->count && offset < len; s++) {
+        csi_segment_t *seg = &out->segment[s];
+        seg->type = (csi_segment_type_t) s;
+        seg->map = layout->map[s];
+        seg->subc = csi_subc_map_len(&seg->map);
+        seg->data = buf + offset;
+        offset += seg->subc * 2;
+        out->count++;
+    }
+    if (out->count == 0 || offset != len) {
+        out->count = 0;
+        return false;
+    }
+    return true;
+}
+
+// whether the frame carried the given segment, the ones after the last reported are missing
+bool csi_has_segment(const csi_segments_t *segments, csi_segment_type_t type) {
+    return type < segments->count;
+}
+
+bool csi_parse_segments(const wifi_pkt_rx_ctrl_t *rx_ctrl, const int8_t *buf, uint16_t len, csi_segments_t *out) {
+    const csi_layout_t *layout = csi_find_layout(rx_ctrl->secondary_channel, rx_ctrl->sig_mode == 1,
+                                                 rx_ctrl->cwb == 1, rx_ctrl->stbc != 0);
+    return csi_parse_layout(layout, buf, len, out);
+}
+
+#endif //ESP32_CSI_SEGMENT_COMPONENT_H
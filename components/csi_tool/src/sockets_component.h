@@ -1,22 +1,29 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
+#include <errno.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <signal.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include "freertos/task.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
 #include <esp_http_server.h>
+#include "esp_timer.h"
+#include "time_component.h"
+#include "pacer_component.h"
 
 char *data = (char *) "1\n";
 
 void socket_transmitter_sta_loop(bool (*is_wifi_connected)()) {
     int socket_fd = -1;
+    pacer_start(&packet_pacer, PACKET_RATE, PACER_MAX_BURST);
     while (1) {
         close(socket_fd);
         char *ip = (char *) "192.168.4.1";
@@ -45,29 +52,22 @@ void socket_transmitter_sta_loop(bool (*is_wifi_connected)()) {
         }
 
         printf("sending frames.\n");
-        double lag = 0.0;
         while (1) {
-            double start_time = get_steady_clock_timestamp();
+            uint32_t due = pacer_wait(&packet_pacer);
             if (!is_wifi_connected()) {
                 printf("ERROR: wifi is not connected\n");
                 break;
             }
 
-            if (sendto(socket_fd, &data, strlen(data), 0, (const struct sockaddr *) &caddr, sizeof(caddr)) !=
-                strlen(data)) {
-                vTaskDelay(1);
-                continue;
+            for (uint32_t i = 0; i < due; i++) {
+                if (sendto(socket_fd, data, strlen(data), 0, (const struct sockaddr *) &caddr, sizeof(caddr)) !=
+                    (ssize_t) strlen(data)) {
+                    // out of buffers, the deadline stays due and is retried after a tick
+                    vTaskDelay(1);
+                    break;
+                }
+                pacer_sent(&packet_pacer, esp_timer_get_time());
             }
-
-#if defined CONFIG_PACKET_RATE && (CONFIG_PACKET_RATE > 0)
-            double wait_duration = (1000.0 / CONFIG_PACKET_RATE) - lag;
-            int w = floor(wait_duration);
-            vTaskDelay(w);
-#else
-            vTaskDelay(10); // This limits TX to approximately 100 per second.
-#endif
-            double end_time = get_steady_clock_timestamp();
-            lag = end_time - start_time;
         }
     }
 }
@@ -0,0 +1,149 @@
+#ifndef ESP32_CSI_STATS_COMPONENT_H
+#define ESP32_CSI_STATS_COMPONENT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+
+/*
+ * Per-stage latency histograms and drop counters for the csi pipeline.
+ * Every histogram and counter has a single writer task, so updates are a
+ * relaxed load and store instead of a locked read-modify-write. Readers may
+ * see a slightly stale snapshot, which is fine for a diagnostics dump.
+ */
+
+// bucket 0 holds 0 us, bucket i holds [2^(i-1), 2^i) us, the last one everything above
+#define STATS_BUCKETS 24
+
+typedef enum {
+    STATS_STAGE_CALLBACK = 0,   // time spent inside the csi callback, entry to enqueue
+    STATS_STAGE_QUEUE,          // callback entry to dequeue by the consumer
+    STATS_STAGE_FOLD,           // folding a frame into the display window and the motion detector
+    STATS_STAGE_WINDOW,         // computing the plotted values of a finished display window
+    STATS_STAGE_CHART,          // chart update of a plotted frame
+    STATS_STAGE_END_TO_END,     // callback entry to chart update
+    STATS_STAGE_PACER,          // transmitted packet past its scheduled send time
+    STATS_STAGE_COUNT,
+} stats_stage_t;
+
+typedef enum {
+    STATS_DROP_MAC_FILTER = 0,  // packet from a transmitter that is not allowed
+    STATS_DROP_AGGREGATE_RESET, // discarded from a display window restarted by a change of subcarriers
+    STATS_DROP_LAYOUT,          // csi length does not match the packet's LTF layout, not displayed
+    STATS_DROP_COUNT,
+} stats_drop_t;
+
+static const char *STATS_STAGE_NAMES[STATS_STAGE_COUNT] = {"callback", "queue", "fold", "window", "chart", "end_to_end", "pacer"};
+static const char *STATS_DROP_NAMES[STATS_DROP_COUNT] = {"mac_filter", "aggregate_reset", "layout"};
+
+typedef struct {
+    std::atomic<uint32_t> buckets[STATS_BUCKETS];
+    std::atomic<uint32_t> count;
+    std::atomic<uint32_t> max_us;
+    std::atomic<uint64_t> sum_us;
+} stats_hist_t;
+
+typedef struct {
+    stats_hist_t stages[STATS_STAGE_COUNT];
+    std::atomic<uint32_t> drops[STATS_DROP_COUNT];
+} stats_t;
+
+stats_t csi_stats;
+
+void _stats_add(std::atomic<uint32_t> *counter, uint32_t n) {
+    counter->store(counter->load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+int _stats_bucket(uint32_t us) {
+    int bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+    return bucket < STATS_BUCKETS ? bucket : STATS_BUCKETS - 1;
+}
+
+void stats_record(stats_stage_t stage, int64_t us) {
+    stats_hist_t *hist = &csi_stats.stages[stage];
+    uint32_t value = us < 0 ? 0 : (us > UINT32_MAX ? UINT32_MAX : (uint32_t) us);
+
+    _stats_add(&hist->buckets[_stats_bucket(value)], 1);
+    _stats_add(&hist->count, 1);
+    if (value > hist->max_us.load(std::memory_order_relaxed)) {
+        hist->max_us.store(value, std::memory_order_relaxed);
+    }
+    hist->sum_us.store(hist->sum_us.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+// clear every histogram and counter, only while nothing records, e.g. before collection starts
+void stats_reset() {
+    for (int s = 0; s < STATS_STAGE_COUNT; s++) {
+        stats_hist_t *hist = &csi_stats.stages[s];
+        for (int i = 0; i < STATS_BUCKETS; i++) {
+            hist->buckets[i].store(0, std::memory_order_relaxed);
+        }
+        hist->count.store(0, std::memory_order_relaxed);
+        hist->max_us.store(0, std::memory_order_relaxed);
+        hist->sum_us.store(0, std::memory_order_relaxed);
+    }
+    for (int d = 0; d < STATS_DROP_COUNT; d++) {
+        csi_stats.drops[d].store(0, std::memory_order_relaxed);
+    }
+}
+
+// count frames lost for one reason
+void stats_drop(stats_drop_t reason, uint32_t frames) {
+    _stats_add(&csi_stats.drops[reason], frames);
+}
+
+uint32_t stats_drops(stats_drop_t reason) {
+    return csi_stats.drops[reason].load(std::memory_order_relaxed);
+}
+
+uint32_t stats_count(stats_stage_t stage) {
+    return csi_stats.stages[stage].count.load(std::memory_order_relaxed);
+}
+
+uint32_t stats_mean_us(stats_stage_t stage) {
+    uint32_t count = stats_count(stage);
+    return count > 0 ? csi_stats.stages[stage].sum_us.load(std::memory_order_relaxed) / count : 0;
+}
+
+uint32_t stats_max_us(stats_stage_t stage) {
+    return csi_stats.stages[stage].max_us.load(std::memory_order_relaxed);
+}
+
+// upper bound of the bucket holding the given percentile
+uint32_t stats_percentile_us(stats_stage_t stage, uint32_t percentile) {
+    const stats_hist_t *hist = &csi_stats.stages[stage];
+    uint32_t count = hist->count.load(std::memory_order_relaxed);
+    uint64_t target = ((uint64_t) count * percentile + 99) / 100;
+    uint64_t seen = 0;
+
+    for (int i = 0; i < STATS_BUCKETS; i++) {
+        seen += hist->buckets[i].load(std::memory_order_relaxed);
+        if (seen >= target && seen > 0) {
+            return i == 0 ? 0 : (1u << i) - 1;
+        }
+    }
+    return hist->max_us.load(std::memory_order_relaxed);
+}
+
+void stats_print() {
+    for (int s = 0; s < STATS_STAGE_COUNT; s++) {
+        stats_stage_t stage = (stats_stage_t) s;
+        printf("STATS %s: n=%u mean=%uus p50<=%uus p99<=%uus max=%uus |", STATS_STAGE_NAMES[s], stats_count(stage),
+               stats_mean_us(stage), stats_percentile_us(stage, 50), stats_percentile_us(stage, 99), stats_max_us(stage));
+        for (int i = 0; i < STATS_BUCKETS; i++) {
+            uint32_t n = csi_stats.stages[s].buckets[i].load(std::memory_order_relaxed);
+            if (n > 0) {
+                printf(" <%lu:%u", i == 0 ? 1ul : 1ul << i, n);
+            }
+        }
+        printf("\n");
+    }
+
+    printf("STATS drops:");
+    for (int d = 0; d < STATS_DROP_COUNT; d++) {
+        printf(" %s=%u", STATS_DROP_NAMES[d], stats_drops((stats_drop_t) d));
+    }
+    printf("\n");
+}
+
+#endif //ESP32_CSI_STATS_COMPONENT_H
@@ -0,0 +1,190 @@
+#ifndef ESP32_CSI_STREAM_COMPONENT_H
+#define ESP32_CSI_STREAM_COMPONENT_H
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <atomic>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "record_component.h"
+#include "datagram_component.h"
+#include "output_component.h"
+
+/*
+ * Streams every CSI frame as binary records over UDP, several records per
+ * datagram (datagram_component.h), so CSI can be collected at full packet
+ * rate over Wi-Fi instead of through the serial port.
+ *
+ * The consumer of the csi ring packs records into a datagram and hands it
+ * to the "stream" message sink of the output fan-out once it is full or
+ * STREAM_FLUSH_MS old. The sink's queue and worker task send it, with the
+ * policy of OUTPUT STREAM: by default a datagram that does not fit into the
+ * queue is dropped and shows up as a gap in the datagram and frame
+ * sequences at the receiver.
+ */
+
+#ifdef CONFIG_CSI_STREAM_MAX_PAYLOAD
+#define STREAM_MAX_PAYLOAD CONFIG_CSI_STREAM_MAX_PAYLOAD
+#else
+#define STREAM_MAX_PAYLOAD 1460     // 1500 byte MTU without IP and UDP headers, as lwIP's TCP_MSS
+#endif
+
+#define STREAM_FLUSH_MS 20          // latest send time of a partly filled datagram
+
+typedef struct {
+    int socket_fd;
+    struct sockaddr_in addr;
+
+    // datagram being filled, owned by the producer once stream_start added the sink
+    uint8_t data[STREAM_MAX_PAYLOAD];
+    size_t len;
+    uint8_t count;
+    int64_t started_us;
+    uint32_t seq;
+    uint32_t frame_seq;
+
+    // single writer each, read for statistics
+    std::atomic<uint32_t> frames;
+    std::atomic<uint32_t> frames_skipped;   // sampled out or larger than a datagram
+    std::atomic<uint32_t> datagrams;
+    std::atomic<uint32_t> send_errors;
+} stream_t;
+
+stream_t csi_stream;
+
+void _stream_inc(std::atomic<uint32_t> *counter) {
+    counter->store(counter->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+// the stream sink once stream_start succeeded and while OUTPUT STREAM is on, else NULL
+output_sink_t *stream_sink() {
+    return output_is_enabled(OUTPUT_STREAM) ? output_find_sink(OUTPUT_STREAM) : NULL;
+}
+
+// write the header and queue the current datagram, a datagram the sink drops still takes its number
+void _stream_close(stream_t *s, output_sink_t *sink) {
+    csi_datagram_header_t header;
+    header.count = s->count;
+    header.seq = s->seq++;
+    header.first_frame = s->frame_seq - s->count;
+    csi_datagram_write_header(&header, s->data);
+    output_send(sink, s->data, s->len);
+    s->len = CSI_DATAGRAM_HEADER_LEN;
+    s->count = 0;
+}
+
+/*
+ * Append one record, called by the consumer of the csi ring for every frame.
+ * Waits only if the stream sink has the block policy.
+ */
+void stream_frame(const csi_record_t *rec) {
+    output_sink_t *sink = stream_sink();
+    if (sink == NULL) {
+        return;
+    }
+    stream_t *s = &csi_stream;
+    if (output_offer(sink)) {
+        for (int attempt = 0; attempt < 2; attempt++) {
+            if (s->count == 0) {
+                s->started_us = esp_timer_get_time();
+            }
+            size_t len = s->count < UINT8_MAX ? csi_record_encode(rec, s->data + s->len, STREAM_MAX_PAYLOAD - s->len) : 0;
+            if (len > 0) {
+                s->len += len;
+                s->count++;
+                s->frame_seq++;
+                _stream_inc(&s->frames);
+                return;
+            }
+            if (s->count == 0) {
+                // larger than an empty datagram
+                break;
+            }
+            _stream_close(s, sink);
+        }
+    }
+    s->frame_seq++;
+    _stream_inc(&s->frames_skipped);
+}
+
+/*
+ * Send a datagram of its own, e.g. an event, called by the same task as stream_frame.
+ * Goes out while the frames are paused, so the stream can carry only events.
+ */
+bool stream_send(const void *data, size_t len) {
+    output_sink_t *sink = output_find_sink(OUTPUT_STREAM);
+    return sink != NULL && len <= STREAM_MAX_PAYLOAD && output_send(sink, data, len);
+}
+
+// send a partly filled datagram once it is STREAM_FLUSH_MS old, called by the same task as stream_frame
+void stream_poll() {
+    stream_t *s = &csi_stream;
+    output_sink_t *sink = stream_sink();
+    if (sink != NULL && s->count > 0 && esp_timer_get_time() - s->started_us >= STREAM_FLUSH_MS * 1000) {
+        _stream_close(s, sink);
+    }
+}
+
+// write callback of the stream sink, one datagram per call from the sink's worker
+void _stream_sink_write(void *ctx, const void *data, size_t len) {
+    stream_t *s = (stream_t *) ctx;
+    ssize_t sent = sendto(s->socket_fd, data, len, 0, (const struct sockaddr *) &s->addr, sizeof(s->addr));
+    if (sent == (ssize_t) len) {
+        _stream_inc(&s->datagrams);
+    } else {
+        _stream_inc(&s->send_errors);
+    }
+}
+
+// open the socket and add the stream sink, frames are streamed from then on
+bool stream_start(const char *host, uint16_t port) {
+    stream_t *s = &csi_stream;
+    memset(&s->addr, 0, sizeof(s->addr));
+    s->addr.sin_family = AF_INET;
+    s->addr.sin_port = htons(port);
+    if (inet_aton(host, &s->addr.sin_addr) == 0) {
+        printf("STREAM: invalid address %s\n", host);
+        return false;
+    }
+    s->socket_fd = socket(PF_INET, SOCK_DGRAM, 0);
+    if (s->socket_fd < 0) {
+        printf("STREAM: socket creation error [%s]\n", strerror(errno));
+        return false;
+    }
+
+    s->len = CSI_DATAGRAM_HEADER_LEN;
+    s->count = 0;
+    if (output_add_message_sink("stream", OUTPUT_STREAM, &_stream_sink_write, s, OUTPUT_STREAM_POLICY,
+                                OUTPUT_STREAM_SAMPLE_N) == NULL) {
+        close(s->socket_fd);
+        return false;
+    }
+    output_set_enabled(OUTPUT_STREAM, true);
+    printf("STREAM: sending CSI to %s:%u\n", host, port);
+    return true;
+}
+
+// pause or resume a started stream, returns false if stream_start was not called
+bool stream_set_enabled(bool enabled) {
+    if (output_find_sink(OUTPUT_STREAM) == NULL) {
+        return false;
+    }
+    output_set_enabled(OUTPUT_STREAM, enabled);
+    return true;
+}
+
+void stream_print_stats() {
+    if (output_find_sink(OUTPUT_STREAM) == NULL) {
+        return;
+    }
+    printf("STREAM%s: %u frames in %u datagrams, %u frames skipped, %u send errors\n",
+           stream_sink() != NULL ? "" : " (paused)", csi_stream.frames.load(), csi_stream.datagrams.load(),
+           csi_stream.frames_skipped.load(), csi_stream.send_errors.load());
+}
+
+#endif //ESP32_CSI_STREAM_COMPONENT_H
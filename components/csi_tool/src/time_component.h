@@ -1,31 +1,42 @@
 #ifndef ESP32_CSI_TIME_COMPONENT_H
 #define ESP32_CSI_TIME_COMPONENT_H
 
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/time.h>
 #include <chrono>
+#include "esp_timer.h"
+#include "clock_component.h"
 
-static char *SET_TIMESTAMP_SIMPLE_TEMPLATE = (char *) "%li.%li";
-static char *SET_TIMESTAMP_TEMPLATE = (char *) "SETTIME: %li.%li";
+// the fraction is read as digits, so "1700000000.5" is half a second and not 5 us
+static char *SET_TIMESTAMP_SIMPLE_TEMPLATE = (char *) "%li.%6[0-9]";
+static char *SET_TIMESTAMP_TEMPLATE = (char *) "SETTIME: %li.%6[0-9]";
 
 bool real_time_set = false;
-
-bool match_set_timestamp_template(char *candidate_string) {
-    long int tv_sec;
-    long int tv_usec;
-    return sscanf(candidate_string, SET_TIMESTAMP_TEMPLATE, &tv_sec, &tv_usec) > 0;
-}
+// esp_timer microseconds to wall time, frames are stamped through this instead of the system clock
+clock_map_t csi_clock;
 
 void time_set(char *timestamp_string) {
     long int tv_sec;
-    long int tv_usec;
+    char fraction[7] = "";
 
-    int res = sscanf(timestamp_string, SET_TIMESTAMP_TEMPLATE, &tv_sec, &tv_usec);
+    int res = sscanf(timestamp_string, SET_TIMESTAMP_TEMPLATE, &tv_sec, fraction);
     if (res <= 0) {
-        res = sscanf(timestamp_string, SET_TIMESTAMP_SIMPLE_TEMPLATE, &tv_sec, &tv_usec);
+        res = sscanf(timestamp_string, SET_TIMESTAMP_SIMPLE_TEMPLATE, &tv_sec, fraction);
     }
 
-    if (res > 0) {
+    if (res > 0 && (tv_sec < 0 || (unsigned long) tv_sec > UINT32_MAX)) {
+        printf("Time %s out of range\n", timestamp_string);
+    } else if (res > 0) {
+        long int tv_usec = 0;
+        int digits = strlen(fraction);
+        for (int i = 0; i < 6; i++) {
+            tv_usec = tv_usec * 10 + (i < digits ? fraction[i] - '0' : 0);
+        }
         struct timeval now = {.tv_sec = tv_sec, .tv_usec = tv_usec};
         settimeofday(&now, NULL);
+        clock_map_sync(&csi_clock, esp_timer_get_time(), (int64_t) tv_sec * 1000000 + tv_usec);
         real_time_set = true;
     }
 }
@@ -0,0 +1,152 @@
+#ifndef ESP32_CSI_WATERFALL_COMPONENT_H
+#define ESP32_CSI_WATERFALL_COMPONENT_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "segment_component.h"
+
+/*
+ * Time x subcarrier heatmap of the per-window mean amplitude.
+ * Every display window adds one row to a circular history of uint8 levels,
+ * which is rendered through a colormap into an RGB565 pixel buffer (the
+ * buffer of an lv_canvas on the device). The newest row is at the top;
+ * adding a row scrolls the pixels down by one line and only renders that line.
+ * Guard and DC subcarriers are left out by their index, so the columns
+ * only show subcarriers that carry data.
+ */
+
+// entries of a window, the LLTF has 64
+#define WATERFALL_MAX_SUBC 128
+// full scale never shrinks below this amplitude, so noise is not stretched over the whole colormap
+#define WATERFALL_MIN_SCALE 8.0f
+
+typedef struct {
+    uint16_t cols;
+    uint16_t rows;
+    uint8_t *history;           // rows x cols levels, row head is the newest
+    uint16_t head;
+    uint16_t filled;
+    float full_scale;           // amplitude mapped to level 255, follows the recent peak
+    uint16_t subc;              // layout of the last window
+    csi_subc_map_t map;
+    uint8_t used;               // its entries carrying data, in ascending subcarrier order
+    uint8_t data[WATERFALL_MAX_SUBC];
+} waterfall_t;
+
+// RGB565 colormap from dark blue over teal and green to yellow, built by waterfall_init
+uint16_t waterfall_lut[256];
+
+void _waterfall_build_lut() {
+    static const uint8_t stops[5][3] = {
+        {68, 1, 84}, {59, 82, 139}, {33, 145, 140}, {94, 201, 98}, {253, 231, 37}
+    };
+    for (int level = 0; level < 256; level++) {
+        int seg = level * 4 / 256;
+        int frac = level * 4 - seg * 256;   // position inside the segment, 0..255
+        uint8_t rgb[3];
+        for (int c = 0; c < 3; c++) {
+            rgb[c] = stops[seg][c] + (((stops[seg + 1][c] - stops[seg][c]) * frac) >> 8);
+        }
+        waterfall_lut[level] = (rgb[0] >> 3) << 11 | (rgb[1] >> 2) << 5 | (rgb[2] >> 3);
+    }
+}
+
+bool waterfall_init(waterfall_t *wf, uint16_t cols, uint16_t rows) {
+    memset(wf, 0, sizeof(waterfall_t));
+    wf->history = (uint8_t *) calloc(cols * rows, 1);
+    if (wf->history == NULL) {
+        return false;
+    }
+    wf->cols = cols;
+    wf->rows = rows;
+    wf->full_scale = WATERFALL_MIN_SCALE;
+    _waterfall_build_lut();
+    return true;
+}
+
+// pick the entries with data, once per layout
+void _waterfall_set_layout(waterfall_t *wf, uint16_t subc, const csi_subc_map_t *map) {
+    wf->subc = subc;
+    wf->map = *map;
+    wf->used = 0;
+    csi_segment_t layout;
+    layout.subc = subc;
+    layout.map = *map;
+    for (int j = 0; j < subc && j < WATERFALL_MAX_SUBC; j++) {
+        if (csi_lltf_has_data(map, csi_segment_index(&layout, csi_segment_order(&layout, j)))) {
+            wf->data[wf->used++] = j;
+        }
+    }
+}
+
+/*
+ * Quantize the mean amplitude of a window into a new history row. mean holds
+ * subc values in ascending subcarrier order, map says which subcarriers they
+ * are. The ones carrying data are stretched over the full width by nearest
+ * neighbour.
+ */
+void waterfall_push(waterfall_t *wf, const float *mean, uint16_t subc, const csi_subc_map_t *map) {
+    wf->head = wf->head == 0 ? wf->rows - 1 : wf->head - 1;
+    if (wf->filled < wf->rows) {
+        wf->filled++;
+    }
+    uint8_t *row = wf->history + wf->head * wf->cols;
+
+    if (subc != wf->subc || memcmp(map, &wf->map, sizeof(csi_subc_map_t)) != 0) {
+        _waterfall_set_layout(wf, subc, map);
+    }
+    if (wf->used == 0) {
+        memset(row, 0, wf->cols);
+        return;
+    }
+
+    float peak = 0.0f;
+    for (int i = 0; i < wf->used; i++) {
+        if (mean[wf->data[i]] > peak) {
+            peak = mean[wf->data[i]];
+        }
+    }
+    // jump up to a new peak, decay slowly so older rows stay comparable
+    if (peak > wf->full_scale) {
+        wf->full_scale = peak;
+    } else {
+        wf->full_scale += (peak - wf->full_scale) / 32;
+    }
+    if (wf->full_scale < WATERFALL_MIN_SCALE) {
+        wf->full_scale = WATERFALL_MIN_SCALE;
+    }
+
+    float gain = 255.0f / wf->full_scale;
+    for (int x = 0; x < wf->cols; x++) {
+        float level = mean[wf->data[x * wf->used / wf->cols]] * gain;
+        row[x] = level >= 255.0f ? 255 : (uint8_t) level;
+    }
+}
+
+void _waterfall_render_row(const waterfall_t *wf, int age, uint16_t *pixels) {
+    uint16_t *out = pixels + age * wf->cols;
+    if (age >= wf->filled) {
+        memset(out, 0, wf->cols * sizeof(uint16_t));
+        return;
+    }
+    const uint8_t *row = wf->history + ((wf->head + age) % wf->rows) * wf->cols;
+    for (int x = 0; x < wf->cols; x++) {
+        out[x] = waterfall_lut[row[x]];
+    }
+}
+
+// redraw the whole history, e.g. when the view becomes visible again
+void waterfall_render(const waterfall_t *wf, uint16_t *pixels) {
+    for (int age = 0; age < wf->rows; age++) {
+        _waterfall_render_row(wf, age, pixels);
+    }
+}
+
+// move the drawn rows down by one line and draw the row added last on top
+void waterfall_scroll(const waterfall_t *wf, uint16_t *pixels) {
+    memmove(pixels + wf->cols, pixels, (wf->rows - 1) * wf->cols * sizeof(uint16_t));
+    _waterfall_render_row(wf, 0, pixels);
+}
+
+#endif //ESP32_CSI_WATERFALL_COMPONENT_H
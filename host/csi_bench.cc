@@ -0,0 +1,126 @@
+/**
+ * @file csi_bench.cc
+ * Run the kernel benchmarks of bench_component.h on Linux, print ns and frames
+ * per second for every kernel and frame length, and optionally write them as
+ * JSON and check them against a baseline written by an earlier run.
+ *
+ * usage: csi_bench [-k kernel name filter] [-j results.json]
+ *        [-b baseline.json] [-t tolerance, 0.25 = 25 % slower than the baseline fails]
+ * Exits with 1 if any kernel regressed beyond the tolerance.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_system.h"
+#include "esp_wifi.h"
+#include "esp_log.h"
+
+/* CSI-Tool specific */
+#include "csi_tool/csi_tool.h"
+#include "csi_tool/src/bench_component.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define DEFAULT_TOLERANCE 0.25
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static bench_result_t results[BENCH_MAX_RESULTS];
+
+/**********************
+ *      BASELINE
+ **********************/
+
+// returns the number of kernels slower than the baseline by more than tolerance, -1 if it cannot be read
+static int compare_baseline(const char *path, const bench_result_t *results, int count, double tolerance) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        return -1;
+    }
+    int regressions = 0, compared = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char kernel[32];
+        unsigned int len;
+        double ns;
+        if (sscanf(line, " {\"kernel\": \"%31[^\"]\", \"len\": %u, \"ns_per_frame\": %lf", kernel, &len, &ns) != 3) {
+            continue;
+        }
+        for (int i = 0; i < count; i++) {
+            const bench_result_t *r = &results[i];
+            if (strcmp(r->kernel, kernel) != 0 || r->len != len) {
+                continue;
+            }
+            compared++;
+            double change = ns > 0 ? r->ns_per_op / ns - 1 : 0;
+            bool regressed = change > tolerance;
+            regressions += regressed;
+            printf("%-16s %5u %10.1f -> %10.1f ns %+6.1f%%%s\n", kernel, len, ns, r->ns_per_op, change * 100,
+                   regressed ? "  REGRESSION" : "");
+        }
+    }
+    fclose(file);
+    printf("%d of %d kernels compared against %s regressed by more than %.0f%%\n", regressions, compared, path,
+           tolerance * 100);
+    return regressions;
+}
+
+/**********************
+ *   APPLICATION MAIN
+ **********************/
+int main(int argc, char **argv) {
+    const char *filter = NULL;
+    const char *json_path = NULL;
+    const char *baseline_path = NULL;
+    double tolerance = DEFAULT_TOLERANCE;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "k:j:b:t:h")) != -1) {
+        switch (opt) {
+            case 'k':
+                filter = optarg;
+                break;
+            case 'j':
+                json_path = optarg;
+                break;
+            case 'b':
+                baseline_path = optarg;
+                break;
+            case 't':
+                tolerance = atof(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-k kernel] [-j results.json] [-b baseline.json] [-t tolerance]\n", argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    int count = bench_run(filter, results, BENCH_MAX_RESULTS);
+    bench_print(results, count);
+
+    if (json_path != NULL) {
+        FILE *out = fopen(json_path, "w");
+        if (out == NULL) {
+            perror(json_path);
+            return 1;
+        }
+        bench_write_json(out, results, count);
+        fclose(out);
+    }
+
+    if (baseline_path != NULL) {
+        int regressions = compare_baseline(baseline_path, results, count, tolerance);
+        if (regressions != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
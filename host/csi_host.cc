@@ -0,0 +1,278 @@
+/**
+ * @file csi_host.cc
+ * Run the CSI pipeline on Linux: a synthetic Wi-Fi task or a capture replay feeds
+ * the CSI callback, the dsp task drains the ring, writes every frame to the outputs
+ * and publishes display windows, which the main thread picks up like guiTask does
+ * on the device.
+ *
+ * usage: csi_host [-r packets per second, 0 = unpaced] [-n packets] [-l csi bytes]
+ *        [-m seconds, alternate a still and a moving room instead of the rotating channel]
+ *        csi_host -f capture.csv [-s speed, 1 = original timing, 0 = as fast as possible]
+ * Either form also takes -u ip:port to stream the frames to csi_receiver,
+ * -i to read console commands from stdin like the device's serial port,
+ * which keeps it running until stdin is closed, -q to drop the CSV rows
+ * written to stdout, like OUTPUT SERIAL OFF, and -o capture.csv to also write
+ * them to a file through a sink of its own, the stand-in for the SD card, with
+ * -p block|drop|<n> as its policy for a full queue, <n> keeps every n-th frame.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_system.h"
+#include "esp_wifi.h"
+#include "esp_log.h"
+
+/* CSI-Tool specific */
+#include "csi_tool/csi_tool.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define DEFAULT_RATE 1000
+#define DEFAULT_PACKETS 10000
+#define DEFAULT_CSI_LEN 128
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static uint32_t packet_rate = DEFAULT_RATE;
+static uint32_t packet_count = DEFAULT_PACKETS;
+static uint16_t csi_len = DEFAULT_CSI_LEN;
+static float motion_period = 0;
+static FILE *capture = NULL;
+static float replay_speed = 1.0f;
+static char *stream_target = NULL;
+static bool console = false;
+static bool quiet = false;
+static FILE *output_file = NULL;
+static output_policy_t output_file_policy = OUTPUT_POLICY_BLOCK;
+static uint32_t output_file_sample_n = 1;
+static replay_stats_t replay_stats;
+static std::atomic<bool> producer_done(false);
+
+static const char *TAG = "csi_host";
+
+/**********************
+ *   SYNTHETIC WIFI
+ **********************/
+
+static void synthetic_wifi_task(void *pvParameters) {
+    static int8_t buf[CSI_MAX_LEN];
+    wifi_csi_info_t info;
+    memset(&info, 0, sizeof(info));
+    unsigned int mac[6];
+    sscanf(MAC_AP, "%x:%x:%x:%x:%x:%x", &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5]);
+    for (int i = 0; i < 6; i++) {
+        info.mac[i] = mac[i];
+    }
+    info.rx_ctrl.rssi = -45;
+    info.rx_ctrl.sig_mode = 1;
+    info.rx_ctrl.channel = CONFIG_WIFI_CHANNEL;
+    info.rx_ctrl.noise_floor = -95;
+    info.rx_ctrl.sig_len = 44;
+    // HT 20 MHz without secondary channel: 128 bytes LLTF, 256 adds HT-LTF, 384 STBC-HT-LTF
+    info.rx_ctrl.stbc = csi_len > 256;
+    info.buf = buf;
+    info.len = csi_len;
+
+    // every synthetic frame stands for the answer to one paced packet, like on the device
+    if (packet_rate > 0) {
+        pacer_start(&packet_pacer, packet_rate, PACER_MAX_BURST);
+    }
+    uint32_t n = 0;
+    while (n < packet_count) {
+        uint32_t due = packet_rate > 0 ? pacer_wait(&packet_pacer) : 1;
+        for (uint32_t i = 0; i < due && n < packet_count; i++, n++) {
+            if (motion_period > 0) {
+                // fixed multipath and receiver noise, every other period a reflector moves through the room
+                double t = (double) n / (packet_rate > 0 ? packet_rate : DEFAULT_RATE);
+                bool moving = (int) (t / motion_period) % 2 == 1;
+                double delay = 0.1 + 0.05 * sin(2 * M_PI * 0.7 * t);
+                for (int k = 0; k < csi_len / 2; k++) {
+                    double amplitude = 20 + 10 * sin(k * 0.2);
+                    double im = amplitude * sin(k * 0.3) + rand() % 3 - 1;
+                    double re = amplitude * cos(k * 0.3) + rand() % 3 - 1;
+                    if (moving) {
+                        im += 8 * sin(k * delay + 2 * M_PI * 3 * t);
+                        re += 8 * cos(k * delay + 2 * M_PI * 3 * t);
+                    }
+                    buf[2 * k] = im;
+                    buf[2 * k + 1] = re;
+                }
+            } else {
+                // slowly rotating channel with a frequency selective dip
+                for (int k = 0; k < csi_len / 2; k++) {
+                    double amplitude = 20 + 10 * sin(k * 0.2 + n * 0.01);
+                    double phase = k * 0.3 + n * 0.05;
+                    buf[2 * k] = amplitude * sin(phase);
+                    buf[2 * k + 1] = amplitude * cos(phase);
+                }
+            }
+            info.rx_ctrl.timestamp = esp_timer_get_time();
+            host_wifi_csi_inject(&info);
+            if (packet_rate > 0) {
+                pacer_sent(&packet_pacer, esp_timer_get_time());
+            }
+        }
+    }
+    producer_done = true;
+    vTaskDelete(NULL);
+}
+
+static void replay_wifi_task(void *pvParameters) {
+    replay_config_t config;
+    config.mode = replay_speed > 0 ? REPLAY_TIMED : REPLAY_FAST;
+    config.speed = replay_speed;
+    replay_run(capture, &config, &replay_stats);
+    producer_done = true;
+    vTaskDelete(NULL);
+}
+
+/**********************
+ *   APPLICATION MAIN
+ **********************/
+int main(int argc, char **argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "r:n:l:m:f:s:u:iqo:p:h")) != -1) {
+        switch (opt) {
+            case 'r':
+                packet_rate = atoi(optarg);
+                break;
+            case 'n':
+                packet_count = atoi(optarg);
+                break;
+            case 'l':
+                csi_len = atoi(optarg);
+                break;
+            case 'm':
+                motion_period = atof(optarg);
+                break;
+            case 'f':
+                capture = fopen(optarg, "r");
+                if (capture == NULL) {
+                    perror(optarg);
+                    return 1;
+                }
+                break;
+            case 's':
+                replay_speed = atof(optarg);
+                break;
+            case 'u':
+                stream_target = optarg;
+                break;
+            case 'i':
+                console = true;
+                break;
+            case 'q':
+                quiet = true;
+                break;
+            case 'o':
+                output_file = fopen(optarg, "w");
+                if (output_file == NULL) {
+                    perror(optarg);
+                    return 1;
+                }
+                break;
+            case 'p':
+                if (strcmp(optarg, "block") == 0) {
+                    output_file_policy = OUTPUT_POLICY_BLOCK;
+                } else if (strcmp(optarg, "drop") == 0) {
+                    output_file_policy = OUTPUT_POLICY_DROP;
+                } else {
+                    output_file_policy = OUTPUT_POLICY_SAMPLE;
+                    output_file_sample_n = atoi(optarg);
+                }
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-r rate] [-n packets] [-l csi bytes] [-m seconds] | -f capture.csv [-s speed] [-u ip:port] [-i] [-q] [-o file [-p block|drop|<n>]]\n", argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (csi_len > CSI_MAX_LEN) {
+        csi_len = CSI_MAX_LEN;
+    }
+
+    output_set_enabled(OUTPUT_SERIAL, !quiet);
+    if (output_file != NULL) {
+        output_add_sink("file", OUTPUT_FILE, &output_file_write, output_file, output_file_policy,
+                        output_file_sample_n);
+    }
+    csi_init((char *) "STA");
+    // the host clock is already set, like after a SETTIME on the device
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    clock_map_sync(&csi_clock, esp_timer_get_time(), (int64_t) now.tv_sec * 1000000 + now.tv_usec);
+    real_time_set = true;
+    dsp_start();
+    if (stream_target != NULL) {
+        char *port = strchr(stream_target, ':');
+        if (port == NULL) {
+            fprintf(stderr, "-u expects ip:port\n");
+            return 2;
+        }
+        *port++ = '\0';
+        if (!stream_start(stream_target, atoi(port))) {
+            return 1;
+        }
+    }
+
+    if (console) {
+        input_start();
+    }
+    diag_start();
+
+    int64_t start = esp_timer_get_time();
+    if (capture != NULL) {
+        xTaskCreate(&replay_wifi_task, "replay", 4096, NULL, 5, NULL);
+    } else {
+        xTaskCreate(&synthetic_wifi_task, "synthetic_wifi", 4096, NULL, 5, NULL);
+    }
+
+    uint32_t plots = 0, plotted_frames = 0;
+    while (!producer_done || csi_ring_count(&csi_ring) > 0) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+        const dsp_plot_t *plot = dsp_latest();
+        if (plot != NULL) {
+            plots++;
+            plotted_frames += plot->frames;
+        }
+    }
+    // a console session ends with stdin, the last command still needs a moment to run
+    while (console && !host_uart_drained()) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    // let the dsp task finish the frame it is working on and the last datagram go out
+    vTaskDelay(pdMS_TO_TICKS(stream_target != NULL ? STREAM_FLUSH_MS + 150 : 20));
+    if (!output_drain(5000)) {
+        ESP_LOGW(TAG, "output sinks did not drain");
+    }
+    fflush(stdout);
+    if (output_file != NULL) {
+        fclose(output_file);
+    }
+    uint32_t consumed = stats_count(STATS_STAGE_QUEUE);
+
+    if (capture != NULL) {
+        replay_print_report(&replay_stats);
+        fclose(capture);
+        return 0;
+    }
+
+    double elapsed = (esp_timer_get_time() - start) / 1000000.0;
+    ESP_LOGI(TAG, "%u packets pushed, %u consumed, %u overflows, %u truncated in %.3f s (%.0f frames/s)",
+             csi_ring.pushed.load(), consumed, csi_ring.overflows.load(), csi_ring.truncated.load(),
+             elapsed, consumed / elapsed);
+    ESP_LOGI(TAG, "%u display windows picked up covering %u frames", plots, plotted_frames);
+    csi_print_stats();
+    if (packet_rate > 0) {
+        pacer_print_stats(&packet_pacer);
+    }
+    return 0;
+}
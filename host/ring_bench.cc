@@ -0,0 +1,99 @@
+/**
+ * @file ring_bench.cc
+ * Throughput of the CSI frame ring with the producer and the consumer on two
+ * threads, like the Wi-Fi task and the dsp task on the device: frames pushed
+ * and popped per second and the share lost to overflows, for both overflow
+ * policies and the three csi buffer sizes. The lossless run retries a push
+ * on a full ring, so its pops per second are the rate the ring sustains and
+ * its overflows are the retried pushes.
+ *
+ * usage: csi_ring_bench [-n frames per run]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <thread>
+
+#include "esp_timer.h"
+#include "csi_tool/src/ring_component.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define DEFAULT_FRAMES 2000000
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static csi_ring_t ring;
+static int8_t payload[CSI_MAX_LEN];
+
+/**********************
+ *      RUN
+ **********************/
+static void run(csi_ring_policy_t policy, bool lossless, uint16_t len, uint32_t frames) {
+    csi_ring_init(&ring, policy);
+    std::atomic<bool> done(false);
+    uint32_t popped = 0;
+
+    int64_t start = esp_timer_get_time();
+    std::thread consumer([&] {
+        static csi_frame_t frame;
+        while (true) {
+            bool finished = done.load(std::memory_order_acquire);
+            if (csi_ring_pop(&ring, &frame)) {
+                popped++;
+            } else if (finished) {
+                break;
+            }
+        }
+    });
+
+    wifi_csi_info_t info;
+    memset(&info, 0, sizeof(info));
+    info.buf = payload;
+    info.len = len;
+    for (uint32_t i = 0; i < frames; i++) {
+        info.rx_ctrl.timestamp = i;
+        while (!csi_ring_push(&ring, &info, i) && lossless) {
+            std::this_thread::yield();
+        }
+    }
+    int64_t pushed_us = esp_timer_get_time() - start;
+    done.store(true, std::memory_order_release);
+    consumer.join();
+    int64_t elapsed_us = esp_timer_get_time() - start;
+
+    const char *name = lossless ? "lossless" : policy == CSI_RING_DROP_OLDEST ? "drop_oldest" : "drop_newest";
+    printf("%-12s %5u %12.0f %12.0f %8.2f%%\n", name,
+           len, frames * 1e6 / pushed_us, popped * 1e6 / elapsed_us, 100.0 * ring.overflows.load() / frames);
+}
+
+/**********************
+ *   APPLICATION MAIN
+ **********************/
+int main(int argc, char **argv) {
+    uint32_t frames = DEFAULT_FRAMES;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:h")) != -1) {
+        switch (opt) {
+            case 'n':
+                frames = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n frames]\n", argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    printf("%-12s %5s %12s %12s %9s\n", "policy", "len", "pushes/s", "pops/s", "overflow");
+    const uint16_t lens[] = {128, 384, CSI_MAX_LEN};
+    for (uint16_t len : lens) {
+        run(CSI_RING_DROP_OLDEST, false, len, frames);
+        run(CSI_RING_DROP_NEWEST, false, len, frames);
+        run(CSI_RING_DROP_NEWEST, true, len, frames);
+    }
+    return 0;
+}
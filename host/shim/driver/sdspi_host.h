@@ -0,0 +1,6 @@
+#ifndef HOST_DRIVER_SDSPI_HOST_H
+#define HOST_DRIVER_SDSPI_HOST_H
+
+// only used by code that is disabled in the host build
+
+#endif //HOST_DRIVER_SDSPI_HOST_H
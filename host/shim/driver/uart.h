@@ -0,0 +1,117 @@
+/**
+ * @file uart.h
+ * Host stand-in for the UART driver with an event queue. The console
+ * UART is the process's stdin: a reader thread posts UART_DATA events
+ * for every chunk read, like the driver's rx interrupt does.
+ */
+
+#ifndef HOST_DRIVER_UART_H
+#define HOST_DRIVER_UART_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+typedef int uart_port_t;
+
+typedef enum {
+    UART_DATA,
+    UART_BREAK,
+    UART_BUFFER_FULL,
+    UART_FIFO_OVF,
+    UART_FRAME_ERR,
+    UART_PARITY_ERR,
+    UART_DATA_BREAK,
+    UART_PATTERN_DET,
+    UART_EVENT_MAX,
+} uart_event_type_t;
+
+typedef struct {
+    uart_event_type_t type;
+    size_t size;
+    bool timeout_flag;
+} uart_event_t;
+
+struct host_uart {
+    std::mutex lock;
+    std::deque<uint8_t> rx;
+    size_t rx_size;
+    QueueHandle_t events;
+    bool closed;                // stdin reached its end
+};
+
+inline host_uart *_host_uart() {
+    static host_uart uart;
+    return &uart;
+}
+
+inline void _host_uart_reader() {
+    host_uart *uart = _host_uart();
+    uint8_t chunk[128];
+    ssize_t n;
+    while ((n = read(STDIN_FILENO, chunk, sizeof(chunk))) > 0) {
+        uart_event_t event = {UART_DATA, (size_t) n, false};
+        {
+            std::lock_guard<std::mutex> lock(uart->lock);
+            if (uart->rx.size() + n > uart->rx_size) {
+                event.type = UART_BUFFER_FULL;
+            } else {
+                uart->rx.insert(uart->rx.end(), chunk, chunk + n);
+            }
+        }
+        xQueueSend(uart->events, &event, portMAX_DELAY);
+    }
+    std::lock_guard<std::mutex> lock(uart->lock);
+    uart->closed = true;
+}
+
+inline esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size, int queue_size,
+                                     QueueHandle_t *uart_queue, int intr_alloc_flags) {
+    (void) uart_num;
+    (void) tx_buffer_size;
+    (void) intr_alloc_flags;
+    host_uart *uart = _host_uart();
+    uart->rx_size = rx_buffer_size;
+    uart->events = xQueueCreate(queue_size, sizeof(uart_event_t));
+    if (uart_queue != NULL) {
+        *uart_queue = uart->events;
+    }
+    std::thread(_host_uart_reader).detach();
+    return ESP_OK;
+}
+
+inline int uart_read_bytes(uart_port_t uart_num, uint8_t *buf, uint32_t length, TickType_t ticks_to_wait) {
+    (void) uart_num;
+    (void) ticks_to_wait;
+    host_uart *uart = _host_uart();
+    std::lock_guard<std::mutex> lock(uart->lock);
+    uint32_t n = 0;
+    while (n < length && !uart->rx.empty()) {
+        buf[n++] = uart->rx.front();
+        uart->rx.pop_front();
+    }
+    return n;
+}
+
+inline esp_err_t uart_flush_input(uart_port_t uart_num) {
+    (void) uart_num;
+    host_uart *uart = _host_uart();
+    std::lock_guard<std::mutex> lock(uart->lock);
+    uart->rx.clear();
+    return ESP_OK;
+}
+
+// stdin is closed and everything read from it was picked up
+inline bool host_uart_drained() {
+    host_uart *uart = _host_uart();
+    std::lock_guard<std::mutex> lock(uart->lock);
+    return uart->closed && uart->rx.empty() && uxQueueMessagesWaiting(uart->events) == 0;
+}
+
+#endif //HOST_DRIVER_UART_H
@@ -0,0 +1,44 @@
+#ifndef HOST_ESP_HEAP_CAPS_H
+#define HOST_ESP_HEAP_CAPS_H
+
+#include <stdlib.h>
+#include <malloc.h>
+#include <atomic>
+
+// the host has a single heap, capabilities are ignored
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_DMA (1 << 3)
+
+inline std::atomic<size_t> &_host_heap_min_free() {
+    static std::atomic<size_t> min_free(SIZE_MAX);
+    return min_free;
+}
+
+inline void *heap_caps_malloc(size_t size, uint32_t caps) {
+    (void) caps;
+    return malloc(size);
+}
+
+// free chunks glibc holds, the process can always grow its heap beyond them
+inline size_t heap_caps_get_free_size(uint32_t caps) {
+    (void) caps;
+    size_t size = mallinfo2().fordblks;
+    size_t min = _host_heap_min_free().load();
+    while (size < min && !_host_heap_min_free().compare_exchange_weak(min, size)) {
+    }
+    return size;
+}
+
+// only sampled when the free size is asked for, the device tracks it on every allocation
+inline size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    heap_caps_get_free_size(caps);
+    return _host_heap_min_free().load();
+}
+
+// glibc does not tell, all free chunks stand in for the largest one
+inline size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    (void) caps;
+    return mallinfo2().fordblks;
+}
+
+#endif //HOST_ESP_HEAP_CAPS_H
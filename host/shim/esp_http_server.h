@@ -0,0 +1,6 @@
+#ifndef HOST_ESP_HTTP_SERVER_H
+#define HOST_ESP_HTTP_SERVER_H
+
+// only used by code that is disabled in the host build
+
+#endif //HOST_ESP_HTTP_SERVER_H
@@ -0,0 +1,13 @@
+#ifndef HOST_ESP_LOG_H
+#define HOST_ESP_LOG_H
+
+#include <stdio.h>
+
+// log output goes to stderr so it never mixes with CSI data on stdout
+#define ESP_LOGE(tag, format, ...) fprintf(stderr, "E (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fprintf(stderr, "W (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) fprintf(stderr, "I (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) do { } while (0)
+#define ESP_LOGV(tag, format, ...) do { } while (0)
+
+#endif //HOST_ESP_LOG_H
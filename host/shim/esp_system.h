@@ -0,0 +1,9 @@
+#ifndef HOST_ESP_SYSTEM_H
+#define HOST_ESP_SYSTEM_H
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#define IDF_VER "host"
+
+#endif //HOST_ESP_SYSTEM_H
@@ -0,0 +1,116 @@
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <stdint.h>
+#include <time.h>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include "esp_err.h"
+
+inline struct timespec _host_monotonic() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now;
+}
+
+// microseconds since the first call, like esp_timer counts from boot
+inline int64_t esp_timer_get_time() {
+    static const struct timespec boot = _host_monotonic();
+    struct timespec now = _host_monotonic();
+    return (int64_t) (now.tv_sec - boot.tv_sec) * 1000000 + (now.tv_nsec - boot.tv_nsec) / 1000;
+}
+
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef enum {
+    ESP_TIMER_TASK,
+} esp_timer_dispatch_t;
+
+typedef struct {
+    esp_timer_cb_t callback;
+    void *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char *name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+// one-shot timers only, every timer runs its callbacks on its own thread
+struct host_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    std::mutex lock;
+    std::condition_variable cv;
+    int64_t deadline_us;        // -1 while not armed
+    bool quit;
+    std::thread thread;
+};
+
+typedef host_timer *esp_timer_handle_t;
+
+inline void _host_timer_loop(host_timer *timer) {
+    std::unique_lock<std::mutex> lock(timer->lock);
+    while (!timer->quit) {
+        if (timer->deadline_us < 0) {
+            timer->cv.wait(lock);
+            continue;
+        }
+        int64_t wait = timer->deadline_us - esp_timer_get_time();
+        if (wait > 0) {
+            timer->cv.wait_for(lock, std::chrono::microseconds(wait));
+            continue;
+        }
+        timer->deadline_us = -1;
+        lock.unlock();
+        timer->callback(timer->arg);
+        lock.lock();
+    }
+}
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out) {
+    if (args == NULL || args->callback == NULL || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    host_timer *timer = new host_timer();
+    timer->callback = args->callback;
+    timer->arg = args->arg;
+    timer->deadline_us = -1;
+    timer->quit = false;
+    timer->thread = std::thread(_host_timer_loop, timer);
+    *out = timer;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    std::lock_guard<std::mutex> lock(timer->lock);
+    if (timer->deadline_us >= 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->deadline_us = esp_timer_get_time() + (int64_t) timeout_us;
+    timer->cv.notify_one();
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    std::lock_guard<std::mutex> lock(timer->lock);
+    if (timer->deadline_us < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->deadline_us = -1;
+    timer->cv.notify_one();
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    {
+        std::lock_guard<std::mutex> lock(timer->lock);
+        timer->quit = true;
+        timer->cv.notify_one();
+    }
+    timer->thread.join();
+    delete timer;
+    return ESP_OK;
+}
+
+#endif //HOST_ESP_TIMER_H
@@ -0,0 +1,20 @@
+#ifndef HOST_ESP_VFS_DEV_H
+#define HOST_ESP_VFS_DEV_H
+
+typedef enum {
+    ESP_LINE_ENDINGS_CRLF,
+    ESP_LINE_ENDINGS_CR,
+    ESP_LINE_ENDINGS_LF,
+} esp_line_endings_t;
+
+// stdout on the host never translates line endings
+inline void esp_vfs_dev_uart_set_tx_line_endings(esp_line_endings_t mode) {
+    (void) mode;
+}
+
+// stdout is a plain file descriptor on the host
+inline void esp_vfs_dev_uart_use_driver(int uart_num) {
+    (void) uart_num;
+}
+
+#endif //HOST_ESP_VFS_DEV_H
@@ -0,0 +1,6 @@
+#ifndef HOST_ESP_VFS_FAT_H
+#define HOST_ESP_VFS_FAT_H
+
+// only used by code that is disabled in the host build
+
+#endif //HOST_ESP_VFS_FAT_H
@@ -0,0 +1,77 @@
+/**
+ * @file esp_wifi.h
+ * Host stand-in for the CSI related Wi-Fi driver calls.
+ * The registered CSI callback is kept so host programs can feed it frames
+ * through host_wifi_csi_inject, the way the driver would.
+ */
+
+#ifndef HOST_ESP_WIFI_H
+#define HOST_ESP_WIFI_H
+
+#include <string.h>
+#include "esp_err.h"
+#include "esp_wifi_types.h"
+
+typedef struct {
+    wifi_csi_cb_t cb;
+    void *ctx;
+    bool enabled;
+    wifi_csi_config_t config;
+    uint8_t mac[6];
+    uint8_t last_tx[1500];
+    int last_tx_len;
+    uint32_t tx_count;
+} host_wifi_t;
+
+inline host_wifi_t *_host_wifi() {
+    static host_wifi_t wifi = {NULL, NULL, false, {}, {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x01}, {}, 0, 0};
+    return &wifi;
+}
+
+inline esp_err_t esp_wifi_set_csi(bool en) {
+    _host_wifi()->enabled = en;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_wifi_set_csi_config(const wifi_csi_config_t *config) {
+    _host_wifi()->config = *config;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_wifi_set_csi_rx_cb(wifi_csi_cb_t cb, void *ctx) {
+    _host_wifi()->cb = cb;
+    _host_wifi()->ctx = ctx;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_wifi_get_mac(wifi_interface_t ifx, uint8_t mac[6]) {
+    (void) ifx;
+    memcpy(mac, _host_wifi()->mac, 6);
+    return ESP_OK;
+}
+
+// raw frames are counted and the last one kept, so host programs can look at what was sent
+inline esp_err_t esp_wifi_80211_tx(wifi_interface_t ifx, const void *buffer, int len, bool en_sys_seq) {
+    (void) ifx;
+    (void) en_sys_seq;
+    host_wifi_t *wifi = _host_wifi();
+    if (len <= 0 || len > (int) sizeof(wifi->last_tx)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(wifi->last_tx, buffer, len);
+    wifi->last_tx_len = len;
+    wifi->tx_count++;
+    return ESP_OK;
+}
+
+// deliver a frame to the registered CSI callback, returns false if CSI is off
+inline bool host_wifi_csi_inject(wifi_csi_info_t *info) {
+    host_wifi_t *wifi = _host_wifi();
+    if (!wifi->enabled || wifi->cb == NULL) {
+        return false;
+    }
+    wifi->cb(wifi->ctx, info);
+    return true;
+}
+
+#endif //HOST_ESP_WIFI_H
@@ -0,0 +1,68 @@
+/**
+ * @file esp_wifi_types.h
+ * Host copy of the Wi-Fi types from ESP-IDF v4.3 used by the csi_tool component.
+ * The bit field layout of wifi_pkt_rx_ctrl_t matches the ESP32 driver.
+ */
+
+#ifndef HOST_ESP_WIFI_TYPES_H
+#define HOST_ESP_WIFI_TYPES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    WIFI_IF_STA = 0,
+    WIFI_IF_AP,
+} wifi_interface_t;
+
+typedef struct {
+    signed rssi:8;              // received signal strength indicator, dBm
+    unsigned rate:5;            // PHY rate encoding of the packet, only valid for non HT packets
+    unsigned :1;
+    unsigned sig_mode:2;        // 0: non HT (11bg), 1: HT (11n), 3: VHT (11ac)
+    unsigned :16;
+    unsigned mcs:7;             // modulation coding scheme, only valid for HT packets
+    unsigned cwb:1;             // channel bandwidth, 0: 20MHz, 1: 40MHz
+    unsigned :16;
+    unsigned smoothing:1;
+    unsigned not_sounding:1;
+    unsigned :1;
+    unsigned aggregation:1;     // 0: MPDU, 1: AMPDU
+    unsigned stbc:2;            // space time block code, 0: non STBC, 1: STBC
+    unsigned fec_coding:1;      // LDPC, only valid for HT packets
+    unsigned sgi:1;             // short guard interval
+    signed noise_floor:8;       // dBm
+    unsigned ampdu_cnt:8;
+    unsigned channel:4;         // primary channel
+    unsigned secondary_channel:4;   // 0: none, 1: above, 2: below
+    unsigned :8;
+    unsigned timestamp:32;      // local time when the packet was received, microseconds
+    unsigned :32;
+    unsigned :31;
+    unsigned ant:1;             // antenna number, 0 or 1
+    unsigned sig_len:12;        // length of the packet including FCS
+    unsigned :12;
+    unsigned rx_state:8;        // 0 if no error
+} wifi_pkt_rx_ctrl_t;
+
+typedef struct {
+    bool lltf_en;
+    bool htltf_en;
+    bool stbc_htltf2_en;
+    bool ltf_merge_en;
+    bool channel_filter_en;
+    bool manu_scale;
+    uint8_t shift;
+} wifi_csi_config_t;
+
+typedef struct {
+    wifi_pkt_rx_ctrl_t rx_ctrl;
+    uint8_t mac[6];
+    bool first_word_invalid;
+    int8_t *buf;
+    uint16_t len;
+} wifi_csi_info_t;
+
+typedef void (*wifi_csi_cb_t)(void *ctx, wifi_csi_info_t *data);
+
+#endif //HOST_ESP_WIFI_TYPES_H
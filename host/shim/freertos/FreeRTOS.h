@@ -0,0 +1,64 @@
+/**
+ * @file FreeRTOS.h
+ * Thin POSIX stand-in for the parts of FreeRTOS used by the csi_tool component.
+ * One tick is one millisecond, like CONFIG_FREERTOS_HZ=1000 on the device.
+ */
+
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+#define errQUEUE_FULL 0
+
+#define portMAX_DELAY ((TickType_t) 0xffffffffUL)
+#define portTICK_PERIOD_MS ((TickType_t) 1000 / CONFIG_FREERTOS_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t) (((TickType_t) (ms) * (TickType_t) CONFIG_FREERTOS_HZ) / (TickType_t) 1000))
+#define configMAX_PRIORITIES 25
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define BIT0 0x00000001
+#define BIT1 0x00000002
+#define BIT2 0x00000004
+#define BIT3 0x00000008
+
+// critical sections only need to exclude the other host threads
+typedef struct {
+    std::recursive_mutex lock;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(mux) (mux)->lock.lock()
+#define portEXIT_CRITICAL(mux) (mux)->lock.unlock()
+#define portENTER_CRITICAL_ISR(mux) portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux) portEXIT_CRITICAL(mux)
+
+/*
+ * Block on cv until pred holds or the timeout in ticks expires.
+ * Returns the final value of pred.
+ */
+template<typename Pred>
+bool _host_wait(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, TickType_t ticks, Pred pred) {
+    if (ticks == portMAX_DELAY) {
+        cv.wait(lock, pred);
+        return true;
+    }
+    return cv.wait_for(lock, std::chrono::milliseconds(ticks * portTICK_PERIOD_MS), pred);
+}
+
+#endif //HOST_FREERTOS_H
@@ -0,0 +1,54 @@
+#ifndef HOST_FREERTOS_EVENT_GROUPS_H
+#define HOST_FREERTOS_EVENT_GROUPS_H
+
+#include "FreeRTOS.h"
+
+typedef uint32_t EventBits_t;
+
+struct host_event_group {
+    std::mutex lock;
+    std::condition_variable cv;
+    EventBits_t bits;
+};
+
+typedef host_event_group *EventGroupHandle_t;
+
+inline EventGroupHandle_t xEventGroupCreate() {
+    host_event_group *group = new host_event_group();
+    group->bits = 0;
+    return group;
+}
+
+inline EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    std::lock_guard<std::mutex> lock(group->lock);
+    return group->bits;
+}
+
+inline EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->lock);
+    group->bits |= bits;
+    group->cv.notify_all();
+    return group->bits;
+}
+
+inline EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->lock);
+    EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    return before;
+}
+
+inline EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+                                       BaseType_t wait_for_all, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(group->lock);
+    bool satisfied = _host_wait(group->cv, lock, ticks, [group, bits, wait_for_all] {
+        return wait_for_all ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+    });
+    EventBits_t value = group->bits;
+    if (satisfied && clear_on_exit) {
+        group->bits &= ~bits;
+    }
+    return value;
+}
+
+#endif //HOST_FREERTOS_EVENT_GROUPS_H
@@ -0,0 +1,90 @@
+#ifndef HOST_FREERTOS_QUEUE_H
+#define HOST_FREERTOS_QUEUE_H
+
+#include <stdlib.h>
+#include <string.h>
+#include "FreeRTOS.h"
+
+// bounded queue of fixed-size items copied by value, like the real one
+struct host_queue {
+    std::mutex lock;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    uint8_t *items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+typedef host_queue *QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    host_queue *queue = new host_queue();
+    queue->items = (uint8_t *) malloc(length * item_size);
+    queue->length = length;
+    queue->item_size = item_size;
+    queue->head = 0;
+    queue->count = 0;
+    return queue;
+}
+
+inline void vQueueDelete(QueueHandle_t queue) {
+    free(queue->items);
+    delete queue;
+}
+
+inline BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(queue->lock);
+    if (!_host_wait(queue->not_full, lock, ticks, [queue] { return queue->count < queue->length; })) {
+        return errQUEUE_FULL;
+    }
+    UBaseType_t tail = (queue->head + queue->count) % queue->length;
+    memcpy(queue->items + tail * queue->item_size, item, queue->item_size);
+    queue->count++;
+    queue->not_empty.notify_one();
+    return pdPASS;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    return xQueueSendToBack(queue, item, ticks);
+}
+
+inline BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *higher_priority_task_woken) {
+    if (higher_priority_task_woken != NULL) {
+        *higher_priority_task_woken = pdFALSE;
+    }
+    return xQueueSendToBack(queue, item, 0);
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(queue->lock);
+    if (!_host_wait(queue->not_empty, lock, ticks, [queue] { return queue->count > 0; })) {
+        return pdFALSE;
+    }
+    memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    queue->not_full.notify_one();
+    return pdTRUE;
+}
+
+inline BaseType_t xQueueReset(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->lock);
+    queue->head = 0;
+    queue->count = 0;
+    queue->not_full.notify_all();
+    return pdPASS;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->lock);
+    return queue->count;
+}
+
+inline UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->lock);
+    return queue->length - queue->count;
+}
+
+#endif //HOST_FREERTOS_QUEUE_H
@@ -0,0 +1,61 @@
+#ifndef HOST_FREERTOS_SEMPHR_H
+#define HOST_FREERTOS_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+// mutexes, binary and counting semaphores are all a guarded counter
+struct host_semaphore {
+    std::mutex lock;
+    std::condition_variable cv;
+    UBaseType_t count;
+    UBaseType_t max;
+};
+
+typedef host_semaphore *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial) {
+    host_semaphore *sem = new host_semaphore();
+    sem->count = initial;
+    sem->max = max;
+    return sem;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+inline void vSemaphoreDelete(SemaphoreHandle_t sem) {
+    delete sem;
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(sem->lock);
+    if (!_host_wait(sem->cv, lock, ticks, [sem] { return sem->count > 0; })) {
+        return pdFALSE;
+    }
+    sem->count--;
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    std::lock_guard<std::mutex> lock(sem->lock);
+    if (sem->count >= sem->max) {
+        return pdFALSE;
+    }
+    sem->count++;
+    sem->cv.notify_one();
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *higher_priority_task_woken) {
+    if (higher_priority_task_woken != NULL) {
+        *higher_priority_task_woken = pdFALSE;
+    }
+    return xSemaphoreGive(sem);
+}
+
+#endif //HOST_FREERTOS_SEMPHR_H
@@ -0,0 +1,131 @@
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include "FreeRTOS.h"
+
+// every task is a detached pthread, priorities and core affinity are ignored
+struct host_task {
+    pthread_t thread;
+    void (*fn)(void *);
+    void *arg;
+    char name[16];
+    std::mutex lock;
+    std::condition_variable cv;
+    uint32_t notify;
+    uint32_t stack_depth;
+};
+
+typedef host_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+inline host_task *&_host_current_task() {
+    static thread_local host_task *task = NULL;
+    return task;
+}
+
+inline void *_host_task_entry(void *param) {
+    host_task *task = (host_task *) param;
+    _host_current_task() = task;
+    task->fn(task->arg);
+    return NULL;
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                                          UBaseType_t priority, TaskHandle_t *handle, BaseType_t core) {
+    (void) priority;
+    (void) core;
+    host_task *task = new host_task();
+    task->fn = fn;
+    task->arg = arg;
+    task->notify = 0;
+    task->stack_depth = stack_depth;
+    strncpy(task->name, name, sizeof(task->name) - 1);
+    if (handle != NULL) {
+        *handle = task;
+    }
+    if (pthread_create(&task->thread, NULL, &_host_task_entry, task) != 0) {
+        return pdFAIL;
+    }
+    pthread_detach(task->thread);
+    return pdPASS;
+}
+
+inline BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                              UBaseType_t priority, TaskHandle_t *handle) {
+    return xTaskCreatePinnedToCore(fn, name, stack_depth, arg, priority, handle, tskNO_AFFINITY);
+}
+
+// threads that were not created through the shim (like main) get a handle on first use
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+    host_task *&task = _host_current_task();
+    if (task == NULL) {
+        task = new host_task();
+        task->thread = pthread_self();
+        task->notify = 0;
+        task->stack_depth = 0;
+        strncpy(task->name, "main", sizeof(task->name) - 1);
+    }
+    return task;
+}
+
+inline void vTaskDelete(TaskHandle_t task) {
+    if (task == NULL || task == _host_current_task()) {
+        pthread_exit(NULL);
+    }
+}
+
+inline TickType_t xTaskGetTickCount() {
+    return esp_timer_get_time() / (1000 * portTICK_PERIOD_MS);
+}
+
+inline void vTaskDelay(TickType_t ticks) {
+    if (ticks == 0) {
+        sched_yield();
+        return;
+    }
+    usleep(ticks * portTICK_PERIOD_MS * 1000);
+}
+
+inline void vTaskStartScheduler() {
+}
+
+inline const char *pcTaskGetTaskName(TaskHandle_t task) {
+    return (task != NULL ? task : xTaskGetCurrentTaskHandle())->name;
+}
+
+// pthreads run on their own large stacks, nothing is measured and the whole stack reads as unused
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return (task != NULL ? task : xTaskGetCurrentTaskHandle())->stack_depth;
+}
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    std::lock_guard<std::mutex> lock(task->lock);
+    task->notify++;
+    task->cv.notify_one();
+    return pdPASS;
+}
+
+inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken) {
+    xTaskNotifyGive(task);
+    if (higher_priority_task_woken != NULL) {
+        *higher_priority_task_woken = pdFALSE;
+    }
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+    host_task *task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(task->lock);
+    _host_wait(task->cv, lock, ticks, [task] { return task->notify > 0; });
+    uint32_t value = task->notify;
+    if (value > 0) {
+        task->notify = clear_on_exit ? 0 : value - 1;
+    }
+    return value;
+}
+
+#define portYIELD_FROM_ISR() sched_yield()
+
+#endif //HOST_FREERTOS_TASK_H
@@ -0,0 +1,14 @@
+#ifndef HOST_HAL_CPU_HAL_H
+#define HOST_HAL_CPU_HAL_H
+
+#include <stdint.h>
+#include <time.h>
+
+// nanoseconds stand in for the cpu cycle counter, wraps like the 32 bit CCOUNT register
+inline uint32_t cpu_hal_get_cycle_count() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t) ((uint64_t) now.tv_sec * 1000000000 + now.tv_nsec);
+}
+
+#endif //HOST_HAL_CPU_HAL_H
@@ -0,0 +1,79 @@
+/**
+ * @file nvs.h
+ * Host stand-in for the NVS key/value API, kept in memory for the life of the process.
+ */
+
+#ifndef HOST_NVS_H
+#define HOST_NVS_H
+
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "esp_err.h"
+#include "nvs_flash.h"
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum {
+    NVS_READONLY,
+    NVS_READWRITE,
+} nvs_open_mode_t;
+
+#define ESP_ERR_NVS_INVALID_LENGTH (ESP_ERR_NVS_BASE + 0x0c)
+
+inline std::map<std::string, std::vector<uint8_t> > &_host_nvs() {
+    static std::map<std::string, std::vector<uint8_t> > store;
+    return store;
+}
+
+inline std::vector<std::string> &_host_nvs_namespaces() {
+    static std::vector<std::string> namespaces;
+    return namespaces;
+}
+
+inline esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle) {
+    (void) mode;
+    std::vector<std::string> &namespaces = _host_nvs_namespaces();
+    for (size_t i = 0; i < namespaces.size(); i++) {
+        if (namespaces[i] == name) {
+            *handle = i;
+            return ESP_OK;
+        }
+    }
+    namespaces.push_back(name);
+    *handle = namespaces.size() - 1;
+    return ESP_OK;
+}
+
+inline esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+    const uint8_t *bytes = (const uint8_t *) value;
+    _host_nvs()[_host_nvs_namespaces()[handle] + "/" + key] = std::vector<uint8_t>(bytes, bytes + length);
+    return ESP_OK;
+}
+
+inline esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length) {
+    std::map<std::string, std::vector<uint8_t> >::iterator it = _host_nvs().find(_host_nvs_namespaces()[handle] + "/" + key);
+    if (it == _host_nvs().end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out_value != NULL) {
+        if (*length < it->second.size()) {
+            return ESP_ERR_NVS_INVALID_LENGTH;
+        }
+        memcpy(out_value, it->second.data(), it->second.size());
+    }
+    *length = it->second.size();
+    return ESP_OK;
+}
+
+inline esp_err_t nvs_commit(nvs_handle_t handle) {
+    (void) handle;
+    return ESP_OK;
+}
+
+inline void nvs_close(nvs_handle_t handle) {
+    (void) handle;
+}
+
+#endif //HOST_NVS_H
@@ -0,0 +1,32 @@
+/**
+ * @file sdkconfig.h
+ * Host stand-in for the generated sdkconfig.h, mirrors the committed sdkconfig.
+ * Options can be overridden from the compiler command line.
+ */
+
+#ifndef HOST_SDKCONFIG_H
+#define HOST_SDKCONFIG_H
+
+#define CONFIG_FREERTOS_HZ 1000
+#define CONFIG_ESP_CONSOLE_UART_NUM 0
+#define CONFIG_ESP_CONSOLE_UART_BAUDRATE 115200
+#define CONFIG_ESPTOOLPY_MONITOR_BAUD 115200
+
+#ifndef CONFIG_WIFI_CHANNEL
+#define CONFIG_WIFI_CHANNEL 6
+#endif
+#ifndef CONFIG_PACKET_RATE
+#define CONFIG_PACKET_RATE 100
+#endif
+#ifndef CONFIG_CSI_RING_LEN
+#define CONFIG_CSI_RING_LEN 16
+#endif
+
+#define CONFIG_SHOULD_COLLECT_CSI 1
+#define CONFIG_SEND_CSI_TO_SERIAL 1
+
+#if !defined CONFIG_CSI_RING_DROP_NEWEST && !defined CONFIG_CSI_RING_DROP_OLDEST
+#define CONFIG_CSI_RING_DROP_OLDEST 1
+#endif
+
+#endif //HOST_SDKCONFIG_H
@@ -0,0 +1,6 @@
+#ifndef HOST_SDMMC_CMD_H
+#define HOST_SDMMC_CMD_H
+
+// only used by code that is disabled in the host build
+
+#endif //HOST_SDMMC_CMD_H
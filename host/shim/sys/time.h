@@ -0,0 +1,35 @@
+/**
+ * @file time.h
+ * The system header, except that settimeofday only moves a clock private
+ * to the process: a SETTIME on the host must not set the machine's clock.
+ */
+
+#ifndef HOST_SYS_TIME_H
+#define HOST_SYS_TIME_H
+
+#include_next <sys/time.h>
+
+inline int64_t &_host_time_offset_us() {
+    static int64_t offset = 0;
+    return offset;
+}
+
+inline int _host_gettimeofday(struct timeval *tv, void *tz) {
+    int res = gettimeofday(tv, NULL);
+    int64_t us = (int64_t) tv->tv_sec * 1000000 + tv->tv_usec + _host_time_offset_us();
+    tv->tv_sec = us / 1000000;
+    tv->tv_usec = us % 1000000;
+    return res;
+}
+
+inline int _host_settimeofday(const struct timeval *tv, const void *tz) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    _host_time_offset_us() = ((int64_t) tv->tv_sec - now.tv_sec) * 1000000 + (tv->tv_usec - now.tv_usec);
+    return 0;
+}
+
+#define gettimeofday(tv, tz) _host_gettimeofday(tv, tz)
+#define settimeofday(tv, tz) _host_settimeofday(tv, tz)
+
+#endif //HOST_SYS_TIME_H
@@ -0,0 +1,264 @@
+/**
+ * @file fuzz_command.cc
+ * Fuzz harness of the serial console. Every input is fed to the line
+ * assembler twice: in random chunks to a table of recording commands,
+ * whose calls must match a plain reference model of the line rules, and
+ * to the device's own command table, after which the settings the
+ * commands change must still be in range.
+ *
+ * Without libFuzzer it runs as a unit test on inputs generated from the
+ * command grammar: fuzz_command [-n inputs] [-s seed]. Configured with
+ * -DCSI_HOST_FUZZ=ON and clang, LLVMFuzzerTestOneInput is the entry point.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string>
+#include <vector>
+
+#include "csi_tool/csi_tool.h"
+#include "test.h"
+
+/**********************
+ *  RECORDING COMMANDS
+ **********************/
+static const char *FUZZ_NAMES[] = {"A", "SET", "SETTIME", "mac", "ABCDEFGHIJKLMNO"};
+#define FUZZ_NAME_COUNT (sizeof(FUZZ_NAMES) / sizeof(FUZZ_NAMES[0]))
+
+typedef struct {
+    int command;
+    std::string args;
+} fuzz_call_t;
+
+static command_table_t fuzz_commands;
+static std::vector<fuzz_call_t> fuzz_calls;
+static uint32_t fuzz_bad_args = 0;
+
+template<int I>
+static void fuzz_record(char *args) {
+    size_t len = strlen(args);
+    // handlers get one trimmed line
+    if (len >= COMMAND_LINE_LEN || strpbrk(args, "\r\n") != NULL ||
+        (len > 0 && (strchr(" \t", args[0]) != NULL || strchr(" \t", args[len - 1]) != NULL))) {
+        fuzz_bad_args++;
+    }
+    fuzz_calls.push_back({I, std::string(args)});
+}
+
+static const command_handler_t FUZZ_HANDLERS[] = {&fuzz_record<0>, &fuzz_record<1>, &fuzz_record<2>,
+                                                  &fuzz_record<3>, &fuzz_record<4>};
+
+/*
+ * The line rules written out plainly: lines end at \n or \r, lines with a
+ * NUL or more than COMMAND_LINE_LEN - 1 characters are dropped, the first
+ * word up to a blank or ':' names the command, the rest trimmed are its args.
+ */
+static std::vector<fuzz_call_t> fuzz_model(const uint8_t *data, size_t size) {
+    std::vector<fuzz_call_t> calls;
+    std::string line;
+    bool broken = false;
+    for (size_t i = 0; i < size; i++) {
+        char ch = data[i];
+        if (ch != '\n' && ch != '\r') {
+            broken |= ch == '\0';
+            line += ch;
+            continue;
+        }
+        if (!broken && line.size() < COMMAND_LINE_LEN) {
+            size_t start = line.find_first_not_of(" \t");
+            if (start != std::string::npos) {
+                size_t end = line.find_first_of(" \t:", start);
+                std::string name = line.substr(start, end == std::string::npos ? std::string::npos : end - start);
+                std::string args = end == std::string::npos ? "" : line.substr(end + (line[end] == ':'));
+                size_t first = args.find_first_not_of(" \t");
+                args = first == std::string::npos ? "" : args.substr(first, args.find_last_not_of(" \t") - first + 1);
+                for (size_t c = 0; c < FUZZ_NAME_COUNT && name.size() < COMMAND_NAME_LEN; c++) {
+                    if (strcasecmp(name.c_str(), FUZZ_NAMES[c]) == 0) {
+                        calls.push_back({(int) c, args});
+                        break;
+                    }
+                }
+            }
+        }
+        line.clear();
+        broken = false;
+    }
+    return calls;
+}
+
+/**********************
+ *   DEVICE COMMANDS
+ **********************/
+static int fuzz_stdout = -1;
+static int fuzz_null = -1;
+
+// the command tables print a lot, keep it out of the test log
+static void fuzz_quiet(bool quiet) {
+    fflush(stdout);
+    dup2(quiet ? fuzz_null : fuzz_stdout, STDOUT_FILENO);
+}
+
+static void fuzz_init() {
+    for (size_t c = 0; c < FUZZ_NAME_COUNT; c++) {
+        command_register(&fuzz_commands, FUZZ_NAMES[c], "", FUZZ_HANDLERS[c]);
+    }
+    output_set_enabled(OUTPUT_SERIAL, false);
+    csi_init((char *) "STA");
+    input_register_commands(&input_commands);
+    fuzz_stdout = dup(STDOUT_FILENO);
+    fuzz_null = open("/dev/null", O_WRONLY);
+}
+
+// settings the commands change, all of them must stay usable whatever was typed
+static bool fuzz_settings_valid() {
+    bool valid = packet_pacer.requested_rate.load() <= PACER_MAX_RATE && dsp_interval_ms.load() > 0 &&
+                 dsp_plot_type.load() < DSP_PLOT_COUNT && mac_filter_list.count <= MAC_FILTER_MAX &&
+                 mac_filter_list.mode <= MAC_FILTER_DENY;
+    for (int i = 0; i < output_sink_count.load(); i++) {
+        valid &= output_sinks[i].policy.load() < OUTPUT_POLICY_COUNT && output_sinks[i].sample_n.load() > 0;
+    }
+    return valid;
+}
+
+static uint32_t fuzz_mismatches = 0;
+static uint32_t fuzz_invalid = 0;
+static uint32_t fuzz_dispatched = 0;
+
+static void fuzz_dump(const char *what, const uint8_t *data, size_t size) {
+    fprintf(stderr, "%s for input of %zu bytes:", what, size);
+    for (size_t i = 0; i < size && i < 512; i++) {
+        fprintf(stderr, " %02x", data[i]);
+    }
+    fprintf(stderr, "\n");
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (fuzz_null < 0) {
+        fuzz_init();
+    }
+
+    // the same bytes in chunks picked from the input itself, as the uart hands them out
+    command_line_t line;
+    memset(&line, 0, sizeof(line));
+    fuzz_calls.clear();
+    fuzz_quiet(true);
+    size_t offset = 0, step = size > 0 ? data[0] % 17 + 1 : 1;
+    while (offset < size) {
+        size_t n = size - offset < step ? size - offset : step;
+        command_feed(&line, &fuzz_commands, (const char *) data + offset, n);
+        offset += n;
+        step = data[offset - 1] % 17 + 1;
+    }
+    // an input ends the line it left open
+    command_feed(&line, &fuzz_commands, "\n", 1);
+    fuzz_quiet(false);
+
+    uint8_t *ended = (uint8_t *) malloc(size + 1);
+    memcpy(ended, data, size);
+    ended[size] = '\n';
+    std::vector<fuzz_call_t> expected = fuzz_model(ended, size + 1);
+    free(ended);
+    bool match = expected.size() == fuzz_calls.size();
+    for (size_t i = 0; match && i < expected.size(); i++) {
+        match = expected[i].command == fuzz_calls[i].command && expected[i].args == fuzz_calls[i].args;
+    }
+    if (!match) {
+        if (fuzz_mismatches++ == 0) {
+            fuzz_dump("parser and model disagree", data, size);
+        }
+    }
+    fuzz_dispatched += fuzz_calls.size();
+
+    memset(&input_line, 0, sizeof(input_line));
+    fuzz_quiet(true);
+    command_feed(&input_line, &input_commands, (const char *) data, size);
+    command_feed(&input_line, &input_commands, "\n", 1);
+    fuzz_quiet(false);
+    if (!fuzz_settings_valid()) {
+        if (fuzz_invalid++ == 0) {
+            fuzz_dump("settings out of range", data, size);
+        }
+    }
+    return 0;
+}
+
+#ifndef CSI_FUZZ_LIBFUZZER
+/**********************
+ *   INPUT GENERATOR
+ **********************/
+static const char *FUZZ_TOKENS[] = {
+    "HELP", "SETTIME", "SETTIME:", "STATS", "SDSTATS", "DIAG", "MAC", "RATE", "PLOT", "INTERVAL", "OUTPUT",
+    "MOTION", "set", "3600000", "3600001", "a", "ABCDEFGHIJKLMNO", "ABCDEFGHIJKLMNOP", "LIST", "ADD", "DEL", "CLEAR", "MODE", "ALLOW",
+    "DENY", "OFF", "ON", "SERIAL", "SD", "FILE", "STREAM", "BLOCK", "DROP", "SAMPLE", "amplitude", "phase",
+    "waterfall", "7C:9E:BD:65:B2:3D", "00:00:00:00:00:00", "FF:FF:FF:FF:FF:FF", "1FF:00:00:00:00:00", "7C:9E:BD",
+    "0", "1", "-1", "100", "100000", "100001", "4294967295", "4294967296", "99999999999999999999", "1700000000.5",
+    "1700000000.123456789", "-5.5", ".", "%s%n%x", " ", " ", " ", "  ", "\t", ":", "\n", "\n", "\r", "\r\n",
+};
+#define FUZZ_TOKEN_COUNT (sizeof(FUZZ_TOKENS) / sizeof(FUZZ_TOKENS[0]))
+
+// an input of tokens of the command grammar, now and then a random byte or a run too long for a line
+static size_t fuzz_generate(uint8_t *out, size_t cap) {
+    size_t len = 0;
+    int tokens = rand() % 24;
+    for (int t = 0; t < tokens; t++) {
+        int kind = rand() % 20;
+        if (kind == 0) {
+            out[len++] = rand() % 256;
+        } else if (kind == 1) {
+            size_t run = COMMAND_LINE_LEN - 8 + rand() % 16;
+            for (size_t i = 0; i < run && len < cap; i++) {
+                out[len++] = 'x';
+            }
+        } else {
+            const char *token = FUZZ_TOKENS[rand() % FUZZ_TOKEN_COUNT];
+            for (size_t i = 0; token[i] != '\0' && len < cap; i++) {
+                out[len++] = token[i];
+            }
+        }
+        if (len + 1 >= cap) {
+            break;
+        }
+        if (rand() % 3 != 0) {
+            out[len++] = ' ';
+        }
+    }
+    return len;
+}
+
+int main(int argc, char **argv) {
+    uint32_t inputs = 20000;
+    unsigned int seed = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:h")) != -1) {
+        switch (opt) {
+            case 'n':
+                inputs = atoi(optarg);
+                break;
+            case 's':
+                seed = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n inputs] [-s seed]\n", argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    srand(seed);
+    static uint8_t input[4 * COMMAND_LINE_LEN];
+    for (uint32_t i = 0; i < inputs; i++) {
+        size_t len = fuzz_generate(input, sizeof(input));
+        LLVMFuzzerTestOneInput(input, len);
+    }
+
+    CHECK_EQ(fuzz_mismatches, 0);
+    CHECK_EQ(fuzz_bad_args, 0);
+    CHECK_EQ(fuzz_invalid, 0);
+    CHECK(fuzz_dispatched > 0);
+    printf("fuzz: %u inputs, %u commands dispatched\n", inputs, fuzz_dispatched);
+    return test_result("fuzz_command");
+}
+#endif
@@ -0,0 +1,50 @@
+/**
+ * @file test.h
+ * Minimal checks for the host unit tests: every failed CHECK is printed with
+ * its location and counted, test_result() turns the count into the exit code
+ * ctest looks at.
+ */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+#include <math.h>
+
+static int test_checks = 0;
+static int test_failures = 0;
+
+#define CHECK(cond) do { \
+        test_checks++; \
+        if (!(cond)) { \
+            test_failures++; \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+        } \
+    } while (0)
+
+#define CHECK_EQ(a, b) do { \
+        test_checks++; \
+        long long _a = (long long) (a), _b = (long long) (b); \
+        if (_a != _b) { \
+            test_failures++; \
+            fprintf(stderr, "%s:%d: CHECK_EQ failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(a, b, tolerance) do { \
+        test_checks++; \
+        double _a = (double) (a), _b = (double) (b); \
+        if (!(fabs(_a - _b) <= (tolerance))) { \
+            test_failures++; \
+            fprintf(stderr, "%s:%d: CHECK_NEAR failed: %s ~ %s (%g != %g +- %g)\n", __FILE__, __LINE__, #a, #b, \
+                    _a, _b, (double) (tolerance)); \
+        } \
+    } while (0)
+
+// print the summary, returns the exit code for main
+static int test_result(const char *name) {
+    printf("%s: %d checks, %d failed\n", name, test_checks, test_failures);
+    return test_failures == 0 ? 0 : 1;
+}
+
+#endif //HOST_TEST_H
@@ -0,0 +1,93 @@
+/**
+ * @file test_aggregate.cc
+ * The display window on frames of known amplitude: mean, variance, minimum
+ * and maximum of every subcarrier over the window, the amplitude plot
+ * carrying the range in ascending subcarrier order, and a frame of another
+ * layout restarting the window with a fresh range.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "csi_tool/csi_tool.h"
+#include "test.h"
+
+#define WINDOW_FRAMES 10
+
+static aggregate_t window;
+static dsp_plot_t plot;
+static int8_t buf[CSI_MAX_LEN];
+
+// amplitude of subcarrier k in frame n, the frames of a window step it by one
+static int amplitude_of(int k, int n) {
+    return 10 + k % 20 + n;
+}
+
+// a frame of 64 subcarriers, each a real vector of amplitude_of
+static csi_segment_t make_frame(uint8_t secondary_channel, int n) {
+    wifi_pkt_rx_ctrl_t rx_ctrl;
+    memset(&rx_ctrl, 0, sizeof(rx_ctrl));
+    rx_ctrl.secondary_channel = secondary_channel;
+    for (int k = 0; k < 64; k++) {
+        buf[k * 2] = 0;
+        buf[k * 2 + 1] = amplitude_of(k, n);
+    }
+    csi_segments_t segments;
+    CHECK(csi_parse_segments(&rx_ctrl, buf, 128, &segments));
+    return segments.segment[CSI_SEGMENT_LLTF];
+}
+
+static void test_window_range() {
+    aggregate_reset(&window);
+    for (int n = 0; n < WINDOW_FRAMES; n++) {
+        csi_segment_t seg = make_frame(0, n);
+        CHECK(aggregate_add(&window, &seg, n));
+    }
+    CHECK_EQ(window.count, WINDOW_FRAMES);
+
+    uint32_t exact = 0;
+    for (int k = 0; k < window.subc; k++) {
+        exact += aggregate_min(&window, k) == amplitude_of(k, 0) &&
+                 aggregate_max(&window, k) == amplitude_of(k, WINDOW_FRAMES - 1);
+        CHECK_NEAR(aggregate_mean(&window, k), amplitude_of(k, 0) + (WINDOW_FRAMES - 1) / 2.0, 1e-3);
+        // population variance of 0..9
+        CHECK_NEAR(aggregate_variance(&window, k), 8.25, 1e-3);
+    }
+    CHECK_EQ(exact, 64);
+
+    // the amplitude plot shows the range around the mean, reordered like the values
+    dsp_compute(&window, DSP_PLOT_AMPLITUDE, &plot);
+    csi_segment_t layout;
+    layout.subc = window.subc;
+    layout.map = window.map;
+    uint32_t ordered = 0;
+    for (int j = 0; j < plot.subc; j++) {
+        int k = csi_segment_order(&layout, j);
+        ordered += plot.low[j] == amplitude_of(k, 0) && plot.high[j] == amplitude_of(k, WINDOW_FRAMES - 1) &&
+                   plot.low[j] <= plot.values[j] && plot.values[j] <= plot.high[j];
+    }
+    CHECK_EQ(ordered, 64);
+}
+
+static void test_restart() {
+    aggregate_reset(&window);
+    for (int n = 0; n < WINDOW_FRAMES; n++) {
+        csi_segment_t seg = make_frame(0, n);
+        aggregate_add(&window, &seg, n);
+    }
+    // other subcarriers can't be merged, the range starts over with the new frame
+    csi_segment_t seg = make_frame(2, 5);
+    CHECK(!aggregate_add(&window, &seg, WINDOW_FRAMES));
+    CHECK_EQ(window.count, 1);
+    uint32_t fresh = 0;
+    for (int k = 0; k < window.subc; k++) {
+        fresh += aggregate_min(&window, k) == amplitude_of(k, 5) && aggregate_max(&window, k) == amplitude_of(k, 5);
+    }
+    CHECK_EQ(fresh, 64);
+}
+
+int main() {
+    test_window_range();
+    test_restart();
+    return test_result("test_aggregate");
+}
@@ -0,0 +1,143 @@
+/**
+ * @file test_clock.cc
+ * The local to wall clock mapping on synthetic clocks: a crystal 37 ppm fast
+ * or slow synced every minute, with and without jitter on the reference,
+ * must be tracked to a few microseconds between syncs, a stepped reference
+ * is followed at once without spoiling the drift, and readers never see a
+ * torn model while two tasks sync back to back.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <atomic>
+
+#include "csi_tool/src/clock_component.h"
+#include "test.h"
+
+#define EPOCH_US 1700000000000000LL
+#define MINUTE_US 60000000LL
+
+static clock_map_t map;
+
+// wall time when the local clock reads local_us, for a crystal off by ppm
+static int64_t true_real_us(int64_t local_us, double ppm) {
+    return EPOCH_US + local_us + (int64_t) (local_us * ppm / 1e6);
+}
+
+/*
+ * Sync once a minute for two hours with the reference off by up to jitter_us,
+ * returns the worst error of the mapping over the last hour, sampled between syncs.
+ */
+static int64_t run(double ppm, int64_t jitter_us) {
+    clock_map_init(&map);
+    srand(37);
+    int64_t worst = 0;
+    for (int64_t local = 0; local <= 120 * MINUTE_US; local += MINUTE_US) {
+        int64_t jitter = jitter_us > 0 ? rand() % (2 * jitter_us + 1) - jitter_us : 0;
+        clock_map_sync(&map, local, true_real_us(local, ppm) + jitter);
+        for (int64_t t = local; local >= 60 * MINUTE_US && t < local + MINUTE_US; t += 1000000) {
+            int64_t error = llabs(clock_map_real_us(&map, t) - true_real_us(t, ppm));
+            worst = error > worst ? error : worst;
+        }
+    }
+    return worst;
+}
+
+static void test_drift() {
+    const double ppms[] = {37, -37, 0};
+    for (double ppm : ppms) {
+        // an exact reference: the drift is learned and the mapping holds to a few microseconds
+        int64_t worst = run(ppm, 0);
+        CHECK(map.drift_known);
+        CHECK_NEAR(clock_map_drift_ppm(&map), ppm, 0.01);
+        CHECK(worst <= 5);
+
+        // a reference with 2 ms of jitter, like SETTIME on the serial port: the error stays within it
+        worst = run(ppm, 2000);
+        CHECK_NEAR(clock_map_drift_ppm(&map), ppm, 5);
+        CHECK(worst <= 2000);
+        printf("%+.0f ppm: drift %.2f ppm, worst error %lld us with 2 ms jitter\n", ppm, clock_map_drift_ppm(&map),
+               (long long) worst);
+    }
+
+    // without a sync a 37 ppm crystal is off by 133 ms after an hour, the mapping is not
+    run(37, 0);
+    int64_t local = 120 * MINUTE_US + 60 * MINUTE_US;
+    CHECK(llabs(clock_map_real_us(&map, local) - true_real_us(local, 37)) <= 5);
+}
+
+static void test_first_sync_and_step() {
+    clock_map_init(&map);
+    // unset, wall time counts from boot
+    CHECK_EQ(clock_map_real_us(&map, 123456), 123456);
+
+    clock_map_sync(&map, 1000000, EPOCH_US);
+    CHECK_EQ(clock_map_real_us(&map, 1000000), EPOCH_US);
+    CHECK_EQ(clock_map_real_us(&map, 3000000), EPOCH_US + 2000000);
+    CHECK(!map.drift_known);
+
+    // a small error is corrected by half per sync
+    clock_map_sync(&map, 2000000, EPOCH_US + 1000000 + 1000);
+    CHECK_EQ(map.last_error_us, 1000);
+    CHECK_EQ(clock_map_real_us(&map, 2000000), EPOCH_US + 1000000 + 500);
+
+    // a drift measured over a minute, then the time is set by hand ten seconds later
+    clock_map_sync(&map, MINUTE_US, true_real_us(MINUTE_US, 37) - 1000000);
+    CHECK(map.drift_known);
+    float drift = clock_map_drift_ppm(&map);
+    clock_map_sync(&map, 2 * MINUTE_US, EPOCH_US + 2 * MINUTE_US + 10000000);
+    CHECK_EQ(clock_map_real_us(&map, 2 * MINUTE_US), EPOCH_US + 2 * MINUTE_US + 10000000);
+    CHECK_NEAR(clock_map_drift_ppm(&map), drift, 0.001);
+    CHECK_EQ(map.syncs, 4);
+}
+
+/*
+ * Two tasks sync back to back while a reader maps. Every sync steps the
+ * clock, so each model it publishes has real_us = 1000001 * local_us and
+ * no drift. A model mixing two syncs breaks that.
+ */
+static void test_concurrent_syncs() {
+    const uint32_t syncs = 100000;
+    clock_map_init(&map);
+    clock_map_sync(&map, 0, 0);
+    std::atomic<bool> done(false);
+    uint32_t reads = 0, torn = 0;
+
+    std::thread reader([&] {
+        while (!done.load()) {
+            clock_model_t model = clock_map_model(&map);
+            torn += model.real_us != model.local_us * 1000001 || model.drift_q32 != 0;
+            if (++reads % 16 == 0) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    auto writer = [&](int64_t first) {
+        for (int64_t i = first; i < first + syncs; i++) {
+            clock_map_sync(&map, i, i * 1000001);
+            if (i % 8 == 0) {
+                std::this_thread::yield();
+            }
+        }
+    };
+    std::thread a(writer, 1);
+    std::thread b(writer, 1 + syncs);
+    a.join();
+    b.join();
+    done = true;
+    reader.join();
+
+    CHECK_EQ(torn, 0);
+    CHECK(reads > 0);
+    CHECK_EQ(map.syncs, 2 * syncs + 1);
+    CHECK_EQ(map.seq.load(), 2 * (2 * syncs + 1));
+    printf("concurrent: %u syncs, %u reads\n", 2 * syncs, reads);
+}
+
+int main() {
+    test_drift();
+    test_first_sync_and_step();
+    test_concurrent_syncs();
+    return test_result("test_clock");
+}
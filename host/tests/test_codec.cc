@@ -0,0 +1,229 @@
+/**
+ * @file test_codec.cc
+ * Round trips of the delta codec through version 2 records: static links,
+ * interleaved links and layouts beyond the tracked contexts, changing
+ * lengths and noise that does not pack all decode to the exact iq bytes.
+ * A decoder that starts mid-capture, misses a record or gets a broken
+ * payload loses only the frames up to the next keyframe.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "csi_tool/src/codec_component.h"
+#include "test.h"
+
+#define KEYFRAME_INTERVAL 50
+
+typedef std::vector<uint8_t> wire_record_t;
+
+static csi_codec_t encoder;
+static csi_codec_t decoder;
+static int8_t iq[CSI_RECORD_MAX_DATA];
+static int8_t unpacked[CSI_RECORD_MAX_DATA];
+
+// frames of link l, HT or not, with len bytes of a fixed pattern plus noise of +-spread
+static csi_record_t make_frame(int l, bool ht, uint16_t len, int spread) {
+    csi_record_t rec;
+    memset(&rec, 0, sizeof(rec));
+    memcpy(rec.role, "STA", 3);
+    uint8_t mac[6] = {0x7C, 0x9E, 0xBD, 0x65, 0xB2, (uint8_t) l};
+    memcpy(rec.mac, mac, 6);
+    rec.sig_mode = ht;
+    rec.secondary_channel = 1;
+    for (int i = 0; i < len; i++) {
+        int v = (i * 13 + l * 29) % 120 - 60 + (spread > 0 ? rand() % (2 * spread + 1) - spread : 0);
+        iq[i] = (int8_t) v;
+    }
+    rec.len = len;
+    rec.data = iq;
+    return rec;
+}
+
+static wire_record_t encode(const csi_record_t *rec) {
+    wire_record_t out(CSI_RECORD_MAX_LEN);
+    size_t len = csi_codec_encode_record(&encoder, rec, out.data(), out.size());
+    CHECK(len > 0);
+    out.resize(len);
+    return out;
+}
+
+// decode one record off the wire, true if it unpacked to expected
+static bool decode(const wire_record_t &wire, const int8_t *expected, uint16_t len) {
+    csi_record_t rec;
+    size_t consumed;
+    if (csi_record_decode(wire.data(), wire.size(), &rec, &consumed) != CSI_RECORD_OK || consumed != wire.size() ||
+        rec.packed_len == 0 || !csi_codec_decode(&decoder, &rec, unpacked)) {
+        return false;
+    }
+    return rec.len == len && rec.packed_len == 0 && rec.data == unpacked && memcmp(unpacked, expected, len) == 0;
+}
+
+static void reset(uint32_t keyframe_interval) {
+    csi_codec_init(&encoder, keyframe_interval);
+    csi_codec_init(&decoder, keyframe_interval);
+}
+
+// one link for longer than the 8 bit frame number runs, keyframes on schedule
+static void test_static_link() {
+    reset(KEYFRAME_INTERVAL);
+    srand(1);
+    uint32_t exact = 0;
+    for (int n = 0; n < 1000; n++) {
+        csi_record_t rec = make_frame(0, true, 256, 2);
+        exact += decode(encode(&rec), rec.data, rec.len);
+    }
+    CHECK_EQ(exact, 1000);
+    CHECK_EQ(encoder.frames.load(), 1000);
+    CHECK_EQ(encoder.keyframes.load(), 1000 / KEYFRAME_INTERVAL);
+    CHECK_EQ(decoder.keyframes.load(), 1000 / KEYFRAME_INTERVAL);
+    CHECK_EQ(decoder.lost.load(), 0);
+    CHECK_EQ(decoder.packed_bytes, encoder.packed_bytes);
+    double ratio = (double) encoder.raw_bytes / encoder.packed_bytes;
+    // frames with +-2 noise differ by up to +-4, 4 bits a value plus the block widths and the header
+    CHECK(ratio > 1.8);
+    printf("static link: %.2f:1\n", ratio);
+}
+
+// more links than contexts, each in two layouts and with lengths of one, two and three segments
+static void test_links_and_layouts() {
+    reset(KEYFRAME_INTERVAL);
+    srand(2);
+    const uint16_t lens[] = {128, 256, 384};
+    uint32_t exact = 0;
+    for (int n = 0; n < 5000; n++) {
+        int l = rand() % 6;
+        bool ht = rand() % 2;
+        // a link mostly keeps its length, now and then a segment is missing or added
+        uint16_t len = ht ? lens[rand() % 8 == 0 ? rand() % 3 : l % 3] : 128;
+        csi_record_t rec = make_frame(l, ht, len, 3);
+        exact += decode(encode(&rec), rec.data, rec.len);
+    }
+    CHECK_EQ(exact, 5000);
+    CHECK_EQ(decoder.lost.load(), 0);
+    CHECK_EQ(decoder.keyframes.load(), encoder.keyframes.load());
+    // contexts are replaced, but most frames still find theirs
+    CHECK(encoder.keyframes.load() < 5000);
+}
+
+// noise comes out larger when packed, it is stored raw and still decodes
+static void test_noise() {
+    reset(KEYFRAME_INTERVAL);
+    srand(3);
+    uint32_t exact = 0;
+    for (int n = 0; n < 200; n++) {
+        csi_record_t rec = make_frame(0, true, 384, 0);
+        for (int i = 0; i < rec.len; i++) {
+            iq[i] = (int8_t) (rand() % 256);
+        }
+        exact += decode(encode(&rec), rec.data, rec.len);
+    }
+    CHECK_EQ(exact, 200);
+    CHECK_EQ(encoder.packed_bytes, encoder.raw_bytes + 200 * CODEC_HEADER_LEN);
+}
+
+// records of one link, and the iq bytes each one carries
+static void capture(uint32_t frames, std::vector<wire_record_t> *wire, std::vector<std::vector<int8_t>> *frames_iq) {
+    reset(KEYFRAME_INTERVAL);
+    srand(4);
+    for (uint32_t n = 0; n < frames; n++) {
+        csi_record_t rec = make_frame(1, true, 256, 2);
+        wire->push_back(encode(&rec));
+        frames_iq->push_back(std::vector<int8_t>(rec.data, rec.data + rec.len));
+    }
+}
+
+// decode records first..end minus the skipped one, returns the frames that came out exact
+static uint32_t replay(const std::vector<wire_record_t> &wire, const std::vector<std::vector<int8_t>> &frames_iq,
+                       uint32_t first, uint32_t skipped, uint32_t *failed_first, uint32_t *failed_last) {
+    csi_codec_init(&decoder, KEYFRAME_INTERVAL);
+    uint32_t exact = 0;
+    *failed_first = UINT32_MAX;
+    *failed_last = 0;
+    for (uint32_t n = first; n < wire.size(); n++) {
+        if (n == skipped) {
+            continue;
+        }
+        if (decode(wire[n], frames_iq[n].data(), frames_iq[n].size())) {
+            exact++;
+        } else {
+            *failed_first = n < *failed_first ? n : *failed_first;
+            *failed_last = n;
+        }
+    }
+    return exact;
+}
+
+static void test_start_anywhere_and_gaps() {
+    std::vector<wire_record_t> wire;
+    std::vector<std::vector<int8_t>> frames_iq;
+    capture(300, &wire, &frames_iq);
+    uint32_t failed_first, failed_last;
+
+    // joined mid-capture, the frames before the next keyframe have no reference
+    CHECK_EQ(replay(wire, frames_iq, 75, UINT32_MAX, &failed_first, &failed_last), 300 - 100);
+    CHECK_EQ(failed_first, 75);
+    CHECK_EQ(failed_last, 99);
+    CHECK_EQ(decoder.lost.load(), 25);
+
+    // a lost delta record breaks the chain until the keyframe
+    CHECK_EQ(replay(wire, frames_iq, 0, 120, &failed_first, &failed_last), 300 - 30);
+    CHECK_EQ(failed_first, 121);
+    CHECK_EQ(failed_last, 149);
+    CHECK_EQ(decoder.lost.load(), 29);
+
+    // a lost keyframe takes its whole interval with it
+    CHECK_EQ(replay(wire, frames_iq, 0, 200, &failed_first, &failed_last), 300 - 50);
+    CHECK_EQ(failed_first, 201);
+    CHECK_EQ(failed_last, 249);
+
+    // and the whole capture from its start
+    CHECK_EQ(replay(wire, frames_iq, 0, UINT32_MAX, &failed_first, &failed_last), 300);
+    CHECK_EQ(failed_first, UINT32_MAX);
+}
+
+static void test_broken_payload() {
+    std::vector<wire_record_t> wire;
+    std::vector<std::vector<int8_t>> frames_iq;
+    capture(100, &wire, &frames_iq);
+    csi_codec_init(&decoder, KEYFRAME_INTERVAL);
+    for (int n = 0; n < 10; n++) {
+        CHECK(decode(wire[n], frames_iq[n].data(), frames_iq[n].size()));
+    }
+
+    csi_record_t rec;
+    size_t consumed;
+    CHECK_EQ(csi_record_decode(wire[10].data(), wire[10].size(), &rec, &consumed), CSI_RECORD_OK);
+    uint8_t payload[CSI_RECORD_MAX_PACKED];
+    memcpy(payload, rec.data, rec.packed_len);
+    rec.data = (const int8_t *) payload;
+
+    // cut short, a block width no int8 difference needs, an unknown mode and a too short header
+    csi_record_t cut = rec;
+    cut.packed_len = rec.packed_len - 1;
+    CHECK(!csi_codec_decode(&decoder, &cut, unpacked));
+    payload[CODEC_HEADER_LEN] = CODEC_MAX_WIDTH + 1;
+    CHECK(!csi_codec_decode(&decoder, &rec, unpacked));
+    payload[0] = (payload[0] & ~3) | 3;
+    CHECK(!csi_codec_decode(&decoder, &rec, unpacked));
+    cut.packed_len = 1;
+    CHECK(!csi_codec_decode(&decoder, &cut, unpacked));
+
+    // the deltas after it don't decode against a half written reference, the keyframe restarts the link
+    uint32_t exact = 0;
+    for (int n = 11; n < 100; n++) {
+        exact += decode(wire[n], frames_iq[n].data(), frames_iq[n].size());
+    }
+    CHECK_EQ(exact, 100 - 50);
+}
+
+int main() {
+    test_static_link();
+    test_links_and_layouts();
+    test_noise();
+    test_start_anywhere_and_gaps();
+    test_broken_payload();
+    return test_result("test_codec");
+}
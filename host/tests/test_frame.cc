@@ -0,0 +1,83 @@
+/**
+ * @file test_frame.cc
+ * The injection frame templates: the null data and action headers with
+ * their addresses in place, the vendor body of the action frame, and the
+ * 12 bit sequence number stamped at offset 22 for every frame, wrapping
+ * from 4095 to 0.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "csi_tool/src/frame_component.h"
+#include "test.h"
+
+static const uint8_t BSSID[6] = {0x7C, 0x9E, 0xBD, 0x65, 0xB2, 0x3D};
+static const uint8_t SRC[6] = {0x24, 0x0A, 0xC4, 0x01, 0x02, 0x03};
+
+static frame_template_t frame;
+
+// receiver and BSSID are the AP, the transmitter is us
+static void check_addresses(const frame_template_t *t) {
+    CHECK_EQ(memcmp(t->buf + 4, BSSID, 6), 0);
+    CHECK_EQ(memcmp(t->buf + 10, SRC, 6), 0);
+    CHECK_EQ(memcmp(t->buf + 16, BSSID, 6), 0);
+    // duration is left to the hardware
+    CHECK_EQ(t->buf[2], 0);
+    CHECK_EQ(t->buf[3], 0);
+}
+
+static void test_null_data() {
+    frame_build(&frame, FRAME_NULL_DATA, BSSID, SRC);
+    CHECK_EQ(frame.buf[0], 0x48);
+    CHECK_EQ(frame.buf[1], 0x01);
+    CHECK_EQ(frame.len, FRAME_HEADER_LEN);
+    CHECK_EQ(frame.seq, 0);
+    check_addresses(&frame);
+}
+
+static void test_action() {
+    frame_build(&frame, FRAME_ACTION, BSSID, SRC);
+    CHECK_EQ(frame.buf[0], 0xD0);
+    CHECK_EQ(frame.buf[1], 0x00);
+    check_addresses(&frame);
+    // category, the Espressif OUI and the type
+    const uint8_t body[] = {FRAME_ACTION_CATEGORY, 0x18, 0xFE, 0x34, FRAME_ACTION_TYPE};
+    CHECK_EQ(frame.len, FRAME_HEADER_LEN + sizeof(body));
+    CHECK_EQ(memcmp(frame.buf + FRAME_HEADER_LEN, body, sizeof(body)), 0);
+    CHECK(frame.len <= FRAME_MAX_LEN);
+}
+
+static void test_sequence() {
+    frame_build(&frame, FRAME_NULL_DATA, BSSID, SRC);
+    uint8_t header[FRAME_HEADER_LEN];
+    memcpy(header, frame.buf, FRAME_HEADER_LEN);
+
+    // every frame carries the number it was sent with, the fragment number stays 0
+    uint32_t stamped = 0;
+    for (uint32_t n = 0; n < 2 * FRAME_SEQ_MOD + 5; n++) {
+        uint16_t seq = frame_next_seq(&frame);
+        stamped += seq == n % FRAME_SEQ_MOD && frame_seq(frame.buf) == seq && (frame.buf[FRAME_SEQ_OFFSET] & 0x0F) == 0;
+    }
+    CHECK_EQ(stamped, 2 * FRAME_SEQ_MOD + 5);
+    // only the sequence control changed
+    CHECK_EQ(memcmp(header, frame.buf, FRAME_SEQ_OFFSET), 0);
+
+    // the last number before the wrap, then 0
+    frame.seq = FRAME_SEQ_MOD - 1;
+    CHECK_EQ(frame_next_seq(&frame), 4095);
+    CHECK_EQ(frame.buf[FRAME_SEQ_OFFSET], 0xF0);
+    CHECK_EQ(frame.buf[FRAME_SEQ_OFFSET + 1], 0xFF);
+    CHECK_EQ(frame_seq(frame.buf), 4095);
+    CHECK_EQ(frame.seq, 0);
+    CHECK_EQ(frame_next_seq(&frame), 0);
+    CHECK_EQ(frame_seq(frame.buf), 0);
+    CHECK_EQ(frame.buf[FRAME_SEQ_OFFSET + 1], 0);
+}
+
+int main() {
+    test_null_data();
+    test_action();
+    test_sequence();
+    return test_result("test_frame");
+}
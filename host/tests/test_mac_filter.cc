@@ -0,0 +1,103 @@
+/**
+ * @file test_mac_filter.cc
+ * The transmitter filter: the three modes, persistence of edits, and a
+ * callback thread counting hits while another thread keeps editing the list,
+ * checking that the table handoff loses none of them.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <atomic>
+
+#include "csi_tool/src/mac_filter_component.h"
+#include "test.h"
+
+static const uint8_t MAC_A[6] = {0x7C, 0x9E, 0xBD, 0x65, 0xB2, 0x3D};
+static const uint8_t MAC_B[6] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x01};
+static const uint8_t MAC_C[6] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x02};
+
+static void test_modes() {
+    mac_filter_init(MAC_FILTER_ALLOW, "7C:9E:BD:65:B2:3D");
+    CHECK_EQ(mac_filter_list.count, 1);
+    CHECK(mac_filter_accept(MAC_A));
+    CHECK(!mac_filter_accept(MAC_B));
+    CHECK_EQ(mac_filter_hits(MAC_A), 1);
+
+    CHECK(mac_filter_add(MAC_B));
+    CHECK(mac_filter_add(MAC_B));
+    CHECK_EQ(mac_filter_list.count, 2);
+    CHECK(mac_filter_accept(MAC_B));
+    CHECK_EQ(mac_filter_hits(MAC_A), 1);
+    CHECK_EQ(mac_filter_hits(MAC_B), 1);
+
+    mac_filter_set_mode(MAC_FILTER_DENY);
+    CHECK(!mac_filter_accept(MAC_A));
+    CHECK(mac_filter_accept(MAC_C));
+    CHECK_EQ(mac_filter_hits(MAC_A), 2);
+    CHECK_EQ(mac_filter_hits(MAC_C), 0);
+
+    mac_filter_set_mode(MAC_FILTER_OFF);
+    CHECK(mac_filter_accept(MAC_A));
+    CHECK(mac_filter_accept(MAC_C));
+    CHECK_EQ(mac_filter_hits(MAC_A), 2);
+
+    // a removed transmitter loses its count, the others keep theirs
+    CHECK(mac_filter_remove(MAC_A));
+    CHECK(!mac_filter_remove(MAC_A));
+    CHECK_EQ(mac_filter_hits(MAC_A), 0);
+    CHECK_EQ(mac_filter_hits(MAC_B), 1);
+
+    // the edits were saved, a restart loads them instead of the default
+    memset(&mac_filter_list, 0, sizeof(mac_filter_list));
+    mac_filter_init(MAC_FILTER_ALLOW, "7C:9E:BD:65:B2:3D");
+    CHECK_EQ(mac_filter_list.mode, MAC_FILTER_OFF);
+    CHECK_EQ(mac_filter_list.count, 1);
+    CHECK(memcmp(mac_filter_list.macs[0], MAC_B, 6) == 0);
+
+    mac_filter_clear();
+    CHECK_EQ(mac_filter_list.count, 0);
+}
+
+// every accepted packet of a listed transmitter is counted exactly once across edits
+static void test_handoff() {
+    const uint32_t packets = 200000;
+    mac_filter_clear();
+    mac_filter_set_mode(MAC_FILTER_ALLOW);
+    mac_filter_add(MAC_A);
+    std::atomic<bool> done(false);
+    uint32_t accepted = 0;
+
+    std::thread callback([&] {
+        for (uint32_t i = 0; i < packets; i++) {
+            accepted += mac_filter_accept(MAC_A);
+            mac_filter_accept(MAC_C);
+            // give a single cpu a chance to run the editor in between
+            if (i % 16 == 0) {
+                std::this_thread::yield();
+            }
+        }
+        done = true;
+    });
+
+    uint32_t edits = 0;
+    while (!done.load()) {
+        mac_filter_add(MAC_B);
+        mac_filter_remove(MAC_B);
+        edits += 2;
+        std::this_thread::yield();
+    }
+    callback.join();
+
+    CHECK_EQ(accepted, packets);
+    CHECK_EQ(mac_filter_hits(MAC_A), packets);
+    CHECK_EQ(mac_filter_hits(MAC_C), 0);
+    CHECK(mac_filter_probing.load() == NULL);
+    printf("handoff: %u packets, %u edits\n", packets, edits);
+}
+
+int main() {
+    test_modes();
+    test_handoff();
+    return test_result("test_mac_filter");
+}
@@ -0,0 +1,67 @@
+/**
+ * @file test_math.cc
+ * Accuracy of the integer amplitude and phase kernels against the double
+ * formulas they replaced, over all 65536 int8 IQ pairs.
+ */
+
+#include <stdio.h>
+#include <math.h>
+
+#include "csi_tool/src/math_component.h"
+#include "test.h"
+
+int main() {
+    int amplitude_mismatches = 0, fast_out_of_bound = 0, phase_out_of_bound = 0, coord_out_of_bound = 0;
+    double max_phase_error = 0, max_fast_error = 0;
+    int max_coord_error = 0;
+
+    for (int i = -128; i <= 127; i++) {
+        for (int q = -128; q <= 127; q++) {
+            // the old plot code: sqrt(pow(a, 2) + pow(b, 2)) stored in an integer
+            double exact = sqrt(pow(i, 2) + pow(q, 2));
+            if (csi_amplitude(i, q) != (uint16_t) exact) {
+                amplitude_mismatches++;
+            }
+
+            double fast_error = fabs(csi_amplitude_fast(i, q) - exact);
+            if (fast_error > 0.04 * exact + 1) {
+                fast_out_of_bound++;
+            }
+            max_fast_error = fmax(max_fast_error, fast_error - 0.04 * exact);
+
+            // atan2(0, 0) is 0 for both, +-pi agree modulo 2 pi
+            double phase = atan2(i, q);
+            double error = fabs(csi_phase(i, q) * M_PI / CSI_PHASE_PI - phase);
+            error = fmin(error, 2 * M_PI - error);
+            if (error >= 0.001) {
+                phase_out_of_bound++;
+            }
+            max_phase_error = fmax(max_phase_error, error);
+
+            int coord = (int) (200 * (phase + 3.2) / 6);
+            int coord_error = abs(csi_phase_coord(i, q) - coord);
+            if (coord_error > 1) {
+                coord_out_of_bound++;
+            }
+            max_coord_error = coord_error > max_coord_error ? coord_error : max_coord_error;
+        }
+    }
+
+    CHECK_EQ(amplitude_mismatches, 0);
+    CHECK_EQ(fast_out_of_bound, 0);
+    CHECK_EQ(phase_out_of_bound, 0);
+    CHECK_EQ(coord_out_of_bound, 0);
+    printf("max phase error %.6f rad, max fast amplitude error beyond 4%% %.2f, max coord error %d\n",
+           max_phase_error, max_fast_error, max_coord_error);
+
+    // the edges of the range and clamping of the plot scale
+    CHECK_EQ(csi_phase(0, 0), 0);
+    CHECK_EQ(csi_phase(0, 127), 0);
+    CHECK_EQ(csi_phase(127, 0), CSI_PHASE_PI / 2);
+    CHECK_EQ(csi_phase(-128, 0), -CSI_PHASE_PI / 2);
+    CHECK_EQ(csi_phase(0, -128), CSI_PHASE_PI);
+    CHECK_EQ(csi_angle_coord(CSI_PHASE_PI + 1000), csi_angle_coord(CSI_PHASE_PI));
+    CHECK_EQ(csi_angle_coord(-CSI_PHASE_PI - 1000), csi_angle_coord(-CSI_PHASE_PI));
+    CHECK_EQ(csi_amplitude(-128, -128), 181);
+    return test_result("test_math");
+}
@@ -0,0 +1,103 @@
+/**
+ * @file test_motion.cc
+ * The motion detector on a replayed capture. data/motion_capture.csv was
+ * recorded with csi_host -r 20 -n 240 -m 3: 20 frames a second of a still
+ * room for 3 s, a reflector moving through it for 3 s, still, moving again.
+ * The detector must report exactly the two moving periods, each within a
+ * window of its start and end, and stay quiet in between.
+ *
+ * usage: test_motion <capture.csv>, ctest passes the committed capture
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "csi_tool/csi_tool.h"
+#include "test.h"
+
+#define CAPTURE_RATE 20
+#define CAPTURE_PERIOD_FRAMES (3 * CAPTURE_RATE)
+
+typedef struct {
+    uint32_t frame;
+    bool motion;
+} motion_event_t;
+
+// the frames the capture starts and stops moving at
+static const motion_event_t EXPECTED[] = {
+    {CAPTURE_PERIOD_FRAMES, true},
+    {2 * CAPTURE_PERIOD_FRAMES, false},
+    {3 * CAPTURE_PERIOD_FRAMES, true},
+};
+#define EXPECTED_COUNT (sizeof(EXPECTED) / sizeof(EXPECTED[0]))
+// entering needs a few moving frames in the window, leaving needs the window to clear
+#define ENTER_DELAY (MOTION_WINDOW / 2)
+#define EXIT_DELAY MOTION_WINDOW
+
+static motion_t motion;
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <capture.csv>\n", argv[0]);
+        return 2;
+    }
+    FILE *capture = fopen(argv[1], "r");
+    if (capture == NULL) {
+        perror(argv[1]);
+        return 2;
+    }
+
+    static char line[CSV_LINE_LEN(CSI_MAX_LEN)];
+    static int8_t buf[CSI_MAX_LEN];
+    std::vector<motion_event_t> events;
+    motion_init(&motion, MOTION_ENTER, MOTION_EXIT);
+    uint32_t frames = 0;
+    uint16_t still_peak = 0, moving_low = UINT16_MAX;
+    while (fgets(line, sizeof(line), capture) != NULL) {
+        wifi_csi_info_t info;
+        csi_segments_t segments;
+        if (!replay_parse_row(line, &info, buf)) {
+            continue;
+        }
+        CHECK(csi_parse_segments(&info.rx_ctrl, info.buf, info.len, &segments));
+        if (motion_add(&motion, &segments.segment[CSI_SEGMENT_LLTF])) {
+            events.push_back({frames, motion.motion.load()});
+            printf("frame %u: %s, variance %u change %u\n", frames, motion.motion.load() ? "motion" : "still",
+                   motion.variance_score.load(), motion.change_score.load());
+        }
+
+        // scores in the settled part of each period, past the window of the transition
+        uint32_t in_period = frames % CAPTURE_PERIOD_FRAMES;
+        bool moving = frames / CAPTURE_PERIOD_FRAMES % 2 == 1;
+        if (frames >= MOTION_WINDOW && in_period >= MOTION_WINDOW) {
+            uint16_t score = motion_score(&motion);
+            if (moving) {
+                moving_low = score < moving_low ? score : moving_low;
+            } else {
+                still_peak = score > still_peak ? score : still_peak;
+            }
+        }
+        frames++;
+    }
+    fclose(capture);
+
+    CHECK_EQ(frames, 4 * CAPTURE_PERIOD_FRAMES);
+    CHECK_EQ(events.size(), EXPECTED_COUNT);
+    for (size_t i = 0; i < events.size() && i < EXPECTED_COUNT; i++) {
+        uint32_t delay = EXPECTED[i].motion ? ENTER_DELAY : EXIT_DELAY;
+        CHECK_EQ(events[i].motion, EXPECTED[i].motion);
+        CHECK(events[i].frame >= EXPECTED[i].frame);
+        CHECK(events[i].frame <= EXPECTED[i].frame + delay);
+    }
+    CHECK_EQ(motion.events.load(), EXPECTED_COUNT);
+    CHECK(motion.motion.load());
+
+    // the thresholds sit between the scores of a still and a moving room, with a margin on both sides
+    CHECK(still_peak < MOTION_EXIT);
+    CHECK(moving_low >= MOTION_ENTER);
+    printf("motion: %u frames, still peak %u, moving low %u, enter %u exit %u\n", frames, still_peak, moving_low,
+           MOTION_ENTER, MOTION_EXIT);
+    return test_result("test_motion");
+}
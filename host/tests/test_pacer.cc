@@ -0,0 +1,131 @@
+/**
+ * @file test_pacer.cc
+ * The packet pacer on a simulated clock: an hour long schedule sends every
+ * packet without drift whatever the wakeup jitter, a stalled sender catches
+ * up with at most a burst and skips the rest, rate changes and pauses start
+ * a new schedule, and the achieved rate and lateness are measured.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "csi_tool/src/pacer_component.h"
+#include "test.h"
+
+static pacer_t pacer;
+
+// wake up at now, send whatever is due at the time it is due, return the count sent
+static uint32_t send_due(int64_t now) {
+    uint32_t due = pacer_due(&pacer, now);
+    for (uint32_t i = 0; i < due; i++) {
+        pacer_sent(&pacer, now);
+    }
+    return due;
+}
+
+// an hour at rates that do and don't divide a second, woken with up to 3 ms of jitter
+static void test_no_drift() {
+    const uint32_t rates[] = {100, 300, 7, 997};
+    const int64_t hour = 3600ll * 1000000;
+    srand(1);
+    for (uint32_t rate : rates) {
+        pacer_init(&pacer, rate, PACER_MAX_BURST, 0);
+        int64_t now = 0;
+        uint32_t sent = 0, idle = 0, behind = 0;
+        while (pacer_next_us(&pacer) <= hour) {
+            // woken at or after the next deadline, at least that packet is due
+            uint32_t due = send_due(now);
+            idle += due == 0;
+            sent += due;
+            // the next deadline never lies in the past after sending what was due
+            behind += pacer_next_us(&pacer) <= now;
+            now = pacer_next_us(&pacer) + rand() % 3000;
+        }
+        CHECK_EQ(idle, 0);
+        CHECK_EQ(behind, 0);
+        // packets 0..rate * 3600 have their deadline within the hour, the last wakeup may send a few after it
+        CHECK(sent >= (uint64_t) rate * 3600 + 1);
+        CHECK(sent < (uint64_t) rate * 3600 + 1 + PACER_MAX_BURST);
+        CHECK_EQ(pacer.skipped.load(), 0);
+        CHECK_EQ(pacer_next_us(&pacer), ((int64_t) sent * 1000000 + rate - 1) / rate);
+        CHECK_NEAR(pacer.achieved_rate.load(), rate, rate * 0.01);
+    }
+}
+
+static void test_catch_up() {
+    pacer_init(&pacer, 100, PACER_MAX_BURST, 0);
+    CHECK_EQ(send_due(0), 1);
+    CHECK_EQ(send_due(5000), 0);
+    CHECK_EQ(send_due(10000), 1);
+
+    // a second without wakeups: 100 deadlines passed, only a burst of them is sent
+    CHECK_EQ(send_due(1010000), PACER_MAX_BURST);
+    CHECK_EQ(pacer.skipped.load(), 100 - PACER_MAX_BURST);
+    CHECK_EQ(send_due(1010000), 0);
+    // back on the original schedule, not shifted by the stall
+    CHECK_EQ(pacer_next_us(&pacer), 1020000);
+    CHECK_EQ(send_due(1020000), 1);
+
+    // a sender that falls a little behind catches up without skipping
+    CHECK_EQ(send_due(1050000), 3);
+    CHECK_EQ(pacer.skipped.load(), 100 - PACER_MAX_BURST);
+    CHECK_EQ(pacer.sent.load(), 1 + 1 + PACER_MAX_BURST + 1 + 3);
+}
+
+static void test_rate_change() {
+    pacer_init(&pacer, 100, PACER_MAX_BURST, 0);
+    CHECK_EQ(send_due(0), 1);
+    CHECK_EQ(send_due(10000), 1);
+
+    // the new rate starts a schedule at the next wakeup, nothing is owed from the old one
+    pacer_set_rate(&pacer, 1000);
+    CHECK_EQ(send_due(15000), 1);
+    CHECK_EQ(pacer_next_us(&pacer), 16000);
+    CHECK_EQ(send_due(16000), 1);
+    CHECK_EQ(pacer.skipped.load(), 0);
+
+    // paused, no matter how long
+    pacer_set_rate(&pacer, 0);
+    CHECK_EQ(send_due(17000), 0);
+    CHECK_EQ(send_due(60000000), 0);
+    CHECK_EQ(pacer.skipped.load(), 0);
+
+    // resumed, again from the wakeup
+    pacer_set_rate(&pacer, 10);
+    CHECK_EQ(send_due(60000001), 1);
+    CHECK_EQ(pacer_next_us(&pacer), 60100001);
+    CHECK_EQ(send_due(60100000), 0);
+    CHECK_EQ(send_due(60100001), 1);
+
+    // rates beyond what the radio can do are clamped
+    pacer_set_rate(&pacer, 10 * PACER_MAX_RATE);
+    CHECK_EQ(pacer.requested_rate.load(), PACER_MAX_RATE);
+    pacer_init(&pacer, 10 * PACER_MAX_RATE, PACER_MAX_BURST, 0);
+    CHECK_EQ(pacer.rate, PACER_MAX_RATE);
+}
+
+static void test_lateness() {
+    stats_reset();
+    pacer_init(&pacer, 100, PACER_MAX_BURST, 0);
+    send_due(0);
+    // woken 700 us late, the packet is booked against its deadline
+    CHECK_EQ(send_due(10700), 1);
+    CHECK_EQ(stats_count(STATS_STAGE_PACER), 2);
+    CHECK_EQ(stats_max_us(STATS_STAGE_PACER), 700);
+
+    // a window of 1 s measures the achieved rate, a sender at half the rate shows it
+    pacer_init(&pacer, 100, 1, 0);
+    for (int64_t now = 0; now <= 2000000; now += 20000) {
+        send_due(now);
+    }
+    CHECK_NEAR(pacer.achieved_rate.load(), 50, 1);
+    CHECK_EQ(pacer.skipped.load(), 100);
+}
+
+int main() {
+    test_no_drift();
+    test_catch_up();
+    test_rate_change();
+    test_lateness();
+    return test_result("test_pacer");
+}
@@ -0,0 +1,134 @@
+/**
+ * @file test_phase.cc
+ * Phase sanitization on synthetic phases: a wrapped linear phase across
+ * the LLTF subcarriers unwraps to its line, so the residual is zero and
+ * the fit returns the slope and, modulo a turn, the offset. A bump on one
+ * subcarrier stays in the residual, the time average follows its weight
+ * and restarts when the layout changes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "csi_tool/src/phase_component.h"
+#include "test.h"
+
+#define TURN (2 * CSI_PHASE_PI)
+
+static phase_sanitizer_t sanitizer;
+static int32_t phase[PHASE_MAX_SUBC];
+static int16_t freq[PHASE_MAX_SUBC];
+static int16_t slot[PHASE_MAX_SUBC];
+static int32_t out[PHASE_MAX_SUBC];
+
+// into [-pi, pi) like the atan2 kernel reports it
+static int32_t wrap(int64_t angle) {
+    int64_t a = ((angle + CSI_PHASE_PI) % TURN + TURN) % TURN;
+    return (int32_t) (a - CSI_PHASE_PI);
+}
+
+// the 52 data and pilot subcarriers of the 20 MHz LLTF, -26..26 without DC
+static int lltf_line(double slope, double offset) {
+    int n = 0;
+    for (int k = -26; k <= 26; k++) {
+        if (k == 0) {
+            continue;
+        }
+        freq[n] = k;
+        slot[n] = k + 32;
+        phase[n] = wrap((int64_t) (offset + slope * k + 0.5));
+        n++;
+    }
+    return n;
+}
+
+static int32_t worst_residual(int n) {
+    int32_t worst = 0;
+    for (int i = 0; i < n; i++) {
+        int32_t r = out[i] < 0 ? -out[i] : out[i];
+        worst = r > worst ? r : worst;
+    }
+    return worst;
+}
+
+static void test_linear() {
+    // slopes of both signs, steep ones wrap the phase more than once across the band
+    const double slopes[] = {0.0, 1000.0, -1000.0, 0.3 * CSI_PHASE_PI, -0.45 * CSI_PHASE_PI};
+    const double offsets[] = {0.0, 12345.0, -0.9 * CSI_PHASE_PI};
+    for (double slope : slopes) {
+        for (double offset : offsets) {
+            phase_sanitizer_init(&sanitizer, 0);
+            int n = lltf_line(slope, offset);
+            phase_sanitize(&sanitizer, 64, phase, freq, slot, n, out);
+            CHECK(worst_residual(n) <= 1);
+            CHECK_NEAR(sanitizer.slope_q16 / 65536.0, slope, 0.1);
+            // the line starts at the wrapped first phase, so the offset is known up to whole turns
+            CHECK(llabs(wrap((sanitizer.offset_q16 >> 16) - (int64_t) offset)) <= 1);
+        }
+    }
+}
+
+static void test_bump() {
+    phase_sanitizer_init(&sanitizer, 0);
+    int n = lltf_line(2000.0, 100.0);
+    // a reflection on one subcarrier is not part of the line, the fit only leans towards it by its leverage
+    int bumped = 10;
+    double skk = 0;
+    for (int i = 0; i < n; i++) {
+        skk += freq[i] * freq[i];
+    }
+    phase[bumped] = wrap(phase[bumped] + 5000);
+    phase_sanitize(&sanitizer, 64, phase, freq, slot, n, out);
+    CHECK_NEAR(out[bumped], 5000 * (1 - 1.0 / n - freq[bumped] * freq[bumped] / skk), 2);
+    CHECK_NEAR(sanitizer.slope_q16 / 65536.0, 2000.0 + 5000 * freq[bumped] / skk, 0.1);
+    // least squares residuals sum to zero
+    int32_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += out[i];
+    }
+    CHECK(sum >= -n && sum <= n);
+}
+
+static void test_smoothing() {
+    // weight 1/4 for each new window
+    phase_sanitizer_init(&sanitizer, 2);
+    int n = lltf_line(1500.0, 0.0);
+    int bumped = 20;
+    phase[bumped] = wrap(phase[bumped] + 4000);
+    phase_sanitize(&sanitizer, 64, phase, freq, slot, n, out);
+    // the first window primes the average
+    int32_t first = out[bumped];
+    CHECK(first > 3800);
+
+    // the bump is gone, the average decays by a quarter per window
+    n = lltf_line(1500.0, 0.0);
+    double expected = first;
+    for (int w = 0; w < 4; w++) {
+        phase_sanitize(&sanitizer, 64, phase, freq, slot, n, out);
+        expected *= 0.75;
+        CHECK_NEAR(out[bumped], expected, 2);
+    }
+
+    // another layout starts over without the history
+    phase_sanitize(&sanitizer, 128, phase, freq, slot, n, out);
+    CHECK(worst_residual(n) <= 1);
+}
+
+static void test_too_few() {
+    phase_sanitizer_init(&sanitizer, 0);
+    phase[0] = 1234;
+    freq[0] = 3;
+    slot[0] = 0;
+    out[0] = -1;
+    phase_sanitize(&sanitizer, 64, phase, freq, slot, 1, out);
+    CHECK_EQ(out[0], 0);
+}
+
+int main() {
+    test_linear();
+    test_bump();
+    test_smoothing();
+    test_too_few();
+    return test_result("test_phase");
+}
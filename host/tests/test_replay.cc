@@ -0,0 +1,152 @@
+/**
+ * @file test_replay.cc
+ * Parsing of capture rows by the replay engine: rows written by the CSV
+ * formatter come back field for field, malformed rows are rejected and a
+ * capture with them counts parse errors instead of injecting frames.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "csi_tool/csi_tool.h"
+#include "test.h"
+
+static int8_t iq[CSI_MAX_LEN];
+static int8_t parsed[CSI_MAX_LEN];
+static char line[CSV_LINE_LEN(CSI_MAX_LEN)];
+
+static void make_row(uint16_t len) {
+    csi_record_t rec;
+    memset(&rec, 0, sizeof(rec));
+    memcpy(rec.role, "STA", 3);
+    uint8_t mac[6] = {0x7C, 0x9E, 0xBD, 0x65, 0xB2, 0x3D};
+    memcpy(rec.mac, mac, 6);
+    rec.rssi = -45;
+    rec.sig_mode = 1;
+    rec.stbc = 1;
+    rec.noise_floor = -95;
+    rec.channel = 6;
+    rec.secondary_channel = 2;
+    rec.local_timestamp = 4000000123u;
+    rec.sig_len = 44;
+    rec.real_timestamp = 1700000000123456ull;
+    for (int i = 0; i < len; i++) {
+        iq[i] = (int8_t) (i * 37 - 128);
+    }
+    rec.len = len;
+    rec.data = iq;
+    csv_format_row(&rec, line, sizeof(line));
+}
+
+// replace the first occurrence of from in line
+static void edit(const char *from, const char *to) {
+    char *at = strstr(line, from);
+    CHECK(at != NULL);
+    if (at == NULL) {
+        return;
+    }
+    static char rest[sizeof(line)];
+    strcpy(rest, at + strlen(from));
+    strcpy(at, to);
+    strcat(at, rest);
+}
+
+static bool parse() {
+    wifi_csi_info_t info;
+    static char copy[sizeof(line)];
+    strcpy(copy, line);
+    return replay_parse_row(copy, &info, parsed);
+}
+
+static void test_round_trip() {
+    make_row(384);
+    wifi_csi_info_t info;
+    CHECK(replay_parse_row(line, &info, parsed));
+    CHECK_EQ(info.len, 384);
+    CHECK_EQ(info.rx_ctrl.rssi, -45);
+    CHECK_EQ(info.rx_ctrl.sig_mode, 1);
+    CHECK_EQ(info.rx_ctrl.stbc, 1);
+    CHECK_EQ(info.rx_ctrl.noise_floor, -95);
+    CHECK_EQ(info.rx_ctrl.secondary_channel, 2);
+    CHECK_EQ(info.rx_ctrl.timestamp, 4000000123u);
+    CHECK_EQ(info.mac[0], 0x7C);
+    CHECK_EQ(info.mac[5], 0x3D);
+    CHECK(info.buf == parsed);
+    CHECK(memcmp(parsed, iq, 384) == 0);
+}
+
+static void test_rejects() {
+    make_row(4);
+    CHECK(parse());
+    make_row(CSI_MAX_LEN);
+    CHECK(parse());
+
+    // len 0 rows have no segments to plot
+    make_row(0);
+    CHECK(!parse());
+    // fewer values than len
+    make_row(4);
+    edit(",4,[", ",5,[");
+    CHECK(!parse());
+    // more values than len
+    make_row(4);
+    edit(",4,[", ",3,[");
+    CHECK(!parse());
+    // len beyond the largest csi buffer
+    make_row(4);
+    edit(",4,[", ",613,[");
+    CHECK(!parse());
+    // a value out of the int8 range
+    make_row(4);
+    edit("[-128 ", "[-300 ");
+    CHECK(!parse());
+    // no closing bracket
+    make_row(4);
+    edit("]", "");
+    CHECK(!parse());
+    // no array at all
+    make_row(4);
+    edit("[", "");
+    CHECK(!parse());
+    // header and log lines
+    strcpy(line, CSV_HEADER);
+    CHECK(!parse());
+    strcpy(line, "I (123) wifi: connected\n");
+    CHECK(!parse());
+}
+
+static void test_capture() {
+    FILE *capture = tmpfile();
+    fputs(CSV_HEADER, capture);
+    make_row(128);
+    fputs(line, capture);
+    make_row(0);
+    fputs(line, capture);
+    make_row(128);
+    edit(",128,[", ",127,[");
+    fputs(line, capture);
+    fputs("I (123) a log line\n", capture);
+    make_row(256);
+    fputs(line, capture);
+    rewind(capture);
+
+    replay_config_t config;
+    config.mode = REPLAY_FAST;
+    config.speed = 0;
+    replay_stats_t stats;
+    replay_run(capture, &config, &stats);
+    fclose(capture);
+
+    CHECK_EQ(stats.rows, 6);
+    CHECK_EQ(stats.frames, 2);
+    CHECK_EQ(stats.parse_errors, 2);
+}
+
+int main() {
+    output_set_enabled(OUTPUT_SERIAL, false);
+    csi_init((char *) "STA");
+    test_round_trip();
+    test_rejects();
+    test_capture();
+    return test_result("test_replay");
+}
@@ -0,0 +1,220 @@
+/**
+ * @file test_ring.cc
+ * Unit tests of the CSI frame ring: order and copies, both overflow policies,
+ * wraparound of the slot index and of the 32 bit counters, truncation, and a
+ * producer and consumer thread checking that no popped frame is torn.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+#include "csi_tool/src/ring_component.h"
+#include "test.h"
+
+static csi_ring_t ring;
+static int8_t payload[CSI_MAX_LEN + 16];
+
+// a frame whose payload, timestamp and rssi all encode seq
+static wifi_csi_info_t make_info(uint32_t seq, uint16_t len) {
+    wifi_csi_info_t info;
+    memset(&info, 0, sizeof(info));
+    memset(payload, (int8_t) seq, sizeof(payload));
+    info.rx_ctrl.rssi = -(int) (seq % 100);
+    info.rx_ctrl.timestamp = seq;
+    info.mac[5] = seq;
+    info.buf = payload;
+    info.len = len;
+    return info;
+}
+
+static bool frame_is(const csi_frame_t *frame, uint32_t seq, uint16_t len) {
+    if (frame->rx_ctrl.timestamp != seq || frame->rx_us != (int64_t) seq || frame->len != len ||
+        frame->mac[5] != (uint8_t) seq || frame->rx_ctrl.rssi != -(int) (seq % 100)) {
+        return false;
+    }
+    for (int i = 0; i < len; i++) {
+        if (frame->buf[i] != (int8_t) seq) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void push(uint32_t seq, uint16_t len = 128) {
+    wifi_csi_info_t info = make_info(seq, len);
+    csi_ring_push(&ring, &info, seq);
+}
+
+static void test_order() {
+    static csi_frame_t frame;
+    csi_ring_init(&ring, CSI_RING_DROP_OLDEST);
+    CHECK(!csi_ring_pop(&ring, &frame));
+    for (uint32_t i = 0; i < 5; i++) {
+        push(i, 100 + i);
+    }
+    CHECK_EQ(csi_ring_count(&ring), 5);
+    CHECK_EQ(ring.high_water.load(), 5);
+    for (uint32_t i = 0; i < 5; i++) {
+        CHECK(csi_ring_pop(&ring, &frame));
+        CHECK(frame_is(&frame, i, 100 + i));
+    }
+    CHECK(!csi_ring_pop(&ring, &frame));
+    CHECK_EQ(ring.pushed.load(), 5);
+    CHECK_EQ(ring.overflows.load(), 0);
+    // the mark stays at the fullest the ring has been
+    push(5);
+    CHECK_EQ(ring.high_water.load(), 5);
+}
+
+static void test_drop_oldest() {
+    static csi_frame_t frame;
+    csi_ring_init(&ring, CSI_RING_DROP_OLDEST);
+    for (uint32_t i = 0; i < CSI_RING_LEN + 3; i++) {
+        push(i);
+    }
+    CHECK_EQ(csi_ring_count(&ring), CSI_RING_LEN);
+    CHECK_EQ(ring.high_water.load(), CSI_RING_LEN);
+    CHECK_EQ(ring.overflows.load(), 3);
+    CHECK_EQ(ring.pushed.load(), CSI_RING_LEN + 3);
+    // the three oldest frames are gone, the rest come out in order
+    for (uint32_t i = 3; i < CSI_RING_LEN + 3; i++) {
+        CHECK(csi_ring_pop(&ring, &frame));
+        CHECK(frame_is(&frame, i, 128));
+    }
+    CHECK(!csi_ring_pop(&ring, &frame));
+}
+
+static void test_drop_newest() {
+    static csi_frame_t frame;
+    csi_ring_init(&ring, CSI_RING_DROP_NEWEST);
+    for (uint32_t i = 0; i < CSI_RING_LEN; i++) {
+        push(i);
+    }
+    wifi_csi_info_t info = make_info(999, 128);
+    CHECK(!csi_ring_push(&ring, &info, 999));
+    CHECK(!csi_ring_push(&ring, &info, 999));
+    CHECK_EQ(ring.overflows.load(), 2);
+    CHECK_EQ(ring.pushed.load(), CSI_RING_LEN);
+    CHECK_EQ(ring.high_water.load(), CSI_RING_LEN);
+    for (uint32_t i = 0; i < CSI_RING_LEN; i++) {
+        CHECK(csi_ring_pop(&ring, &frame));
+        CHECK(frame_is(&frame, i, 128));
+    }
+    CHECK(!csi_ring_pop(&ring, &frame));
+}
+
+static void test_wraparound() {
+    static csi_frame_t frame;
+    csi_ring_init(&ring, CSI_RING_DROP_OLDEST);
+    // the slot index wraps many times with the ring never empty
+    uint32_t next_push = 0, next_pop = 0;
+    for (int round = 0; round < 10 * CSI_RING_LEN; round++) {
+        push(next_push++);
+        push(next_push++);
+        CHECK(csi_ring_pop(&ring, &frame));
+        CHECK(frame_is(&frame, next_pop, 128));
+        next_pop++;
+        if (csi_ring_count(&ring) >= CSI_RING_LEN - 1) {
+            while (csi_ring_pop(&ring, &frame)) {
+                CHECK(frame_is(&frame, next_pop, 128));
+                next_pop++;
+            }
+        }
+    }
+    CHECK_EQ(ring.overflows.load(), 0);
+
+    // head and tail are free running counters, they wrap at 2^32 too
+    csi_ring_init(&ring, CSI_RING_DROP_OLDEST);
+    ring.head.store(UINT32_MAX - 2);
+    ring.tail.store(UINT32_MAX - 2);
+    for (uint32_t i = 0; i < CSI_RING_LEN + 2; i++) {
+        push(i);
+    }
+    CHECK_EQ(csi_ring_count(&ring), CSI_RING_LEN);
+    CHECK_EQ(ring.overflows.load(), 2);
+    for (uint32_t i = 2; i < CSI_RING_LEN + 2; i++) {
+        CHECK(csi_ring_pop(&ring, &frame));
+        CHECK(frame_is(&frame, i, 128));
+    }
+    CHECK(!csi_ring_pop(&ring, &frame));
+}
+
+static void test_truncate() {
+    static csi_frame_t frame;
+    csi_ring_init(&ring, CSI_RING_DROP_OLDEST);
+    push(7, CSI_MAX_LEN + 10);
+    CHECK_EQ(ring.truncated.load(), 1);
+    CHECK(csi_ring_pop(&ring, &frame));
+    CHECK(frame_is(&frame, 7, CSI_MAX_LEN));
+}
+
+// the consumer must only ever see whole frames in increasing order, dropped ones leave gaps
+static void test_threads(csi_ring_policy_t policy) {
+    // enough frames for both threads to lap the ring many times, ring_bench measures the throughput
+    const uint32_t frames = 20000;
+    csi_ring_init(&ring, policy);
+    std::atomic<bool> done(false);
+    uint32_t popped = 0, torn = 0, out_of_order = 0;
+
+    std::thread consumer([&] {
+        static csi_frame_t frame;
+        int64_t last = -1;
+        while (true) {
+            bool finished = done.load();
+            if (!csi_ring_pop(&ring, &frame)) {
+                if (finished) {
+                    break;
+                }
+                continue;
+            }
+            popped++;
+            if (!frame_is(&frame, frame.rx_ctrl.timestamp, 64 + frame.rx_ctrl.timestamp % 64)) {
+                torn++;
+            }
+            if ((int64_t) frame.rx_ctrl.timestamp <= last) {
+                out_of_order++;
+            }
+            last = frame.rx_ctrl.timestamp;
+        }
+    });
+
+    // a private payload, the one of make_info belongs to the main thread's tests
+    static int8_t buf[CSI_MAX_LEN];
+    for (uint32_t i = 0; i < frames; i++) {
+        wifi_csi_info_t info;
+        memset(&info, 0, sizeof(info));
+        memset(buf, (int8_t) i, sizeof(buf));
+        info.rx_ctrl.rssi = -(int) (i % 100);
+        info.rx_ctrl.timestamp = i;
+        info.mac[5] = i;
+        info.buf = buf;
+        info.len = 64 + i % 64;
+        csi_ring_push(&ring, &info, i);
+        // give a single cpu a chance to run the consumer in between
+        if (i % 16 == 0) {
+            std::this_thread::yield();
+        }
+    }
+    done = true;
+    consumer.join();
+
+    CHECK_EQ(torn, 0);
+    CHECK_EQ(out_of_order, 0);
+    CHECK_EQ(ring.pushed.load(), policy == CSI_RING_DROP_OLDEST ? frames : frames - ring.overflows.load());
+    // with drop oldest every push lands, what the consumer missed was overwritten
+    CHECK_EQ(popped + (policy == CSI_RING_DROP_OLDEST ? ring.overflows.load() : 0), ring.pushed.load());
+    printf("threads %s: %u frames, %u popped, %u overflows\n",
+           policy == CSI_RING_DROP_OLDEST ? "drop oldest" : "drop newest", frames, popped, ring.overflows.load());
+}
+
+int main() {
+    test_order();
+    test_drop_oldest();
+    test_drop_newest();
+    test_wraparound();
+    test_truncate();
+    test_threads(CSI_RING_DROP_OLDEST);
+    test_threads(CSI_RING_DROP_NEWEST);
+    return test_result("test_ring");
+}
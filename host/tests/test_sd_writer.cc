@@ -0,0 +1,223 @@
+/**
+ * @file test_sd_writer.cc
+ * The SD ping-pong writer against a regular file: cluster-sized writes in
+ * order, the size and time sync policy on a fake clock, the room a producer
+ * may fill without dropping, and a producer and writer thread locking like
+ * sd_component.h, checking that the file holds every byte in order.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+#include "csi_tool/src/sd_writer_component.h"
+#include "test.h"
+
+static int64_t fake_now = 0;
+
+static int64_t fake_clock_us() {
+    return fake_now;
+}
+
+static uint8_t pattern(size_t i) {
+    return (uint8_t) (i * 7 + i / 251);
+}
+
+// everything written to the file so far
+static size_t read_back(FILE *file, uint8_t *out, size_t cap) {
+    fflush(file);
+    rewind(file);
+    size_t n = fread(out, 1, cap, file);
+    fseek(file, 0, SEEK_END);
+    return n;
+}
+
+// hand everything over and write it, like sd_writer_task after a sync request
+static void drain(sd_writer_t *w) {
+    sd_writer_rotate(w);
+    int idx;
+    while ((idx = sd_writer_ready(w)) >= 0) {
+        sd_writer_write_buffer(w, idx);
+        sd_writer_release(w, idx);
+        sd_writer_rotate(w);
+    }
+}
+
+static void test_clusters() {
+    static uint8_t data[3 * SD_WRITER_BUF_LEN + 1000];
+    static uint8_t back[sizeof(data)];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = pattern(i);
+    }
+
+    FILE *file = tmpfile();
+    sd_writer_t w;
+    fake_now = 0;
+    CHECK(sd_writer_init(&w, file, 1 << 30, 1000, &fake_clock_us));
+
+    // a small append stays in the active buffer
+    CHECK(!sd_writer_append(&w, data, 100));
+    CHECK_EQ(sd_writer_ready(&w), -1);
+    CHECK_EQ(read_back(file, back, sizeof(back)), 0);
+
+    // filling the buffer hands it off, the writer writes exactly one cluster
+    CHECK(sd_writer_append(&w, data + 100, SD_WRITER_BUF_LEN - 100));
+    int idx = sd_writer_ready(&w);
+    CHECK(idx >= 0);
+    sd_writer_write_buffer(&w, idx);
+    sd_writer_release(&w, idx);
+    CHECK_EQ(w.buffers_written, 1);
+    CHECK_EQ(w.bytes_written, SD_WRITER_BUF_LEN);
+
+    // the rest in odd sized pieces, written one buffer at a time
+    size_t offset = SD_WRITER_BUF_LEN;
+    while (offset < sizeof(data)) {
+        size_t n = sizeof(data) - offset < 1234 ? sizeof(data) - offset : 1234;
+        if (sd_writer_append(&w, data + offset, n)) {
+            idx = sd_writer_ready(&w);
+            sd_writer_write_buffer(&w, idx);
+            sd_writer_release(&w, idx);
+        }
+        offset += n;
+    }
+    drain(&w);
+
+    CHECK_EQ(read_back(file, back, sizeof(back)), sizeof(data));
+    CHECK(memcmp(back, data, sizeof(data)) == 0);
+    CHECK_EQ(w.buffers_written, 4);
+    CHECK_EQ(w.write_errors, 0);
+    fclose(file);
+}
+
+static void test_sync_policy() {
+    static uint8_t data[SD_WRITER_BUF_LEN];
+    FILE *file = tmpfile();
+    sd_writer_t w;
+    fake_now = 0;
+    // sync after two clusters or 1000 ms, whichever comes first
+    CHECK(sd_writer_init(&w, file, 2 * SD_WRITER_BUF_LEN, 1000, &fake_clock_us));
+
+    for (int i = 0; i < 2; i++) {
+        sd_writer_append(&w, data, sizeof(data));
+        sd_writer_write_buffer(&w, sd_writer_ready(&w));
+        sd_writer_release(&w, 1 - w.active);
+        fake_now += 10000;
+    }
+    CHECK_EQ(w.syncs, 1);
+    CHECK_EQ(w.unsynced, 0);
+
+    // a partly filled buffer ages on the clock, one write of it is due after the interval
+    sd_writer_append(&w, data, 10);
+    CHECK_EQ(sd_writer_active_age_us(&w), 0);
+    fake_now += 400000;
+    CHECK_EQ(sd_writer_active_age_us(&w), 400000);
+    fake_now += 700000;
+    drain(&w);
+    CHECK_EQ(w.syncs, 2);
+    CHECK_EQ(sd_writer_active_age_us(&w), 0);
+    fclose(file);
+}
+
+static void test_room() {
+    static uint8_t data[SD_WRITER_BUF_LEN];
+    FILE *file = tmpfile();
+    sd_writer_t w;
+    CHECK(sd_writer_init(&w, file, 1 << 30, 1000, &fake_clock_us));
+
+    // both buffers free: the whole active buffer
+    CHECK_EQ(sd_writer_room(&w), SD_WRITER_BUF_LEN);
+    CHECK(sd_writer_append(&w, data, sizeof(data)));
+
+    // the other buffer is out for writing: one byte short of filling the active one
+    CHECK_EQ(sd_writer_room(&w), SD_WRITER_BUF_LEN - 1);
+    CHECK(!sd_writer_append(&w, data, sd_writer_room(&w)));
+    CHECK_EQ(sd_writer_room(&w), 0);
+    CHECK_EQ(w.lens[w.active], SD_WRITER_BUF_LEN - 1);
+
+    // once it is written the active buffer can be filled and handed off
+    int idx = sd_writer_ready(&w);
+    sd_writer_write_buffer(&w, idx);
+    sd_writer_release(&w, idx);
+    CHECK_EQ(sd_writer_room(&w), 1);
+    CHECK(sd_writer_append(&w, data, 1));
+    CHECK_EQ(sd_writer_ready(&w), 1 - w.active);
+    CHECK_EQ(w.lens[1 - w.active], SD_WRITER_BUF_LEN);
+    fclose(file);
+}
+
+// producer and writer threads sharing a lock, the producer waits for room like _sd_write
+static void test_threads() {
+    const size_t total = 40 * SD_WRITER_BUF_LEN + 4321;
+    FILE *file = tmpfile();
+    sd_writer_t w;
+    CHECK(sd_writer_init(&w, file, 4 * SD_WRITER_BUF_LEN, 1000, &fake_clock_us));
+    std::mutex lock;
+    std::atomic<bool> done(false);
+
+    std::thread writer([&] {
+        while (true) {
+            bool finished = done.load();
+            lock.lock();
+            if (finished) {
+                sd_writer_rotate(&w);
+            }
+            int idx = sd_writer_ready(&w);
+            lock.unlock();
+            if (idx < 0) {
+                if (finished) {
+                    break;
+                }
+                std::this_thread::yield();
+                continue;
+            }
+            sd_writer_write_buffer(&w, idx);
+            lock.lock();
+            sd_writer_release(&w, idx);
+            lock.unlock();
+        }
+    });
+
+    uint8_t chunk[777];
+    size_t offset = 0;
+    while (offset < total) {
+        size_t len = total - offset < sizeof(chunk) ? total - offset : sizeof(chunk);
+        lock.lock();
+        size_t n = sd_writer_room(&w);
+        n = n < len ? n : len;
+        for (size_t i = 0; i < n; i++) {
+            chunk[i] = pattern(offset + i);
+        }
+        sd_writer_append(&w, chunk, n);
+        lock.unlock();
+        if (n == 0) {
+            std::this_thread::yield();
+        }
+        offset += n;
+    }
+    done = true;
+    writer.join();
+
+    uint8_t *back = (uint8_t *) malloc(total + 1);
+    CHECK_EQ(read_back(file, back, total + 1), total);
+    size_t mismatch = total;
+    for (size_t i = 0; i < total; i++) {
+        if (back[i] != pattern(i)) {
+            mismatch = i;
+            break;
+        }
+    }
+    CHECK_EQ(mismatch, total);
+    free(back);
+    fclose(file);
+}
+
+int main() {
+    test_clusters();
+    test_sync_policy();
+    test_room();
+    test_threads();
+    return test_result("test_sd_writer");
+}
@@ -0,0 +1,125 @@
+/**
+ * @file test_segment.cc
+ * The csi layout parser against the table of the ESP-IDF Wi-Fi guide: for
+ * each of the 13 layouts the packet flags find it, the full buffer and every
+ * prefix of it split into segments with the expected subcarriers, and empty,
+ * short, odd and overlong buffers are rejected.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "csi_tool/src/segment_component.h"
+#include "test.h"
+
+// one segment: its subcarrier count and lowest and highest index
+typedef struct {
+    uint16_t subc;
+    int8_t low;
+    int8_t high;
+} expected_segment_t;
+
+typedef struct {
+    uint8_t secondary_channel;
+    bool ht;
+    bool bw40;
+    bool stbc;
+    uint16_t bytes;
+    uint8_t count;
+    expected_segment_t segment[CSI_SEGMENT_COUNT];
+} expected_layout_t;
+
+static const expected_layout_t EXPECTED[] = {
+    {0, false, false, false, 128, 1, {{64, -32, 31}}},
+    {0, true, false, false, 256, 2, {{64, -32, 31}, {64, -32, 31}}},
+    {0, true, false, true, 384, 3, {{64, -32, 31}, {64, -32, 31}, {64, -32, 31}}},
+    {2, false, false, false, 128, 1, {{64, 0, 63}}},
+    {2, true, false, false, 256, 2, {{64, 0, 63}, {64, 0, 63}}},
+    {2, true, false, true, 380, 3, {{64, 0, 63}, {63, 0, 62}, {63, 0, 62}}},
+    {2, true, true, false, 384, 2, {{64, 0, 63}, {128, -64, 63}}},
+    {2, true, true, true, 612, 3, {{64, 0, 63}, {121, -60, 60}, {121, -60, 60}}},
+    {1, false, false, false, 128, 1, {{64, -64, -1}}},
+    {1, true, false, false, 256, 2, {{64, -64, -1}, {64, -64, -1}}},
+    {1, true, false, true, 376, 3, {{64, -64, -1}, {62, -62, -1}, {62, -62, -1}}},
+    {1, true, true, false, 384, 2, {{64, -64, -1}, {128, -64, 63}}},
+    {1, true, true, true, 612, 3, {{64, -64, -1}, {121, -60, 60}, {121, -60, 60}}},
+};
+
+static int8_t buf[640];
+
+static wifi_pkt_rx_ctrl_t rx_ctrl_of(const expected_layout_t *e) {
+    wifi_pkt_rx_ctrl_t rx_ctrl;
+    memset(&rx_ctrl, 0, sizeof(rx_ctrl));
+    rx_ctrl.secondary_channel = e->secondary_channel;
+    rx_ctrl.sig_mode = e->ht ? 1 : 0;
+    rx_ctrl.cwb = e->bw40;
+    rx_ctrl.stbc = e->stbc;
+    return rx_ctrl;
+}
+
+// in ascending order the indices run from low to high one by one
+static void check_segment(const csi_segment_t *seg, const expected_segment_t *e, const int8_t *data) {
+    CHECK_EQ(seg->subc, e->subc);
+    CHECK_EQ(e->high - e->low + 1, e->subc);
+    CHECK(seg->data == data);
+    int steps = 0;
+    for (int j = 0; j < seg->subc; j++) {
+        steps += csi_segment_index(seg, csi_segment_order(seg, j)) == e->low + j;
+    }
+    CHECK_EQ(steps, e->subc);
+}
+
+static void test_layout(const expected_layout_t *e) {
+    wifi_pkt_rx_ctrl_t rx_ctrl = rx_ctrl_of(e);
+    csi_segments_t segments;
+
+    const csi_layout_t *layout = csi_find_layout(e->secondary_channel, e->ht, e->bw40, e->stbc);
+    CHECK(layout != NULL);
+    CHECK_EQ(layout->count, e->count);
+
+    // the full buffer and every prefix of whole segments
+    uint16_t prefix = 0;
+    for (int n = 1; n <= e->count; n++) {
+        prefix += e->segment[n - 1].subc * 2;
+        CHECK(csi_parse_segments(&rx_ctrl, buf, prefix, &segments));
+        CHECK_EQ(segments.count, n);
+        CHECK(csi_has_segment(&segments, CSI_SEGMENT_LLTF));
+        CHECK_EQ(csi_has_segment(&segments, CSI_SEGMENT_HT_LTF), n > 1);
+        const int8_t *data = buf;
+        for (int s = 0; s < n; s++) {
+            CHECK_EQ(segments.segment[s].type, s);
+            check_segment(&segments.segment[s], &e->segment[s], data);
+            data += e->segment[s].subc * 2;
+        }
+    }
+    CHECK_EQ(prefix, e->bytes);
+
+    // empty, cut inside a segment, one byte short or long, and one pair too many
+    const uint16_t bad[] = {0, 2, 126, (uint16_t) (e->bytes - 1), (uint16_t) (e->bytes + 1), (uint16_t) (e->bytes + 2)};
+    for (uint16_t len : bad) {
+        segments.count = 7;
+        CHECK(!csi_parse_segments(&rx_ctrl, buf, len, &segments));
+        CHECK_EQ(segments.count, 0);
+    }
+}
+
+static void test_lookup() {
+    csi_segments_t segments;
+    // non-HT packets ignore the bandwidth and STBC flags
+    CHECK(csi_find_layout(1, false, true, true) == csi_find_layout(1, false, false, false));
+    // secondary channel values outside 0..2 have no layout
+    CHECK(csi_find_layout(3, true, false, false) == NULL);
+    CHECK(!csi_parse_layout(NULL, buf, 128, &segments));
+    CHECK_EQ(segments.count, 0);
+    // 40 MHz needs a secondary channel
+    CHECK(csi_find_layout(0, true, true, false) == NULL);
+}
+
+int main() {
+    CHECK_EQ(sizeof(EXPECTED) / sizeof(EXPECTED[0]), CSI_LAYOUT_COUNT);
+    for (size_t i = 0; i < sizeof(EXPECTED) / sizeof(EXPECTED[0]); i++) {
+        test_layout(&EXPECTED[i]);
+    }
+    test_lookup();
+    return test_result("test_segment");
+}
@@ -0,0 +1,138 @@
+/**
+ * @file test_soak.cc
+ * Soak run of the whole pipeline: rounds of frames in the layouts the driver
+ * hands out go through the csi callback, the ring, the dsp task and a file
+ * sink. After every round the ring, the sink queue and the heap in use must
+ * be back where the first round left them, so nothing grows per frame.
+ * The LVGL chart of the device build can't run here, its memory is logged by
+ * guiTask on the device instead.
+ *
+ * usage: test_soak [rounds], ctest runs a short soak, pass more for hours
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+
+#include "csi_tool/csi_tool.h"
+#include "test.h"
+
+#define SOAK_ROUNDS 10
+#define SOAK_FRAMES 20000
+#define SOAK_HEAP_SLACK 4096    // glibc may keep a little more in its per-thread caches
+
+static std::atomic<uint32_t> sink_rows(0);
+
+#if defined __SANITIZE_ADDRESS__ || defined __SANITIZE_THREAD__
+#define SOAK_SANITIZER_HEAP
+extern "C" size_t __sanitizer_get_current_allocated_bytes();
+#endif
+
+// bytes the program holds on the heap, the sanitizers replace the glibc allocator
+static size_t heap_in_use() {
+#ifdef SOAK_SANITIZER_HEAP
+    return __sanitizer_get_current_allocated_bytes();
+#else
+    return mallinfo2().uordblks;
+#endif
+}
+
+// stands in for the SD card, counts the CSV rows instead of storing them
+static void count_rows(void *ctx, const void *data, size_t len) {
+    const char *text = (const char *) data;
+    uint32_t rows = 0;
+    for (size_t i = 0; i < len; i++) {
+        rows += text[i] == '\n';
+    }
+    sink_rows.fetch_add(rows);
+}
+
+// non-HT LLTF, HT LLTF and HT-LTF, STBC, and HT40 below the primary, the last restarts the window
+static void set_layout(wifi_csi_info_t *info, uint32_t n) {
+    static const struct {
+        uint8_t sig_mode, cwb, stbc, secondary;
+        uint16_t len;
+    } layouts[] = {{0, 0, 0, 0, 128}, {1, 0, 0, 0, 256}, {1, 0, 1, 0, 384}, {1, 1, 0, 2, 384}};
+    int l = (n / 64) % 4;
+    info->rx_ctrl.sig_mode = layouts[l].sig_mode;
+    info->rx_ctrl.cwb = layouts[l].cwb;
+    info->rx_ctrl.stbc = layouts[l].stbc;
+    info->rx_ctrl.secondary_channel = layouts[l].secondary;
+    info->len = layouts[l].len;
+}
+
+static void round_of_frames(uint32_t first) {
+    static int8_t buf[CSI_MAX_LEN];
+    wifi_csi_info_t info;
+    memset(&info, 0, sizeof(info));
+    unsigned int mac[6];
+    sscanf(MAC_AP, "%x:%x:%x:%x:%x:%x", &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5]);
+    for (int i = 0; i < 6; i++) {
+        info.mac[i] = mac[i];
+    }
+    info.rx_ctrl.rssi = -45;
+    info.rx_ctrl.channel = CONFIG_WIFI_CHANNEL;
+    info.rx_ctrl.noise_floor = -95;
+    info.buf = buf;
+
+    for (uint32_t n = first; n < first + SOAK_FRAMES; n++) {
+        for (int i = 0; i < CSI_MAX_LEN; i++) {
+            buf[i] = (int8_t) ((n + i * 7) % 61 - 30);
+        }
+        set_layout(&info, n);
+        info.rx_ctrl.timestamp = n;
+        // paced like the device, the ring absorbs bursts but never overflows
+        while (csi_ring_count(&csi_ring) >= CSI_RING_LEN / 2) {
+            vTaskDelay(0);
+        }
+        host_wifi_csi_inject(&info);
+    }
+}
+
+// wait until the dsp task emptied the ring and the sink wrote out its queue
+static void settle() {
+    while (csi_ring_count(&csi_ring) > 0) {
+        vTaskDelay(1);
+    }
+    // the frame the dsp task popped last may still be on its way to the sink
+    vTaskDelay(pdMS_TO_TICKS(20));
+    CHECK(output_drain(5000));
+    dsp_latest();
+}
+
+int main(int argc, char **argv) {
+    uint32_t rounds = argc > 1 ? atoi(argv[1]) : SOAK_ROUNDS;
+
+    output_set_enabled(OUTPUT_SERIAL, false);
+    output_sink_t *sink = output_add_sink("soak", OUTPUT_FILE, &count_rows, NULL, OUTPUT_POLICY_BLOCK, 1);
+    csi_init((char *) "STA");
+    dsp_start();
+
+    size_t baseline = 0, peak = 0;
+    for (uint32_t r = 0; r < rounds; r++) {
+        round_of_frames(r * SOAK_FRAMES);
+        settle();
+
+        // every frame was consumed and reached the sink after the header
+        uint32_t consumed = stats_count(STATS_STAGE_QUEUE);
+        CHECK_EQ(csi_ring_count(&csi_ring), 0);
+        CHECK_EQ(csi_ring.pushed.load(), (r + 1) * SOAK_FRAMES);
+        CHECK_EQ(csi_ring.overflows.load(), 0);
+        CHECK_EQ(consumed, csi_ring.pushed.load());
+        CHECK_EQ(sink_rows.load(), consumed + 1);
+        CHECK_EQ(sink->dropped.load(), 0);
+
+        // the first round allocates what stays, e.g. stdio buffers, later ones must not add to it
+        size_t in_use = heap_in_use();
+        if (r == 0) {
+            baseline = in_use;
+        }
+        peak = in_use > peak ? in_use : peak;
+        CHECK(in_use <= baseline + SOAK_HEAP_SLACK);
+    }
+
+    printf("soak: %u rounds, %u frames, %u layout drops, heap %zu after the first round, peak %zu\n",
+           rounds, csi_ring.pushed.load(), stats_drops(STATS_DROP_LAYOUT), baseline, peak);
+    return test_result("test_soak");
+}
@@ -0,0 +1,225 @@
+/**
+ * @file test_stream.cc
+ * The UDP stream as a message sink of the output fan-out, received on
+ * localhost: with the block policy every frame arrives packed several to a
+ * datagram with consecutive datagram and frame numbers, sampling leaves the
+ * skipped frames as gaps in the frame numbers, and a paused stream sends no
+ * frames but still carries events.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/time.h>
+
+#include "csi_tool/csi_tool.h"
+#include "test.h"
+
+typedef std::vector<uint8_t> datagram_t;
+
+static int rx_fd = -1;
+static std::mutex rx_lock;
+static std::vector<datagram_t> received;
+static std::atomic<bool> rx_done(false);
+
+static uint16_t open_receiver() {
+    rx_fd = socket(PF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CHECK_EQ(bind(rx_fd, (struct sockaddr *) &addr, sizeof(addr)), 0);
+    socklen_t len = sizeof(addr);
+    getsockname(rx_fd, (struct sockaddr *) &addr, &len);
+    int rcvbuf = 4 << 20;
+    setsockopt(rx_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    struct timeval timeout = {0, 20000};
+    setsockopt(rx_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return ntohs(addr.sin_port);
+}
+
+static void receive_task() {
+    static uint8_t buf[2048];
+    while (!rx_done.load()) {
+        ssize_t n = recv(rx_fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            std::lock_guard<std::mutex> guard(rx_lock);
+            received.push_back(datagram_t(buf, buf + n));
+        }
+    }
+}
+
+// the datagrams received since the last call, after the stream was flushed
+static std::vector<datagram_t> take_received() {
+    // the dsp task sends a partly filled datagram on its next wakeup after STREAM_FLUSH_MS
+    while (csi_ring_count(&csi_ring) > 0) {
+        vTaskDelay(1);
+    }
+    vTaskDelay(pdMS_TO_TICKS(STREAM_FLUSH_MS + 2 * DSP_DEFAULT_INTERVAL_MS));
+    CHECK(output_drain(5000));
+    vTaskDelay(pdMS_TO_TICKS(50));
+    std::lock_guard<std::mutex> guard(rx_lock);
+    std::vector<datagram_t> out;
+    out.swap(received);
+    return out;
+}
+
+static void inject(uint32_t first, uint32_t count) {
+    static int8_t buf[128];
+    wifi_csi_info_t info;
+    memset(&info, 0, sizeof(info));
+    unsigned int mac[6];
+    sscanf(MAC_AP, "%x:%x:%x:%x:%x:%x", &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5]);
+    for (int i = 0; i < 6; i++) {
+        info.mac[i] = mac[i];
+    }
+    info.rx_ctrl.rssi = -45;
+    info.rx_ctrl.channel = CONFIG_WIFI_CHANNEL;
+    info.buf = buf;
+    info.len = sizeof(buf);
+    for (uint32_t n = first; n < first + count; n++) {
+        for (size_t i = 0; i < sizeof(buf); i++) {
+            buf[i] = (int8_t) (n + i);
+        }
+        info.rx_ctrl.timestamp = n;
+        while (csi_ring_count(&csi_ring) >= CSI_RING_LEN / 2) {
+            vTaskDelay(0);
+        }
+        host_wifi_csi_inject(&info);
+    }
+}
+
+typedef struct {
+    uint32_t datagrams;
+    uint32_t frames;
+    uint32_t events;
+    uint32_t bad;               // not a datagram, broken records or numbers out of order
+    uint32_t frame_gaps;        // frames missing between consecutive datagrams
+    std::vector<uint32_t> timestamps;
+} stream_summary_t;
+
+static uint32_t next_seq = 0;
+static uint32_t next_frame = 0;
+
+static stream_summary_t summarize(const std::vector<datagram_t> &datagrams) {
+    stream_summary_t sum = {0, 0, 0, 0, 0, {}};
+    for (const datagram_t &d : datagrams) {
+        csi_event_t event;
+        csi_datagram_header_t header;
+        if (csi_event_read(d.data(), d.size(), &event)) {
+            sum.events++;
+            continue;
+        }
+        if (!csi_datagram_read_header(d.data(), d.size(), &header) || header.seq != next_seq ||
+            header.first_frame < next_frame) {
+            sum.bad++;
+            continue;
+        }
+        sum.datagrams++;
+        sum.frame_gaps += header.first_frame - next_frame;
+        next_seq = header.seq + 1;
+        next_frame = header.first_frame + header.count;
+
+        size_t pos = CSI_DATAGRAM_HEADER_LEN;
+        for (int i = 0; i < header.count; i++) {
+            csi_record_t rec;
+            size_t consumed;
+            if (csi_record_decode(d.data() + pos, d.size() - pos, &rec, &consumed) != CSI_RECORD_OK) {
+                sum.bad++;
+                break;
+            }
+            pos += consumed;
+            sum.frames++;
+            sum.timestamps.push_back(rec.local_timestamp);
+        }
+        sum.bad += pos != d.size();
+    }
+    return sum;
+}
+
+static void test_block() {
+    output_sink_t *sink = output_find_sink(OUTPUT_STREAM);
+    output_set_policy(sink, OUTPUT_POLICY_BLOCK, 1);
+    inject(0, 2000);
+    stream_summary_t sum = summarize(take_received());
+
+    CHECK_EQ(sum.bad, 0);
+    CHECK_EQ(sum.frames, 2000);
+    CHECK_EQ(sum.frame_gaps, 0);
+    CHECK_EQ(sink->dropped.load(), 0);
+    // a 128 byte frame is a 173 byte record, up to 8 of them share a datagram
+    CHECK(sum.datagrams < sum.frames);
+    CHECK_EQ(sum.datagrams, csi_stream.datagrams.load());
+    uint32_t in_order = 0;
+    for (uint32_t i = 0; i < sum.timestamps.size(); i++) {
+        in_order += sum.timestamps[i] == i;
+    }
+    CHECK_EQ(in_order, 2000);
+    printf("block: %u frames in %u datagrams\n", sum.frames, sum.datagrams);
+}
+
+static void test_sample() {
+    output_sink_t *sink = output_find_sink(OUTPUT_STREAM);
+    output_set_policy(sink, OUTPUT_POLICY_SAMPLE, 4);
+    uint32_t skipped = csi_stream.frames_skipped.load();
+    inject(2000, 400);
+    stream_summary_t sum = summarize(take_received());
+
+    // every 4th frame is packed, the others are gaps in the frame numbers, those after the last one show later
+    CHECK_EQ(sum.bad, 0);
+    CHECK_EQ(sum.frames, 100);
+    CHECK_EQ(csi_stream.frames_skipped.load() - skipped, 300);
+    uint32_t trailing = 2400 - next_frame;
+    CHECK(trailing < 4);
+    CHECK_EQ(sum.frames + sum.frame_gaps + trailing, 400);
+    uint32_t sampled = 0;
+    for (uint32_t t : sum.timestamps) {
+        sampled += t >= 2000 && t < 2400 && (t - 2000) % 4 == (sum.timestamps[0] - 2000) % 4;
+    }
+    CHECK_EQ(sampled, 100);
+    output_set_policy(sink, OUTPUT_POLICY_DROP, 1);
+}
+
+static void test_paused_events() {
+    CHECK(stream_set_enabled(false));
+    inject(2400, 200);
+    uint8_t event[CSI_EVENT_LEN];
+    csi_event_t e = {true, 1, 1700000000000000ull, 10, 20};
+    csi_event_write(&e, event);
+    // events are sent by the consumer task on the device, the stream is idle here
+    CHECK(stream_send(event, sizeof(event)));
+    stream_summary_t sum = summarize(take_received());
+    CHECK_EQ(sum.frames, 0);
+    CHECK_EQ(sum.events, 1);
+    CHECK_EQ(sum.bad, 0);
+
+    // resumed, the numbers carry on
+    CHECK(stream_set_enabled(true));
+    inject(2600, 100);
+    sum = summarize(take_received());
+    CHECK_EQ(sum.frames, 100);
+    CHECK_EQ(sum.bad, 0);
+}
+
+int main() {
+    uint16_t port = open_receiver();
+    std::thread receiver(receive_task);
+
+    output_set_enabled(OUTPUT_SERIAL, false);
+    csi_init((char *) "STA");
+    dsp_start();
+    CHECK(!stream_set_enabled(true));
+    CHECK(stream_start("127.0.0.1", port));
+    CHECK(output_find_sink(OUTPUT_STREAM)->messages);
+
+    test_block();
+    test_sample();
+    test_paused_events();
+
+    rx_done = true;
+    receiver.join();
+    close(rx_fd);
+    return test_result("test_stream");
+}
@@ -0,0 +1,167 @@
+/**
+ * @file test_waterfall.cc
+ * The waterfall history: a row quantizes the window mean of the LLTF
+ * subcarriers carrying data, whatever the secondary channel, against a full
+ * scale that jumps to a new peak, decays slowly and never falls below
+ * WATERFALL_MIN_SCALE, and scrolling by one line after every push draws
+ * the same pixels as rendering the whole history, also once it wrapped.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "csi_tool/src/waterfall_component.h"
+#include "test.h"
+
+#define SUBC 64
+// -26..26 without DC, one column each
+#define DATA_SUBC 52
+#define COLS DATA_SUBC
+#define ROWS 16
+
+// the LLTF without a secondary channel, and with one below and above
+static const csi_subc_map_t LLTF_MAPS[] = {
+    {2, {{0, 31}, {-32, -1}}},
+    {1, {{0, 63}, {0, 0}}},
+    {1, {{-64, -1}, {0, 0}}},
+};
+static const csi_subc_map_t *LLTF = &LLTF_MAPS[0];
+
+static waterfall_t wf;
+static float mean[SUBC];
+
+// entry in ascending order of the data subcarrier in column x
+static int data_entry(int x) {
+    return x < DATA_SUBC / 2 ? 6 + x : 33 + (x - DATA_SUBC / 2);
+}
+
+static const uint8_t *newest_row() {
+    return wf.history + wf.head * wf.cols;
+}
+
+// one column per data subcarrier, levels are the amplitude over the full scale
+static void test_quantize() {
+    CHECK(waterfall_init(&wf, COLS, ROWS));
+    for (int j = 0; j < SUBC; j++) {
+        mean[j] = j;
+    }
+    // the guards and DC are left out of the peak and the row
+    mean[0] = 200.0f;
+    mean[SUBC / 2] = 200.0f;
+    mean[SUBC - 1] = 200.0f;
+    waterfall_push(&wf, mean, SUBC, LLTF);
+    CHECK_EQ(wf.used, DATA_SUBC);
+    float peak = data_entry(COLS - 1);
+    CHECK_NEAR(wf.full_scale, peak, 1e-4);
+    uint32_t exact = 0;
+    for (int x = 0; x < COLS; x++) {
+        exact += newest_row()[x] == (uint8_t) (data_entry(x) * (255.0f / peak));
+    }
+    CHECK_EQ(exact, COLS);
+    CHECK_EQ(newest_row()[COLS - 1], 255);
+    CHECK_EQ(wf.filled, 1);
+
+    // a quieter window keeps most of the old scale
+    for (int j = 0; j < SUBC; j++) {
+        mean[j] = 20.0f;
+    }
+    waterfall_push(&wf, mean, SUBC, LLTF);
+    CHECK_NEAR(wf.full_scale, peak + (20.0f - peak) / 32, 1e-4);
+    CHECK(newest_row()[0] < 100);
+
+    // a louder one clips at the top and becomes the scale, column 0 is subcarrier -26
+    for (int j = 0; j < SUBC; j++) {
+        mean[j] = j % 2 == 0 ? 100.0f : 300.0f;
+    }
+    waterfall_push(&wf, mean, SUBC, LLTF);
+    CHECK_NEAR(wf.full_scale, 300.0f, 1e-4);
+    CHECK_EQ(newest_row()[0], 85);
+    CHECK_EQ(newest_row()[1], 255);
+    free(wf.history);
+
+    // noise alone is not stretched over the colormap
+    CHECK(waterfall_init(&wf, COLS, ROWS));
+    for (int j = 0; j < SUBC; j++) {
+        mean[j] = 2.0f;
+    }
+    waterfall_push(&wf, mean, SUBC, LLTF);
+    CHECK_NEAR(wf.full_scale, WATERFALL_MIN_SCALE, 1e-4);
+    CHECK_EQ(newest_row()[0], (uint8_t) (2.0f * 255.0f / WATERFALL_MIN_SCALE));
+
+    // a window without subcarriers leaves the row dark
+    csi_subc_map_t none = {0, {{0, 0}, {0, 0}}};
+    waterfall_push(&wf, mean, 0, &none);
+    uint32_t dark = 0;
+    for (int x = 0; x < COLS; x++) {
+        dark += newest_row()[x] == 0;
+    }
+    CHECK_EQ(dark, COLS);
+    free(wf.history);
+}
+
+// guards and DC report zero vectors, in every layout they stay out of the columns
+static void test_layouts() {
+    for (const csi_subc_map_t &map : LLTF_MAPS) {
+        CHECK(waterfall_init(&wf, 2 * COLS, ROWS));
+        csi_segment_t layout;
+        layout.subc = SUBC;
+        layout.map = map;
+        for (int j = 0; j < SUBC; j++) {
+            int8_t index = csi_segment_index(&layout, csi_segment_order(&layout, j));
+            mean[j] = csi_lltf_has_data(&map, index) ? 40.0f : 0.0f;
+        }
+        waterfall_push(&wf, mean, SUBC, &map);
+        CHECK_EQ(wf.used, DATA_SUBC);
+        uint32_t data = 0, stripes = 0;
+        for (int i = 0; i < wf.used; i++) {
+            data += wf.data[i] == data_entry(i);
+        }
+        for (int x = 0; x < wf.cols; x++) {
+            stripes += newest_row()[x] != 255;
+        }
+        CHECK_EQ(data, DATA_SUBC);
+        CHECK_EQ(stripes, 0);
+        free(wf.history);
+    }
+}
+
+// the rows pushed so far render newest first, rows not yet filled are black
+static void test_scroll() {
+    CHECK(waterfall_init(&wf, COLS, ROWS));
+    std::vector<uint16_t> scrolled(COLS * ROWS), rendered(COLS * ROWS);
+    waterfall_render(&wf, scrolled.data());
+    uint32_t black = 0;
+    for (uint16_t px : scrolled) {
+        black += px == 0;
+    }
+    CHECK_EQ(black, COLS * ROWS);
+
+    uint32_t same = 0;
+    for (int n = 0; n < 3 * ROWS; n++) {
+        for (int k = 0; k < SUBC; k++) {
+            mean[k] = (k * 7 + n * 13) % 60;
+        }
+        waterfall_push(&wf, mean, SUBC, LLTF);
+        waterfall_scroll(&wf, scrolled.data());
+        waterfall_render(&wf, rendered.data());
+        same += scrolled == rendered;
+    }
+    CHECK_EQ(same, 3 * ROWS);
+    CHECK_EQ(wf.filled, ROWS);
+
+    // the top line is the row pushed last, drawn through the colormap
+    uint32_t top = 0;
+    for (int x = 0; x < COLS; x++) {
+        top += rendered[x] == waterfall_lut[newest_row()[x]];
+    }
+    CHECK_EQ(top, COLS);
+    free(wf.history);
+}
+
+int main() {
+    test_quantize();
+    test_layouts();
+    test_scroll();
+    return test_result("test_waterfall");
+}
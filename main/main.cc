@@ -24,6 +24,9 @@
 
 /* CSI-Tool specific */
 #include "csi_tool/csi_tool.h"
+#ifdef CONFIG_CSI_BENCH
+#include "csi_tool/src/bench_component.h"
+#endif
 
 /*********************
  *      DEFINES
@@ -32,6 +35,14 @@
 #define LEFT_BUTTON_PIN GPIO_NUM_0
 #define RIGHT_BUTTON_PIN GPIO_NUM_35
 #define MAX_TABS 2
+#define CHART_TRAIL_LEN CONFIG_CHART_TRAIL_LEN
+#define LV_MEM_LOG_INTERVAL_MS 60000
+#define GUI_TASK_CORE CONFIG_GUI_TASK_CORE
+#define GUI_TASK_PRIORITY CONFIG_GUI_TASK_PRIORITY
+/* Task stacks in bytes, DIAG shows how much of each was ever used */
+#define GUI_TASK_STACK 20000
+#define TRANSMITTER_TASK_STACK 4096
+#define REPLAY_TASK_STACK 4096
 
 /*
  * The examples use WiFi configuration that you can set via 'idf.py menuconfig'.
@@ -72,23 +83,56 @@
 #define SEND_CSI_TO_SD 0
 #endif
 
+#ifdef CONFIG_SEND_CSI_BINARY
+#define SEND_CSI_BINARY 1
+#else
+#define SEND_CSI_BINARY 0
+#endif
+
+#ifdef CONFIG_CSI_STREAM_UDP
+#define CSI_STREAM_UDP 1
+#else
+#define CSI_STREAM_UDP 0
+#endif
+
+#ifdef CONFIG_CSI_INJECT
+#define CSI_INJECT 1
+#else
+#define CSI_INJECT 0
+#endif
+
 /**********************
  *  STATIC PROTOTYPES
  **********************/
 static void lv_tick_task(void *arg);
 static void show_menu(lv_obj_t *screen);
 static bool keyboard_read(lv_indev_drv_t *drv, lv_indev_data_t *data);
+static void show_plot_type(int16_t type);
 
 /**********************
  *  STATIC VARIABLES
  **********************/
-static lv_obj_t *chart;
+static lv_obj_t *chart, *waterfall_canvas;
+static bool waterfall_redraw;
+/* Fixed set of series, the oldest one is overwritten by the next update */
+static decltype(lv_3d_chart_add_series(chart)) chart_series[CHART_TRAIL_LEN];
+static lv_coord_t chart_x[CHART_TRAIL_LEN][AGGREGATE_MAX_SUBC];
+static lv_coord_t chart_y[CHART_TRAIL_LEN][AGGREGATE_MAX_SUBC];
+static int chart_next;
+/* Amplitude range of the newest window, drawn around the amplitude trail */
+static decltype(lv_3d_chart_add_series(chart)) chart_low, chart_high;
+static lv_coord_t chart_range_x[AGGREGATE_MAX_SUBC];
+static lv_coord_t chart_low_y[AGGREGATE_MAX_SUBC];
+static lv_coord_t chart_high_y[AGGREGATE_MAX_SUBC];
 static bool switch_tab;
-static uint32_t last_tick, update_interval;
 static int16_t current_tab, plot_type;
 static lv_obj_t *tabview;
 static lv_group_t *g;
-static lv_obj_t *plot_label, *interval_label;
+static lv_obj_t *plot_slider, *plot_label, *interval_label;
+#ifdef CONFIG_CSI_MOTION
+static lv_obj_t *motion_label;
+static bool motion_shown;
+#endif
 
 /* FreeRTOS event group to signal when we are connected*/
 static EventGroupHandle_t s_wifi_event_group;
@@ -187,12 +231,40 @@ extern "C" void guiTask(void *pvParameter) {
     show_menu(screen);
 
     chart = lv_3d_chart_create(screen, NULL);
+    for (int s = 0; s < CHART_TRAIL_LEN; s++) {
+        chart_series[s] = lv_3d_chart_add_series(chart);
+    }
+    chart_low = lv_3d_chart_add_series(chart);
+    chart_high = lv_3d_chart_add_series(chart);
+
+    /* Waterfall view above the menu, hidden until selected */
+    static waterfall_t waterfall;
+    lv_coord_t waterfall_width = LV_HOR_RES;
+    lv_coord_t waterfall_height = LV_VER_RES - lv_obj_get_height(tabview);
+    static_assert(sizeof(lv_color_t) == sizeof(uint16_t) && !LV_COLOR_16_SWAP, "waterfall renders plain RGB565");
+    lv_color_t *waterfall_buf = (lv_color_t *)heap_caps_malloc(LV_CANVAS_BUF_SIZE_TRUE_COLOR(waterfall_width, waterfall_height), MALLOC_CAP_8BIT);
+    assert(waterfall_buf != NULL);
+    ESP_ERROR_CHECK(waterfall_init(&waterfall, waterfall_width, waterfall_height) ? ESP_OK : ESP_ERR_NO_MEM);
+
+    waterfall_canvas = lv_canvas_create(screen, NULL);
+    lv_canvas_set_buffer(waterfall_canvas, waterfall_buf, waterfall_width, waterfall_height, LV_IMG_CF_TRUE_COLOR);
+    lv_obj_align(waterfall_canvas, NULL, LV_ALIGN_IN_TOP_LEFT, 0, 0);
+    waterfall_render(&waterfall, (uint16_t *)waterfall_buf);
+    lv_obj_set_hidden(waterfall_canvas, true);
+
+#ifdef CONFIG_CSI_MOTION
+    /* Motion state in the corner, above every plot */
+    motion_label = lv_label_create(screen, NULL);
+    lv_obj_set_auto_realign(motion_label, true);
+    lv_obj_align(motion_label, NULL, LV_ALIGN_IN_TOP_RIGHT, -5, 5);
+    lv_label_set_text(motion_label, "still");
+    motion_shown = false;
+#endif
 
     // lv_3d_chart_add_cursor(chart, 0, 0, 0);
 
-    wifi_csi_info_t *d;
     vTaskStartScheduler();
-    last_tick = xTaskGetTickCount();
+    uint32_t last_mem_log = xTaskGetTickCount();
 
     while (1) {
         vTaskDelay(pdMS_TO_TICKS(10));
@@ -202,44 +274,72 @@ extern "C" void guiTask(void *pvParameter) {
             lv_task_handler();
             xSemaphoreGive(xGuiSemaphore);
 
-            /* Get raw data from queue */
-            if (xTaskGetTickCount() > (last_tick + update_interval) && (xQueueReceive(data_queue, &d, portMAX_DELAY) == pdTRUE)) {
-                last_tick = xTaskGetTickCount();
-                uint16_t csi_len = (d->len) / 2;
-                int8_t *csi_data = d->buf;
-
-                lv_coord_t subc[csi_len];
-                lv_coord_t ret[csi_len] = {0};
-
-                /* Caculate CSI from raw data. First and last 3 are null subcarrier. */
-                int16_t i = 3;
-
-                switch (plot_type) {
-                    case 0:
-                        while (i < csi_len - 3) {
-                            subc[i] = i;
-                            /* Calculate amplitude */
-                            ret[i] = sqrt(pow(csi_data[i * 2], 2) + pow(csi_data[(i * 2) + 1], 2));
-                            i++;
-                        }
-                        break;
-                    case 1:
-                        while (i < csi_len - 3) {
-                            subc[i] = i;
-                            /* Calculate phase */
-                            ret[i] = 200 * (atan2(csi_data[i * 2], csi_data[(i * 2) + 1]) + 3.2) / 6;
-                            i++;
-                        }
-                        break;
-                    default:
-                        break;
-                }
+            /* LVGL heap usage, should stay flat */
+            if (xTaskGetTickCount() - last_mem_log > pdMS_TO_TICKS(LV_MEM_LOG_INTERVAL_MS)) {
+                last_mem_log = xTaskGetTickCount();
+                lv_mem_monitor_t mon;
+                lv_mem_monitor(&mon);
+                printf("LVGL: %u%% used, %u of %u bytes free, max used %u, %u%% fragmented\n",
+                       mon.used_pct, mon.free_size, mon.total_size, mon.max_used, mon.frag_pct);
+            }
 
-                /* Plot CSI */
-                lv_3d_chart_set_points(chart, lv_3d_chart_add_series(chart), (lv_coord_t *)&subc, (lv_coord_t *)&ret, csi_len);
+            /* Follow a plot type set over serial */
+            if (dsp_plot_type != plot_type) {
+                lv_slider_set_value(plot_slider, dsp_plot_type, LV_ANIM_OFF);
+                show_plot_type(dsp_plot_type);
+            }
 
-                free(d);
+#ifdef CONFIG_CSI_MOTION
+            bool motion = dsp_motion.motion.load(std::memory_order_relaxed);
+            if (motion != motion_shown) {
+                lv_label_set_text(motion_label, motion ? "MOTION" : "still");
+                motion_shown = motion;
             }
+#endif
+
+            /* Latest window finished by the dsp task, never waits for new CSI */
+            const dsp_plot_t *plot = dsp_latest();
+            if (plot == NULL) {
+                continue;
+            }
+            int64_t chart_start = esp_timer_get_time();
+
+            /* The waterfall history keeps growing while other plots are shown */
+            waterfall_push(&waterfall, plot->mean, plot->subc, &plot->map);
+
+            /* Plot CSI */
+            if (plot_type == DSP_PLOT_WATERFALL) {
+                if (waterfall_redraw) {
+                    waterfall_render(&waterfall, (uint16_t *)waterfall_buf);
+                    waterfall_redraw = false;
+                } else {
+                    waterfall_scroll(&waterfall, (uint16_t *)waterfall_buf);
+                }
+                lv_obj_invalidate(waterfall_canvas);
+            } else if (plot->type == plot_type) {
+                lv_coord_t *subc = chart_x[chart_next];
+                lv_coord_t *ret = chart_y[chart_next];
+                for (int k = 0; k < plot->subc; k++) {
+                    subc[k] = k;
+                    ret[k] = plot->values[k];
+                }
+                lv_3d_chart_set_points(chart, chart_series[chart_next], subc, ret, plot->subc);
+                chart_next = (chart_next + 1) % CHART_TRAIL_LEN;
+
+                if (plot->type == DSP_PLOT_AMPLITUDE) {
+                    for (int k = 0; k < plot->subc; k++) {
+                        chart_range_x[k] = k;
+                        chart_low_y[k] = plot->low[k];
+                        chart_high_y[k] = plot->high[k];
+                    }
+                    lv_3d_chart_set_points(chart, chart_low, chart_range_x, chart_low_y, plot->subc);
+                    lv_3d_chart_set_points(chart, chart_high, chart_range_x, chart_high_y, plot->subc);
+                }
+            }
+
+            int64_t chart_done = esp_timer_get_time();
+            stats_record(STATS_STAGE_CHART, chart_done - chart_start);
+            stats_record(STATS_STAGE_END_TO_END, chart_done - plot->rx_us);
         }
     }
     /* A task should NEVER return */
@@ -258,22 +358,47 @@ static void lv_tick_task(void *arg) {
 
 static void plot_handler(lv_obj_t *obj, lv_event_t event) {
     if (event == LV_EVENT_VALUE_CHANGED) {
-        static char buf[20];
-        plot_type = lv_slider_get_value(obj);
-
-        switch (plot_type) {
-            case 0:
-                snprintf(buf, 20, "amplitude");
-                break;
-            case 1:
-                snprintf(buf, 20, "phase");
-                break;
-            default:
-                break;
-        }
+        int16_t type = lv_slider_get_value(obj);
+        dsp_plot_type = type;
+        show_plot_type(type);
+    }
+}
 
-        lv_label_set_text(plot_label, buf);
+static void show_plot_type(int16_t type) {
+    static char buf[20];
+    plot_type = type;
+
+    switch (plot_type) {
+        case DSP_PLOT_AMPLITUDE:
+            snprintf(buf, 20, "amplitude");
+            break;
+        case DSP_PLOT_PHASE:
+            snprintf(buf, 20, "phase");
+            break;
+        case DSP_PLOT_AMPLITUDE_STD:
+            snprintf(buf, 20, "amplitude std");
+            break;
+        case DSP_PLOT_WATERFALL:
+            snprintf(buf, 20, "waterfall");
+            break;
+        default:
+            break;
     }
+
+    /* Drop the trail of the previous plot type */
+    for (int s = 0; s < CHART_TRAIL_LEN; s++) {
+        lv_3d_chart_set_points(chart, chart_series[s], chart_x[s], chart_y[s], 0);
+    }
+    chart_next = 0;
+    lv_3d_chart_set_points(chart, chart_low, chart_range_x, chart_low_y, 0);
+    lv_3d_chart_set_points(chart, chart_high, chart_range_x, chart_high_y, 0);
+
+    /* The canvas missed the rows added while it was hidden */
+    waterfall_redraw = plot_type == DSP_PLOT_WATERFALL;
+    lv_obj_set_hidden(chart, plot_type == DSP_PLOT_WATERFALL);
+    lv_obj_set_hidden(waterfall_canvas, plot_type != DSP_PLOT_WATERFALL);
+
+    lv_label_set_text(plot_label, buf);
 }
 
 static void interval_handler(lv_obj_t *obj, lv_event_t event) {
@@ -283,7 +408,7 @@ static void interval_handler(lv_obj_t *obj, lv_event_t event) {
         snprintf(buf, 10, "%u Hz", val);
         lv_label_set_text(interval_label, buf);
 
-        update_interval = 1000 / val;
+        dsp_interval_ms = 1000 / val;
     }
 }
 
@@ -335,11 +460,11 @@ static void show_menu(lv_obj_t *screen) {
 
     /* Configure Plot */
     plot_type = 0;
-    lv_obj_t *plot_slider = lv_slider_create(tab1, NULL);
+    plot_slider = lv_slider_create(tab1, NULL);
     lv_obj_set_width(plot_slider, width - 10);
     lv_obj_align(plot_slider, NULL, LV_ALIGN_IN_LEFT_MID, 5, 0);
 
-    lv_slider_set_range(plot_slider, 0, 1);
+    lv_slider_set_range(plot_slider, 0, DSP_PLOT_WATERFALL);
     lv_obj_set_event_cb(plot_slider, plot_handler);
     lv_group_add_obj(g, plot_slider);
 
@@ -361,7 +486,7 @@ static void show_menu(lv_obj_t *screen) {
     lv_slider_set_range(interval_slider, 1, 10);
     lv_obj_set_event_cb(interval_slider, interval_handler);
     lv_slider_set_value(interval_slider, 10, LV_ANIM_OFF);
-    update_interval = 100;
+    dsp_interval_ms = 100;
     lv_group_add_obj(g, interval_slider);
 
     interval_label = lv_label_create(tab2, plot_label);
@@ -382,11 +507,15 @@ esp_err_t _http_event_handle(esp_http_client_event_t *evt) {
             ESP_LOGI(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
             if (!esp_http_client_is_chunked_response(evt->client)) {
                 if (!real_time_set) {
-                    char *data = (char *)malloc(evt->data_len + 1);
-                    strncpy(data, (char *)evt->data, evt->data_len);
-                    data[evt->data_len + 1] = '\0';
-                    time_set(data);
-                    free(data);
+                    /* A time response is a few dozen characters, anything longer is not a time */
+                    char data[64];
+                    if (evt->data_len < (int)sizeof(data)) {
+                        memcpy(data, evt->data, evt->data_len);
+                        data[evt->data_len] = '\0';
+                        time_set(data);
+                    } else {
+                        ESP_LOGW(TAG, "HTTP response of %d bytes not used as time", evt->data_len);
+                    }
                 }
             }
             break;
@@ -396,9 +525,6 @@ esp_err_t _http_event_handle(esp_http_client_event_t *evt) {
     return ESP_OK;
 }
 
-//// en_sys_seq: see https://github.com/espressif/esp-idf/blob/master/docs/api-guides/wifi.rst#wi-fi-80211-packet-send for details
-esp_err_t esp_wifi_80211_tx(wifi_interface_t ifx, const void *buffer, int len, bool en_sys_seq);
-
 static void event_handler(void *arg, esp_event_base_t event_base,
                           int32_t event_id, void *event_data) {
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
@@ -466,6 +592,11 @@ void vTask_socket_transmitter_sta_loop(void *pvParameters) {
     }
 }
 
+void vTask_inject_transmitter_loop(void *pvParameters) {
+    inject_transmitter_loop();
+    vTaskDelete(NULL);
+}
+
 void config_print() {
     printf("\n\n\n\n\n\n\n\n");
     printf("-----------------------\n");
@@ -480,10 +611,16 @@ void config_print() {
     printf("ESP_WIFI_SSID: %s\n", ESP_WIFI_SSID);
     printf("ESP_WIFI_PASSWORD: %s\n", ESP_WIFI_PASS);
     printf("PACKET_RATE: %i\n", CONFIG_PACKET_RATE);
+    printf("CSI_INJECT: %d\n", CSI_INJECT);
+#ifdef CONFIG_CSI_INJECT
+    printf("CSI_INJECT_BSSID: %s%s\n", INJECT_BSSID, inject_bssid_valid() ? "" : " (invalid)");
+#endif
     printf("SHOULD_COLLECT_CSI: %d\n", SHOULD_COLLECT_CSI);
     printf("SHOULD_COLLECT_ONLY_LLTF: %d\n", SHOULD_COLLECT_ONLY_LLTF);
     printf("SEND_CSI_TO_SERIAL: %d\n", SEND_CSI_TO_SERIAL);
     printf("SEND_CSI_TO_SD: %d\n", SEND_CSI_TO_SD);
+    printf("SEND_CSI_BINARY: %d\n", SEND_CSI_BINARY);
+    printf("CSI_STREAM_UDP: %d\n", CSI_STREAM_UDP);
     printf("-----------------------\n");
     printf("\n\n\n\n\n\n\n\n");
 }
@@ -494,18 +631,54 @@ void config_print() {
 extern "C" void app_main() {
     config_print();
     nvs_init();
+
+#ifdef CONFIG_CSI_BENCH
+    /* Before Wi-Fi and the other tasks start, so nothing else competes for the cpu */
+    static bench_result_t bench_results[BENCH_MAX_RESULTS];
+    int bench_count = bench_run(NULL, bench_results, BENCH_MAX_RESULTS);
+    bench_print(bench_results, bench_count);
+    bench_write_json(stdout, bench_results, bench_count);
+#endif
     sd_init();
     station_init();
     csi_init((char *)"STA");
 
+#ifdef CONFIG_CSI_STREAM_UDP
+    stream_start(CONFIG_CSI_STREAM_HOST, CONFIG_CSI_STREAM_PORT);
+#endif
+
 #if !(SHOULD_COLLECT_CSI)
     printf("CSI will not be collected. Check `idf.py menuconfig  # > ESP32 CSI Tool Config` to enable CSI");
 #endif
 
     TaskHandle_t xHandle = NULL;
 
+#ifdef CONFIG_CSI_INJECT
+    /* Without a valid BSSID nothing would trigger CSI, say so instead of running silently */
+    if (inject_init()) {
+        xTaskCreatePinnedToCore(&vTask_inject_transmitter_loop, "inject_transmitter_loop",
+                                TRANSMITTER_TASK_STACK, NULL, 100, &xHandle, 0);
+        diag_register_task(xHandle, "inject", TRANSMITTER_TASK_STACK);
+    } else {
+        ESP_LOGE(TAG, "CSI_INJECT_BSSID \"%s\" is not a MAC address (xx:xx:xx:xx:xx:xx), injection not started: "
+                      "no frames will trigger CSI. Fix it in idf.py menuconfig > ESP32 CSI Tool Config",
+                 INJECT_BSSID);
+    }
+#else
     xTaskCreatePinnedToCore(&vTask_socket_transmitter_sta_loop, "socket_transmitter_sta_loop",
-                            10000, (void *)&is_wifi_connected, 100, &xHandle, 0);
+                            TRANSMITTER_TASK_STACK, (void *)&is_wifi_connected, 100, &xHandle, 0);
+    diag_register_task(xHandle, "socket", TRANSMITTER_TASK_STACK);
+#endif
+
+    dsp_start();
+    input_start();
+    xTaskCreatePinnedToCore(guiTask, "gui", GUI_TASK_STACK, NULL, GUI_TASK_PRIORITY, &xHandle, GUI_TASK_CORE);
+    diag_register_task(xHandle, "gui", GUI_TASK_STACK);
+
+#ifdef CONFIG_CSI_REPLAY
+    xTaskCreatePinnedToCore(&replay_task, "replay", REPLAY_TASK_STACK, NULL, 5, &xHandle, 0);
+    diag_register_task(xHandle, "replay", REPLAY_TASK_STACK);
+#endif
 
-    xTaskCreatePinnedToCore(guiTask, "gui", 20000, NULL, 100, NULL, 1);
+    diag_start();
 }
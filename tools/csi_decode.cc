@@ -0,0 +1,119 @@
+/**
+ * @file csi_decode.cc
+ * Convert binary CSI captures (serial dump or SD card .bin file) back to the CSV schema,
+ * delta compressed records are unpacked on the way
+ *
+ * usage: csi_decode [-o output.csv] [input.bin]
+ * Reads stdin if no input file is given and writes CSV to stdout unless -o is set.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "record_component.h"
+#include "codec_component.h"
+#include "csv_component.h"
+
+#define READ_CHUNK 65536
+
+int main(int argc, char **argv) {
+    const char *out_path = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "o:h")) != -1) {
+        switch (opt) {
+            case 'o':
+                out_path = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-o output.csv] [input.bin]\n", argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    FILE *in = stdin;
+    if (optind < argc) {
+        in = fopen(argv[optind], "rb");
+        if (in == NULL) {
+            perror(argv[optind]);
+            return 1;
+        }
+    }
+    FILE *out = stdout;
+    if (out_path != NULL) {
+        out = fopen(out_path, "w");
+        if (out == NULL) {
+            perror(out_path);
+            return 1;
+        }
+    }
+
+    // a chunk plus room for one partial record carried over from the previous read
+    size_t cap = READ_CHUNK + CSI_RECORD_MAX_LEN;
+    uint8_t *buf = (uint8_t *) malloc(cap);
+    size_t len = 0;
+    unsigned long records = 0, skipped = 0, corrupt = 0, unpacked_missing = 0;
+    static csi_codec_t codec;
+    static int8_t unpacked[CSI_RECORD_MAX_DATA];
+    static char line[CSV_LINE_LEN(CSI_RECORD_MAX_DATA)];
+    csi_codec_init(&codec, CODEC_KEYFRAME_INTERVAL);
+
+    fputs(CSV_HEADER, out);
+
+    bool eof = false;
+    while (!eof || len > 0) {
+        if (!eof) {
+            size_t n = fread(buf + len, 1, cap - len, in);
+            if (n == 0) {
+                eof = true;
+            }
+            len += n;
+        }
+
+        size_t pos = 0;
+        while (pos < len) {
+            csi_record_t rec;
+            size_t consumed;
+            csi_record_status_t status = csi_record_decode(buf + pos, len - pos, &rec, &consumed);
+            if (status == CSI_RECORD_OK && rec.packed_len > 0 && !csi_codec_decode(&codec, &rec, unpacked)) {
+                // a delta frame from before the first keyframe, or after a corrupt record
+                unpacked_missing++;
+            } else if (status == CSI_RECORD_OK) {
+                fwrite(line, 1, csv_format_row(&rec, line, sizeof(line)), out);
+                records++;
+            } else if (status == CSI_RECORD_CORRUPT) {
+                if (consumed == 1) {
+                    corrupt++;
+                }
+                skipped += consumed;
+            } else if (eof) {
+                // truncated record at the end of the capture
+                skipped += len - pos;
+                consumed = len - pos;
+            } else {
+                break;
+            }
+            pos += consumed;
+        }
+
+        memmove(buf, buf + pos, len - pos);
+        len -= pos;
+    }
+
+    fprintf(stderr, "%lu records, %lu bytes skipped, %lu corrupt records\n", records, skipped, corrupt);
+    if (codec.frames.load() > 0 || unpacked_missing > 0) {
+        fprintf(stderr, "%u packed records, %u keyframes, %.2f:1, %lu without their previous frame\n",
+                codec.frames.load(), codec.keyframes.load(),
+                codec.packed_bytes > 0 ? (double) codec.raw_bytes / codec.packed_bytes : 0.0, unpacked_missing);
+    }
+
+    free(buf);
+    if (in != stdin) {
+        fclose(in);
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
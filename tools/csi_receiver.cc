@@ -0,0 +1,179 @@
+/**
+ * @file csi_receiver.cc
+ * Collect CSI streamed over UDP by the ESP32 (CONFIG_CSI_STREAM_UDP) or by csi_host -u
+ *
+ * usage: csi_receiver [-p port] [-o output.bin] [-n datagrams] [-t idle seconds]
+ * Writes the binary records to the output (stdout by default), convert them with csi_decode.
+ * Stops on Ctrl-C, after -n datagrams or after -t seconds without data and prints
+ * the number of lost datagrams and frames to stderr. Motion events are printed to
+ * stderr as they arrive, in the MOTION,... format of the serial port.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+
+#include "record_component.h"
+#include "datagram_component.h"
+
+#define DEFAULT_PORT 5500
+#define MAX_DATAGRAM 65536
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int sig) {
+    (void) sig;
+    stop = 1;
+}
+
+int main(int argc, char **argv) {
+    uint16_t port = DEFAULT_PORT;
+    const char *out_path = NULL;
+    unsigned long max_datagrams = 0;
+    int idle_seconds = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "p:o:n:t:h")) != -1) {
+        switch (opt) {
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 'o':
+                out_path = optarg;
+                break;
+            case 'n':
+                max_datagrams = strtoul(optarg, NULL, 10);
+                break;
+            case 't':
+                idle_seconds = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-p port] [-o output.bin] [-n datagrams] [-t idle seconds]\n", argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    FILE *out = stdout;
+    if (out_path != NULL) {
+        out = fopen(out_path, "wb");
+        if (out == NULL) {
+            perror(out_path);
+            return 1;
+        }
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return 1;
+    }
+    // room for bursts while the output is written
+    int rcvbuf = 4 * 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    if (idle_seconds > 0) {
+        struct timeval timeout = {idle_seconds, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        perror("bind");
+        return 1;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_signal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    fprintf(stderr, "listening on udp port %u\n", port);
+
+    static uint8_t buf[MAX_DATAGRAM];
+    unsigned long datagrams = 0, records = 0, invalid = 0, corrupt = 0, reordered = 0, restarts = 0;
+    unsigned long lost_datagrams = 0, lost_frames = 0, events = 0;
+    uint32_t next_seq = 0, next_frame = 0;
+
+    while (!stop && (max_datagrams == 0 || datagrams < max_datagrams)) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                fprintf(stderr, "no data for %d s\n", idle_seconds);
+                break;
+            }
+            perror("recv");
+            break;
+        }
+
+        csi_event_t event;
+        if (csi_event_read(buf, n, &event)) {
+            fprintf(stderr, "MOTION,%u,%u,%llu.%06llu,%u,%u\n", event.motion, event.seq,
+                    (unsigned long long) (event.real_timestamp / 1000000),
+                    (unsigned long long) (event.real_timestamp % 1000000), event.variance, event.change);
+            events++;
+            continue;
+        }
+
+        csi_datagram_header_t header;
+        if (!csi_datagram_read_header(buf, n, &header)) {
+            invalid++;
+            continue;
+        }
+        // sequence 0 after other datagrams means the sender rebooted, start counting anew
+        bool restart = datagrams > 0 && header.seq == 0 && next_seq != 0;
+        if (restart) {
+            restarts++;
+        }
+        // the first datagram sets the reference, wrap-around is handled by unsigned differences
+        if (datagrams > 0 && !restart && header.seq != next_seq) {
+            if ((int32_t) (header.seq - next_seq) > 0) {
+                lost_datagrams += header.seq - next_seq;
+            } else {
+                reordered++;
+            }
+        }
+        if (datagrams > 0 && !restart && (int32_t) (header.first_frame - next_frame) > 0) {
+            lost_frames += header.first_frame - next_frame;
+        }
+        if (datagrams == 0 || restart || (int32_t) (header.seq - next_seq) >= 0) {
+            next_seq = header.seq + 1;
+            next_frame = header.first_frame + header.count;
+        }
+        datagrams++;
+
+        // check the records before writing, only those before the first corrupt one are written
+        // so the output never holds a broken record
+        size_t pos = CSI_DATAGRAM_HEADER_LEN;
+        for (int i = 0; i < header.count; i++) {
+            csi_record_t rec;
+            size_t consumed;
+            if (csi_record_decode(buf + pos, n - pos, &rec, &consumed) != CSI_RECORD_OK) {
+                corrupt++;
+                break;
+            }
+            pos += consumed;
+            records++;
+        }
+        fwrite(buf + CSI_DATAGRAM_HEADER_LEN, 1, pos - CSI_DATAGRAM_HEADER_LEN, out);
+    }
+
+    fprintf(stderr, "%lu datagrams, %lu records, %lu datagrams lost, %lu frames lost, %lu reordered, "
+            "%lu sender restarts, %lu invalid datagrams, %lu corrupt records, %lu motion events\n",
+            datagrams, records, lost_datagrams, lost_frames, reordered, restarts, invalid, corrupt, events);
+
+    close(fd);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}